@@ -1,6 +1,34 @@
-﻿namespace Carnassial
+﻿using System;
+using System.Windows;
+
+namespace Carnassial
 {
     public partial class App : LocalizedApplication
     {
+        protected override async void OnStartup(StartupEventArgs e)
+        {
+            // in batch mode files are added without the main window being shown and Carnassial exits when the batch completes
+            if (CarnassialBatch.IsBatch(e.Args) == false)
+            {
+                base.OnStartup(e);
+                return;
+            }
+
+            this.StartupUri = null;
+            base.OnStartup(e);
+            int exitCode;
+            try
+            {
+                exitCode = await CarnassialBatch.RunAsync(e.Args).ConfigureAwait(true);
+            }
+            catch (Exception exception)
+            {
+                // since OnStartup() is async void an exception escaping it would crash Carnassial without an exit code, leaving
+                // scripts running batches unable to tell why the batch stopped
+                Console.Error.WriteLine($"Batch failed: {exception}");
+                exitCode = CarnassialBatch.ExitCodeUnhandledException;
+            }
+            this.Shutdown(exitCode);
+        }
     }
 }
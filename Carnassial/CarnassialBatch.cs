@@ -0,0 +1,175 @@
+﻿using Carnassial.Data;
+using Carnassial.Data.Spreadsheet;
+using Carnassial.Images;
+using Carnassial.Interop;
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Diagnostics.CodeAnalysis;
+using System.Globalization;
+using System.IO;
+using System.Threading.Tasks;
+
+namespace Carnassial
+{
+    /// <summary>
+    /// Adds and classifies files without showing the main window so card dumps can be processed unattended, for example
+    /// overnight, before image sets are opened for analysis.
+    /// </summary>
+    /// <remarks>
+    /// Usage: Carnassial.exe -batch template.tdb [database.ddb] [folder ...] [export.csv | export.xlsx]
+    ///
+    /// Arguments after -batch are recognized by their extensions, so they may be given in any order. The file database defaults
+    /// to <see cref="Constant.File.DefaultFileDatabaseFileName"/> in the template's folder and, if no folders are given, files
+    /// are added from the template's folder and all its subfolders. Folders must be within the template's folder. Files already
+    /// in the database are skipped, so a batch can be rerun as more files are copied off cards. Files are added through the same
+    /// <see cref="AddFilesIOComputeTransactionManager"/> as the main window uses, so classification and file table rows are
+    /// identical to those of files added interactively.
+    /// </remarks>
+    internal static class CarnassialBatch
+    {
+        public const string Argument = "-batch";
+        public const int ExitCodeUnhandledException = 3;
+
+        private const int ExitCodeDatabaseUnavailable = 2;
+        private const int ExitCodeSuccess = 0;
+        private const int ExitCodeUsage = 1;
+
+        public static bool IsBatch(string[] args)
+        {
+            return (args.Length > 0) && String.Equals(args[0], CarnassialBatch.Argument, StringComparison.OrdinalIgnoreCase);
+        }
+
+        /// <summary>
+        /// Add files to a file database and, optionally, export the database to a spreadsheet.
+        /// </summary>
+        /// <param name="args">The command line arguments, excluding the executable, starting with <see cref="Argument"/>.</param>
+        /// <returns>The process exit code: zero on success, nonzero if arguments aren't valid or a database can't be opened.</returns>
+        public static async Task<int> RunAsync(string[] args)
+        {
+            // output goes to the console Carnassial was started from, if any, as Carnassial is a windowed application
+            NativeMethods.AttachParentConsole();
+
+            if (CarnassialBatch.TryParseArguments(args, out string? templateDatabasePath, out string? fileDatabasePath, out List<string> folderPaths, out string? spreadsheetFilePath) == false)
+            {
+                Console.Error.WriteLine($"Usage: {Constant.ApplicationName}.exe {CarnassialBatch.Argument} template{Constant.File.TemplateFileExtension} [database{Constant.File.FileDatabaseFileExtension}] [folder ...] [export{Constant.File.CsvFileExtension} | export{Constant.File.ExcelFileExtension}]");
+                return CarnassialBatch.ExitCodeUsage;
+            }
+
+            if (TemplateDatabase.TryCreateOrOpen(templateDatabasePath, out TemplateDatabase templateDatabase) == false)
+            {
+                Console.Error.WriteLine($"Unable to open template '{templateDatabasePath}'.");
+                return CarnassialBatch.ExitCodeDatabaseUnavailable;
+            }
+            using (templateDatabase)
+            {
+                if (FileDatabase.TryCreateOrOpen(fileDatabasePath, templateDatabase, CarnassialSettings.Default.OrderFilesByDateTime, LogicalOperator.And, out FileDatabase fileDatabase) == false)
+                {
+                    Console.Error.WriteLine($"Unable to open file database '{fileDatabasePath}'.");
+                    return CarnassialBatch.ExitCodeDatabaseUnavailable;
+                }
+                using (fileDatabase)
+                {
+                    Stopwatch stopwatch = Stopwatch.StartNew();
+                    if (folderPaths.Count == 0)
+                    {
+                        folderPaths.Add(fileDatabase.FolderPath);
+                        folderPaths.AddRange(Directory.EnumerateDirectories(fileDatabase.FolderPath, "*", SearchOption.AllDirectories));
+                    }
+
+                    // all files must be selected so files already in the database aren't added a second time
+                    fileDatabase.SelectFiles(FileSelection.All);
+                    using AddFilesIOComputeTransactionManager folderLoad = new((FileLoadStatus _) => { }, TimeSpan.FromSeconds(1.0));
+                    folderLoad.FolderPaths.AddRange(folderPaths);
+                    folderLoad.FindFilesToLoad(fileDatabase.FolderPath);
+
+                    // no images are displayed, so progress images are requested at the smallest width there is a decode for
+                    int filesAdded = await folderLoad.AddFilesAsync(fileDatabase, Constant.Images.MinimumRenderWidthInPixels).ConfigureAwait(true);
+                    stopwatch.Stop();
+                    Console.WriteLine(String.Create(CultureInfo.CurrentCulture, $"Added {filesAdded} of {folderLoad.FilesToLoad} files found in {stopwatch.Elapsed.TotalSeconds:0.0}s ({folderLoad.FilesToLoad / Math.Max(stopwatch.Elapsed.TotalSeconds, 0.001):0.0} files/s; I/O {folderLoad.IODuration.TotalSeconds:0.0}s, compute {folderLoad.ComputeDuration.TotalSeconds:0.0}s, database {folderLoad.DatabaseDuration.TotalSeconds:0.0}s)."));
+
+                    if (spreadsheetFilePath != null)
+                    {
+                        fileDatabase.SelectFiles(FileSelection.All);
+                        SpreadsheetReaderWriter spreadsheetWriter = new((SpreadsheetReadWriteStatus _) => { }, TimeSpan.FromSeconds(1.0));
+                        if (spreadsheetFilePath.EndsWith(Constant.File.ExcelFileExtension, StringComparison.OrdinalIgnoreCase))
+                        {
+                            spreadsheetWriter.ExportFileDataToXlsx(fileDatabase, spreadsheetFilePath);
+                        }
+                        else
+                        {
+                            spreadsheetWriter.ExportFileDataToCsv(fileDatabase, spreadsheetFilePath);
+                        }
+                        Console.WriteLine($"Exported {fileDatabase.Files.RowCount} files to '{spreadsheetFilePath}'.");
+                    }
+                }
+            }
+            return CarnassialBatch.ExitCodeSuccess;
+        }
+
+        private static bool TryParseArguments(string[] args, [NotNullWhen(true)] out string? templateDatabasePath, [NotNullWhen(true)] out string? fileDatabasePath, out List<string> folderPaths, out string? spreadsheetFilePath)
+        {
+            fileDatabasePath = null;
+            folderPaths = [];
+            spreadsheetFilePath = null;
+            templateDatabasePath = null;
+            if (CarnassialBatch.IsBatch(args) == false)
+            {
+                return false;
+            }
+
+            for (int argumentIndex = 1; argumentIndex < args.Length; ++argumentIndex)
+            {
+                string path = Path.GetFullPath(args[argumentIndex]);
+                if (path.EndsWith(Constant.File.TemplateFileExtension, StringComparison.OrdinalIgnoreCase) && (templateDatabasePath == null))
+                {
+                    templateDatabasePath = path;
+                }
+                else if (path.EndsWith(Constant.File.FileDatabaseFileExtension, StringComparison.OrdinalIgnoreCase) && (fileDatabasePath == null))
+                {
+                    fileDatabasePath = path;
+                }
+                else if ((path.EndsWith(Constant.File.CsvFileExtension, StringComparison.OrdinalIgnoreCase) ||
+                          path.EndsWith(Constant.File.ExcelFileExtension, StringComparison.OrdinalIgnoreCase)) && (spreadsheetFilePath == null))
+                {
+                    spreadsheetFilePath = path;
+                }
+                else if (Directory.Exists(path))
+                {
+                    folderPaths.Add(path);
+                }
+                else
+                {
+                    return false;
+                }
+            }
+
+            if ((templateDatabasePath == null) || (File.Exists(templateDatabasePath) == false))
+            {
+                return false;
+            }
+            string? templateFolderPath = Path.GetDirectoryName(templateDatabasePath);
+            if (templateFolderPath == null)
+            {
+                return false;
+            }
+            fileDatabasePath ??= Path.Combine(templateFolderPath, Constant.File.DefaultFileDatabaseFileName);
+
+            // the file table stores paths relative to the database's folder, so files outside of it can't be added
+            // Subfolders are matched with a trailing separator so sibling folders whose names start with the database folder's name,
+            // such as Station1 and Station10, aren't mistaken for subfolders.
+            string fileDatabaseFolderPath = Path.TrimEndingDirectorySeparator(Path.GetDirectoryName(fileDatabasePath) ?? templateFolderPath);
+            string fileDatabaseSubfolderPrefix = Path.EndsInDirectorySeparator(fileDatabaseFolderPath) ? fileDatabaseFolderPath : fileDatabaseFolderPath + Path.DirectorySeparatorChar;
+            foreach (string folderPath in folderPaths)
+            {
+                string folderPathWithoutSeparator = Path.TrimEndingDirectorySeparator(folderPath);
+                if ((String.Equals(folderPathWithoutSeparator, fileDatabaseFolderPath, StringComparison.OrdinalIgnoreCase) == false) &&
+                    (folderPathWithoutSeparator.StartsWith(fileDatabaseSubfolderPrefix, StringComparison.OrdinalIgnoreCase) == false))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+}
@@ -55,9 +55,12 @@ namespace Carnassial
             this.FileView.ColumnDefinitions[2].Width = new GridLength(this.ControlGrid.Width);
 
             this.MenuOptionsAudioFeedback.IsChecked = CarnassialSettings.Default.AudioFeedback;
+            this.MenuOptionsCompensateCameraShake.IsChecked = CarnassialSettings.Default.CompensateCameraShake;
             this.MenuOptionsEnableImportPrompt.IsChecked = !CarnassialSettings.Default.SuppressImportPrompt;
+            this.MenuOptionsNormalizeIllumination.IsChecked = CarnassialSettings.Default.NormalizeIllumination;
             this.MenuOptionsOrderFilesByDateTime.IsChecked = CarnassialSettings.Default.OrderFilesByDateTime;
             this.MenuOptionsSkipFileClassification.IsChecked = CarnassialSettings.Default.SkipFileClassification;
+            this.MenuViewChangeHeatmap.IsChecked = CarnassialSettings.Default.ShowChangeHeatmap;
 
             this.State.BackupTimer.Tick += this.Backup_TimerTick;
             this.State.FileNavigatorSliderTimer.Tick += this.FileNavigatorSlider_TimerTick;
@@ -299,6 +302,15 @@ namespace Carnassial
             }
         }
 
+        private void FileDisplay_ZoomChanged(object? sender, EventArgs e)
+        {
+            // images are decoded at the display's resolution unless the display's zoomed in or magnified
+            if (this.IsFileDatabaseAvailable())
+            {
+                this.DataHandler.ImageCache.RequireFullResolution(this.FileDisplay.IsMagnifiedOrZoomedIn);
+            }
+        }
+
         private async void FileNavigatorSlider_DragCompleted(object sender, DragCompletedEventArgs args)
         {
             this.State.FileNavigatorSliderDragging = false;
@@ -454,6 +466,16 @@ namespace Carnassial
             statusMessage.Content = null;
         }
 
+        private void ImageCache_CurrentImageRefined(object? sender, EventArgs e)
+        {
+            // the current file was shown as a preview or below the resolution now needed, so display its refined image
+            if (this.IsFileAvailable())
+            {
+                this.FileDisplay.Display(this.DataHandler.FileDatabase.FolderPath, this.DataHandler.ImageCache, this.GetDisplayMarkers());
+                _ = this.DataHandler.ImageCache.PrecomputeDifferencesAsync(this.State.DifferenceThreshold);
+            }
+        }
+
         private async void Instructions_Drop(object sender, DragEventArgs dropEvent)
         {
             if (ApplicationWindow.IsSingleTemplateFileDrag(dropEvent, out string? templateDatabaseFilePath))
@@ -1333,6 +1355,23 @@ namespace Carnassial
             this.MenuOptionsAudioFeedback.IsChecked = CarnassialSettings.Default.AudioFeedback;
         }
 
+        private async void MenuOptionsCompensateCameraShake_Click(object sender, RoutedEventArgs e)
+        {
+            CarnassialSettings.Default.CompensateCameraShake = !CarnassialSettings.Default.CompensateCameraShake;
+            this.MenuOptionsCompensateCameraShake.IsChecked = CarnassialSettings.Default.CompensateCameraShake;
+            if (this.DataHandler == null)
+            {
+                return;
+            }
+
+            // the cache drops differences calculated with the previous setting, so redisplay the current file unaltered
+            this.DataHandler.ImageCache.CompensateCameraShake = CarnassialSettings.Default.CompensateCameraShake;
+            if (this.IsFileAvailable())
+            {
+                await this.ShowFileAsync(this.DataHandler.ImageCache.CurrentRow, false).ConfigureAwait(true);
+            }
+        }
+
         private void MenuOptionsEnableFileCountOnImportDialog_Click(object sender, RoutedEventArgs e)
         {
             CarnassialSettings.Default.SuppressFileCountOnImportDialog = !CarnassialSettings.Default.SuppressFileCountOnImportDialog;
@@ -1345,6 +1384,23 @@ namespace Carnassial
             this.MenuOptionsEnableImportPrompt.IsChecked = !CarnassialSettings.Default.SuppressImportPrompt;
         }
 
+        private async void MenuOptionsNormalizeIllumination_Click(object sender, RoutedEventArgs e)
+        {
+            CarnassialSettings.Default.NormalizeIllumination = !CarnassialSettings.Default.NormalizeIllumination;
+            this.MenuOptionsNormalizeIllumination.IsChecked = CarnassialSettings.Default.NormalizeIllumination;
+            if (this.DataHandler == null)
+            {
+                return;
+            }
+
+            // as with camera shake compensation, cached differences are dropped so the current file is redisplayed unaltered
+            this.DataHandler.ImageCache.NormalizeIllumination = CarnassialSettings.Default.NormalizeIllumination;
+            if (this.IsFileAvailable())
+            {
+                await this.ShowFileAsync(this.DataHandler.ImageCache.CurrentRow, false).ConfigureAwait(true);
+            }
+        }
+
         internal async void MenuOptionsOrderFilesByDateTime_Click(object sender, RoutedEventArgs e)
         {
             if (this.IsFileDatabaseAvailable() == false)
@@ -1489,6 +1545,19 @@ namespace Carnassial
             this.FileDisplay.MagnifyingGlassEnabled = displayMagnifier;
         }
 
+        /// <summary>View the difference from the folder's background.</summary>
+        private async void MenuViewBackgroundDifference_Click(object sender, RoutedEventArgs e)
+        {
+            await this.TryViewBackgroundDifferenceAsync().ConfigureAwait(true);
+        }
+
+        private async void MenuViewChangeHeatmap_Click(object sender, RoutedEventArgs e)
+        {
+            CarnassialSettings.Default.ShowChangeHeatmap = !CarnassialSettings.Default.ShowChangeHeatmap;
+            this.MenuViewChangeHeatmap.IsChecked = CarnassialSettings.Default.ShowChangeHeatmap;
+            await this.ShowChangeHeatmapAsync().ConfigureAwait(true);
+        }
+
         /// <summary>View the combined image differences.</summary>
         private async void MenuViewDifferencesCombined_Click(object sender, RoutedEventArgs e)
         {
@@ -2042,6 +2111,23 @@ namespace Carnassial
             this.DataHandler.IsProgrammaticUpdate = false;
         }
 
+        private async Task ShowChangeHeatmapAsync()
+        {
+            // the previous file's heatmap is removed immediately so it's not shown over the new file while the new file's is found
+            this.FileDisplay.SetChangeHeatmap(null);
+            if ((CarnassialSettings.Default.ShowChangeHeatmap == false) || (this.IsFileAvailable() == false))
+            {
+                return;
+            }
+
+            ImageRow file = this.DataHandler.ImageCache.Current!; // this.DataHandler.ImageCache.Current != null when this.IsFileAvailable() == true
+            BlockChangeMap? changeMap = await this.DataHandler.ImageCache.TryGetChangeMapAsync().ConfigureAwait(true);
+            if ((changeMap != null) && this.IsFileAvailable() && (this.DataHandler.ImageCache.Current == file))
+            {
+                this.FileDisplay.SetChangeHeatmap(changeMap.GetHeatmap(Constant.Images.BlockChangeThresholdDefault));
+            }
+        }
+
         private void ShowLongRunningOperationFeedback()
         {
             this.LongRunningFeedback.Visibility = Visibility.Visible;
@@ -2117,6 +2203,8 @@ namespace Carnassial
             }
             int previousFileIndex = this.DataHandler.ImageCache.CurrentRow;
 
+            // images not already cached are shown first as previews and then refined to the display's width
+            this.DataHandler.ImageCache.DisplayWidthInPixels = this.FileDisplay.GetWidthInPixels();
             MoveToFileResult moveToFile = await this.DataHandler.ImageCache.TryMoveToFileAsync(fileIndex, prefetchStride).ConfigureAwait(true);
             if (moveToFile.Succeeded == false)
             {
@@ -2151,6 +2239,7 @@ namespace Carnassial
             {
                 // show the file
                 this.FileDisplay.Display(this.DataHandler.FileDatabase.FolderPath, this.DataHandler.ImageCache, this.GetDisplayMarkers());
+                _ = this.ShowChangeHeatmapAsync();
 
                 // add move to this file to the undo/redo chain if it's not already present
                 if (generateUndoRedoCommands)
@@ -2162,6 +2251,8 @@ namespace Carnassial
                 bool isVideo = this.DataHandler.ImageCache.Current.IsVideo;
                 bool isImage = !isVideo;
                 this.MenuViewApplyBookmark.IsEnabled = isImage;
+                this.MenuViewBackgroundDifference.IsEnabled = isImage;
+                this.MenuViewChangeHeatmap.IsEnabled = isImage;
                 this.MenuViewDifferencesCombined.IsEnabled = isImage;
                 this.MenuViewDisplayMagnifier.IsEnabled = isImage;
                 this.MenuViewMagnifierZoomIncrease.IsEnabled = isImage;
@@ -2176,6 +2267,18 @@ namespace Carnassial
 
                 // update render timestamp
                 this.State.MostRecentFileRender = DateTime.UtcNow;
+
+                // if the file isn't already cached a preview's displayed, in which case the cache refines it and raises
+                // CurrentImageRefined
+                // If navigation's rapid refinement's deferred until navigation pauses.
+                CachedImage? currentImage = this.DataHandler.ImageCache.GetCurrentImage();
+                if (isImage && (currentImage != null) && (currentImage.IsPreview == false))
+                {
+                    // have differences ready if the user asks for them; navigating to another file cancels the calculation
+                    // The cache declines if the file's displayed below full resolution and no difference has been asked for yet,
+                    // so display resolution browsing doesn't decode neighbours at full resolution.
+                    _ = this.DataHandler.ImageCache.PrecomputeDifferencesAsync(this.State.DifferenceThreshold);
+                }
             }
         }
 
@@ -2503,6 +2606,10 @@ namespace Carnassial
             // and can proceed in parallel on the UI thread during file loading.
             this.DataHandler = new DataEntryHandler(fileDatabase);
             this.DataHandler.BulkEdit += this.OnBulkEdit;
+            this.DataHandler.ImageCache.CompensateCameraShake = CarnassialSettings.Default.CompensateCameraShake;
+            this.DataHandler.ImageCache.CurrentImageRefined += this.ImageCache_CurrentImageRefined;
+            this.DataHandler.ImageCache.NormalizeIllumination = CarnassialSettings.Default.NormalizeIllumination;
+            this.DataHandler.ImageCache.RequireFullResolution(this.FileDisplay.IsMagnifiedOrZoomedIn);
             this.DataEntryControls.CreateControls(fileDatabase, this.DataHandler, (string dataLabel) => { return fileDatabase.GetDistinctValuesInFileDataColumn(dataLabel); });
 
             // add event handlers for marker effects which can't be handled by DataEntryHandler
@@ -2608,6 +2715,46 @@ namespace Carnassial
             return true;
         }
 
+        private async Task TryViewBackgroundDifferenceAsync()
+        {
+            if ((this.IsFileAvailable() == false) || this.DataHandler.ImageCache.Current!.IsVideo)
+            {
+                return;
+            }
+
+            ImageDifferenceResult result = await this.DataHandler.ImageCache.TryMoveToNextBackgroundDifferenceImageAsync(this.State.DifferenceThreshold).ConfigureAwait(true);
+            switch (result)
+            {
+                case ImageDifferenceResult.BackgroundNotAvailable:
+                    this.SetStatusMessage(Constant.ResourceKey.CarnassialWindowStatusBackgroundDifferenceNotAvailable);
+                    break;
+                case ImageDifferenceResult.CurrentImageNotAvailable:
+                    this.SetStatusMessage(Constant.ResourceKey.CarnassialWindowStatusBackgroundDifferenceCurrentNotLoadable);
+                    break;
+                case ImageDifferenceResult.NoLongerValid:
+                    // nothing to do
+                    break;
+                case ImageDifferenceResult.NotCalculable:
+                    this.SetStatusMessage(Constant.ResourceKey.CarnassialWindowStatusBackgroundDifferenceNotCalculable, this.DataHandler.ImageCache.Current.FileName);
+                    break;
+                case ImageDifferenceResult.Success:
+                    CachedImage? currentImage = this.DataHandler.ImageCache.GetCurrentImage();
+                    Debug.Assert(currentImage != null);
+                    this.FileDisplay.Display(currentImage);
+                    if (this.DataHandler.ImageCache.CurrentDifferenceState != ImageDifference.Background)
+                    {
+                        this.ClearStatusMessage();
+                    }
+                    else
+                    {
+                        this.SetStatusMessage(Constant.ResourceKey.CarnassialWindowStatusBackgroundDifference, 1000.0 * this.DataHandler.ImageCache.AverageBackgroundDifferenceTimeInSeconds);
+                    }
+                    break;
+                default:
+                    throw new NotSupportedException($"Unhandled background difference result {result}.");
+            }
+        }
+
         private async Task TryViewCombinedDifferenceAsync()
         {
             if ((this.IsFileAvailable() == false) || this.DataHandler.ImageCache.Current!.IsVideo)
@@ -3091,9 +3238,16 @@ namespace Carnassial
                     currentKey.Handled = true;
                     await this.TryViewPreviousOrNextDifferenceAsync().ConfigureAwait(true);
                     break;
-                case Key.Down:              // show visual difference to previous image
+                case Key.Down:              // show visual difference to previous and next images, or to the background with shift
                     currentKey.Handled = true;
-                    await this.TryViewCombinedDifferenceAsync().ConfigureAwait(true);
+                    if (Keyboard.Modifiers == ModifierKeys.Shift)
+                    {
+                        await this.TryViewBackgroundDifferenceAsync().ConfigureAwait(true);
+                    }
+                    else
+                    {
+                        await this.TryViewCombinedDifferenceAsync().ConfigureAwait(true);
+                    }
                     break;
                 default:
                     return;
@@ -36,6 +36,15 @@ namespace Carnassial
             public const string User32 = "user32.dll";
         }
 
+        public static class BackgroundColumn
+        {
+            public const string Frames = "Frames";
+            public const string Mean = "Mean";
+            public const string PixelHeight = "PixelHeight";
+            public const string PixelWidth = "PixelWidth";
+            public const string RelativePath = "RelativePath";
+        }
+
         public static class ComGuid
         {
             public const string IFileOperation = "947aab5f-0a5c-4c13-b4d6-4bf7836fc9f8";
@@ -168,6 +177,7 @@ namespace Carnassial
 
         public static class DatabaseTable
         {
+            public const string Backgrounds = "Backgrounds"; // table containing the background of each folder of images
             public const string Controls = "Controls"; // table containing controls
             [Obsolete("Legacy value for backwards compatibility with Carnassial 2.2.0.2 and earlier.")]
             public const string FileData = "FileData";
@@ -225,16 +235,40 @@ namespace Carnassial
 
         public static class FileColumn
         {
+            public const string ChangeScore = "ChangeScore";
             public const string Classification = "Classification";
             public const string DateTime = "DateTime";
             public const string File = "File";
+            public const string HighlightClipping = "HighlightClipping";
             [Obsolete("Legacy value for backwards compatibility with Carnassial 2.2.0.2 and earlier.")]
             public const string ImageQuality = "ImageQuality";
             public const string DeleteFlag = "DeleteFlag";
+            public const string LuminosityHistogram = "LuminosityHistogram";
+            public const string LuminosityPercentile5 = "LuminosityPercentile5";
+            public const string LuminosityPercentile50 = "LuminosityPercentile50";
+            public const string LuminosityPercentile95 = "LuminosityPercentile95";
             public const string RelativePath = "RelativePath";
+            public const string ShadowClipping = "ShadowClipping";
+            public const string Sharpness = "Sharpness";
             public const string UtcOffset = "UtcOffset";
 
             public const string MarkerPositionSuffix = "Markers";
+
+            // columns calculated from images' pixels when files are added rather than defined by controls
+            // Image statistics follow control columns in the file table and are null for files added before statistics were
+            // calculated or whose images couldn't be decoded. Change scores are also null for the first color image added to a
+            // folder and for greyscale images, which aren't compared to folders' backgrounds.
+            public static readonly ReadOnlyCollection<string> ImageStatistics = new List<string>()
+            {
+                Constant.FileColumn.ChangeScore,
+                Constant.FileColumn.HighlightClipping,
+                Constant.FileColumn.LuminosityHistogram,
+                Constant.FileColumn.LuminosityPercentile5,
+                Constant.FileColumn.LuminosityPercentile50,
+                Constant.FileColumn.LuminosityPercentile95,
+                Constant.FileColumn.ShadowClipping,
+                Constant.FileColumn.Sharpness
+            }.AsReadOnly();
         }
 
         public static class Gestures
@@ -272,20 +306,135 @@ namespace Carnassial
 
         public static class Images
         {
+            // tolerance on the difference in aspect ratio between an image and its folder's background for the image to be differenced
+            // against the background
+            // Some cameras letterbox widescreen images' thumbnails, in which case the background's aspect ratio doesn't match.
+            public const double BackgroundAspectRatioTolerance = 0.02;
+            // base two logarithm of the number of images over which backgrounds are averaged
+            // Backgrounds are an exponentially weighted mean, so each image's weight in its background is 1 / 2^shift once a
+            // folder has more than 2^shift images. 32 images spans several bursts, so animals moving through a burst are mostly
+            // averaged out while the background still follows gradual lighting and vegetation changes.
+            public const int BackgroundWeightShift = 5;
+            // bytes per pixel of the 32 bit BGRA images differencing and backgrounds are calculated with, the same as
+            // MemoryImage's calculation pixel size
+            public const int BgraPixelSizeInBytes = 4;
+            // multiplier from blocks' mean absolute differences to their opacity in change heatmaps, so a block differing by 64 or
+            // more levels is opaque
+            public const int BlockChangeHeatmapGain = 4;
+            // size of the blocks change maps are calculated over, in pixels of a 1/8 scale decode
+            public const int BlockChangeSizeInPixels = 8;
+            // mean absolute difference, in levels per channel, above which a block is considered changed
+            // Lower than DifferenceThresholdDefault as averaging over a block suppresses pixel noise and jpeg artifacts.
+            public const byte BlockChangeThresholdDefault = 10;
+            // size charged to caches for images which couldn't be loaded
+            public const long CachedImageMinimumSizeInBytes = 4096;
+            // minimum number of cache lines sampled before sampled classification may stop early
+            // Below this the standard errors of the luminosity and coloration estimates are themselves too noisy to rely on.
+            public const int ClassificationSamplingMinimumLines = 64;
+            // passes sampled classification makes over an image's sampled rows, checking after each whether classification is unambiguous
+            public const int ClassificationSamplingPasses = 4;
+            // standard errors luminosity and coloration estimates must be from classification thresholds for sampled classification
+            // to stop early
+            public const double ClassificationSamplingStandardErrors = 3.0;
+            // rows and cache lines skipped between those sampled when classifying images decoded without a thumbnail
+            // A stride of four reads one sixteenth of an image's cache lines, which is plenty as luminosity and coloration are
+            // weak functions of sampling density. Such images are decoded at 1/8 scale, at least
+            // NoThumbnailClassificationRequestedWidthInPixels wide, so the decode rather than classification dominates their cost.
+            public const int ClassificationSamplingStride = 4;
             // default threshold below which the mean luminosity of pixels in an image is considerd to be dark rather than greyscale
             public const double DarkLuminosityThresholdDefault = 0.0;
+            // portion of memory available to Carnassial used for caching difference images, within the minimum and maximum sizes
+            // Each precomputation calculates up to six differences, so the minimum holds one precomputation's differences for 8 MP
+            // images.
+            public const double DifferenceCacheFractionOfMemory = 0.03125;
+            public const long DifferenceCacheMaximumSizeInBytes = 1024 * 1024 * 1024;
+            public const long DifferenceCacheMinimumSizeInBytes = 192 * 1024 * 1024;
+            // files beyond the current file, in the direction of navigation, whose differences are calculated in the background
+            public const int DifferencePrecomputationSteps = 1;
             // difference threshold for masking differences between images, per RGB component per pixel
             public const byte DifferenceThresholdDefault = 20;
             public const byte DifferenceThresholdMax = 255;
             public const byte DifferenceThresholdMin = 0;
 
             public const double GreyscaleColorationThreshold = 0.005;
-            public const int ImageCacheSize = 9;
+            // eight bit luminosities at or above which pixels are considered clipped highlights
+            public const int HighlightClippingMinimumLuminosity = 253;
+            // largest gain, or smallest reciprocal gain, applied to an image's channels to match another image's illumination
+            // Larger gains would mostly amplify noise in near black channels, such as infrared frames' colour channels at night.
+            public const double IlluminationNormalizationMaximumGain = 4.0;
+            // channels whose interquartile ranges are narrower than this many levels are treated as flat and only offset, not scaled,
+            // by normalization
+            public const int IlluminationNormalizationMinimumInterquartileRange = 2;
+            // portion of memory available to Carnassial used for caching images, within the minimum and maximum sizes
+            // An eighth of memory holds about 30 8 MP images on an 8 GB machine.
+            public const double ImageCacheFractionOfMemory = 0.125;
+            public const long ImageCacheMaximumSizeInBytes = 4L * 1024 * 1024 * 1024;
+            public const long ImageCacheMinimumSizeInBytes = 256 * 1024 * 1024;
+            // portion of memory available to Carnassial used for caching jpegs, within the minimum and maximum sizes
+            // Trail camera jpegs are typically 1-4 MB, so a sixteenth of memory holds a few hundred jpegs on an 8 GB machine.
+            public const double JpegCacheFractionOfMemory = 0.0625;
+            public const long JpegCacheMaximumSizeInBytes = 2L * 1024 * 1024 * 1024;
+            public const long JpegCacheMinimumSizeInBytes = 128 * 1024 * 1024;
             public const int JpegInitialBufferSize = 2 * 4096;
+            // atoms an IO task reads concurrently when adding files
+            // Two IO tasks with two files per atom keep up to 128 reads queued to the drive, which is deep enough for NVMe drives
+            // and RAID arrays to approach their rated throughput on the small reads of jpeg metadata.
+            public const int LoadAtomsPerIOBatch = 32;
+            // atoms loaded but not yet computed, per compute task, before IO tasks block
+            // Bounds the memory held in loaded jpegs when IO outpaces compute while leaving enough slack for IO to absorb read
+            // latency variation.
+            public const int LoadAtomsQueuedPerComputeTask = 16;
+            // bins in luminosity histograms stored in the file table, each spanning eight of the 256 eight bit luminosities
+            public const int LuminosityHistogramBins = 32;
             public const int MinimumRenderWidthInPixels = 800;
+            // shortest interval between navigation steps used in estimating navigation rate, which bounds the rate estimate
+            public const double NavigationMinimumStepInSeconds = 0.01;
+            // interval between navigation steps after which navigation is considered to have paused
+            public const double NavigationPauseInSeconds = 0.5;
+            // width images without thumbnails are decoded at for classification, which selects turbojpeg's 1/8 scale for trail camera
+            // resolutions
             public const int NoThumbnailClassificationRequestedWidthInPixels = 200;
+            // how far ahead of navigation images are prefetched
+            // Long enough to cover a full resolution decode, which is a few hundred milliseconds for 20+ MP images on older
+            // laptops, with some margin for IO latency.
+            public const double PrefetchLookaheadInSeconds = 0.5;
+            public const int PrefetchMaximumSteps = 8;
+            // navigation rate, in steps per second, above which previews are displayed
+            // Full resolution decodes of 8 MP images take 100 ms or so, so this is approximately the rate they can be sustained at.
+            public const double PreviewNavigationRate = 8.0;
+            // any width less than 1/8 of an image's width selects 1/8 scale, the fastest decode
+            public const int PreviewRequestedWidthInPixels = 1;
+            // scales images are tiled at: full, 1/2, 1/4, and 1/8, which are the power of two scales jpeg decoding supports
+            public const int PyramidLevels = 4;
+            // frames this large or larger are shown zoomed in through tiles rather than decoded whole
+            // A 30 MP frame decodes to 120 MB, so whole decodes of such frames quickly crowd other files out of the image cache.
+            public const long PyramidMinimumPixels = 30 * 1000 * 1000;
+            // decoded tiles kept for a file; a 4K display zoomed to full resolution shows around 60 tiles of 1 MB each
+            public const long PyramidTileCacheSizeInBytes = 128 * 1024 * 1024;
+            // a multiple of 32 pixels so tiles start on MCU boundaries at all scales
+            public const int PyramidTileSizeInPixels = 512;
+            // eight bit luminosities at or below which pixels are considered clipped shadows
+            public const int ShadowClippingMaximumLuminosity = 2;
             public const int SmallestValidJpegSizeInBytes = 107; // with creative encoding; single pixel jpegs are usually somewhat larger
+            // pairs of adjacent files whose sums of absolute differences are kept for combined differencing
+            // Four pairs cover the two pairs either side of the current file and one further pair in each direction.
+            public const int SumsOfAbsoluteDifferencesWindowPairs = 4;
             public const int ThumbnailFallbackWidthInPixels = 200;
+            // largest translation between images, in pixels along each axis, searched for when compensating for camera shake
+            // Wind typically shakes pole mounted cameras by a few to a few tens of pixels.
+            public const int TranslationMaximumInPixels = 32;
+            // fraction by which a translation must reduce images' sum of absolute differences to be used rather than no translation
+            public const double TranslationMinimumImprovement = 0.05;
+            // rows sampled when refining translations at full resolution, spread evenly over the image's height
+            public const int TranslationSampledRows = 32;
+            // pairs of adjacent files whose translations are kept for differencing
+            public const int TranslationWindowPairs = 8;
+            // minimum read when parsing jpeg metadata beyond what's already been read from the file
+            public const int UnbufferedReadAheadSize = 4 * 4096;
+            // smallest array UnbufferedSequentialReader rents from the pool, which covers the metadata of most jpegs
+            public const int UnbufferedReadSegmentSize = 16 * 4096;
+            public const int VideoKeyframeStripFrames = 8;
+            public const int VideoKeyframeStripJpegQuality = 80;
 
             public static readonly TimeSpan DefaultHybridVideoLag = TimeSpan.FromSeconds(2.0);
             public static readonly TimeSpan MagnifierRotationTime = TimeSpan.FromMilliseconds(450);
@@ -457,6 +606,10 @@ namespace Carnassial
             public const string CarnassialWindowNoDeletableFiles = "CarnassialWindow.NoDeletableFiles";
             public const string CarnassialWindowNoMetadataAvailable = "CarnassialWindow.NoMetadataAvailable";
             public const string CarnassialWindowSelectFolder = "CarnassialWindow.SelectFolder";
+            public const string CarnassialWindowStatusBackgroundDifference = "CarnassialWindow.Status.BackgroundDifference";
+            public const string CarnassialWindowStatusBackgroundDifferenceCurrentNotLoadable = "CarnassialWindow.Status.BackgroundDifference.CurrentNotLoadable";
+            public const string CarnassialWindowStatusBackgroundDifferenceNotAvailable = "CarnassialWindow.Status.BackgroundDifference.NotAvailable";
+            public const string CarnassialWindowStatusBackgroundDifferenceNotCalculable = "CarnassialWindow.Status.BackgroundDifference.NotCalculable";
             public const string CarnassialWindowStatusCombinedDifference = "CarnassialWindow.Status.CombinedDifference";
             public const string CarnassialWindowStatusCombinedDifferenceCurrentNotLoadable = "CarnassialWindow.Status.CombinedDifference.CurrentNotLoadable";
             public const string CarnassialWindowStatusCombinedDifferenceNextNotAvailable = "CarnassialWindow.Status.CombinedDifference.NextNotAvailable";
@@ -640,6 +793,7 @@ namespace Carnassial
             public static readonly TimeSpan DesiredIntervalBetweenImageUpdates = TimeSpan.FromSeconds(5.0);
             public static readonly TimeSpan DesiredIntervalBetweenStatusUpdates = TimeSpan.FromMilliseconds(500);
             public static readonly TimeSpan PollIntervalForVideoLoad = TimeSpan.FromMilliseconds(1.0);
+            public static readonly TimeSpan PreviewRefinementDelay = TimeSpan.FromMilliseconds(150.0);
             public static readonly TimeSpan RenderingBackoffTime = TimeSpan.FromMilliseconds(25.0);
         }
 
@@ -4,10 +4,13 @@ using System;
 using System.Collections.Generic;
 using System.Diagnostics;
 using System.IO;
+using System.Linq;
+using System.Threading.Tasks;
 using System.Windows;
 using System.Windows.Controls;
 using System.Windows.Input;
 using System.Windows.Media;
+using System.Windows.Media.Imaging;
 using System.Windows.Shapes;
 
 namespace Carnassial.Control
@@ -16,6 +19,13 @@ namespace Carnassial.Control
     {
         private readonly ZoomBookmark bookmark;
 
+        // tiles of the displayed frame's pyramid overlaid on the display image, if the frame has a pyramid
+        // Tiles are shown only over the unaltered image the pyramid's frame was displayed with, so differences aren't obscured.
+        private readonly Dictionary<(int Level, int Column, int Row), Image> detailTiles;
+        private CachedImage? displayedImage;
+        private ImagePyramid? pyramid;
+        private CachedImage? pyramidImage;
+
         // the canvas to magnify contains both an image and markers so the magnifying glass view matches the display image
         private readonly Canvas magnifierCanvas;
 
@@ -29,6 +39,8 @@ namespace Carnassial.Control
         private readonly TranslateTransform displayImageTranslation;
 
         private readonly MagnifyingGlass magnifyingGlass;
+        // pixels of the image displayed in the magnifying glass, which the magnifying glass samples its lens from when it can
+        private MemoryImage? pixelsToMagnify;
 
         private List<Marker>? markers;
 
@@ -40,6 +52,11 @@ namespace Carnassial.Control
 
         public event EventHandler<MarkerCreatedOrDeletedEventArgs>? MarkerCreatedOrDeleted;
 
+        /// <summary>
+        /// Raised when the display image's zoom changes or the magnifying glass is enabled or disabled.
+        /// </summary>
+        public event EventHandler? ZoomChanged;
+
         /// <summary>
         /// Gets or sets the maximum zoom of the display image.
         /// </summary>
@@ -48,7 +65,12 @@ namespace Carnassial.Control
         public FileDisplayWithMarkers()
         {
             this.InitializeComponent();
+            this.detailTiles = [];
+            this.displayedImage = null;
             this.markers = [];
+            this.pixelsToMagnify = null;
+            this.pyramid = null;
+            this.pyramidImage = null;
             this.ResetMaximumZoom();
 
             // initialize render transforms
@@ -77,6 +99,7 @@ namespace Carnassial.Control
 
             // set up the magnifying glass
             this.magnifyingGlass = new MagnifyingGlass();
+            this.magnifyingGlass.TilesDecoded += this.MagnifyingGlass_TilesDecoded;
 
             Canvas.SetZIndex(this.magnifyingGlass, 1); // should always be on top
             this.DisplayCanvas.Children.Add(this.magnifyingGlass);
@@ -141,6 +164,15 @@ namespace Carnassial.Control
             }
         }
 
+        /// <summary>
+        /// Gets a value indicating whether the display image is shown larger than it fits, in which case it needs to be displayed at
+        /// full resolution.
+        /// </summary>
+        public bool IsMagnifiedOrZoomedIn
+        {
+            get { return this.MagnifyingGlassEnabled || (this.displayImageScale.ScaleX > Constant.ImageDisplay.ImageZoomMinimum); }
+        }
+
         /// <summary>
         /// Gets or sets a value indicating whether the magnifying glass is generally visible or hidden, and returns its state.
         /// </summary>
@@ -164,6 +196,7 @@ namespace Carnassial.Control
                 {
                     this.magnifyingGlass.Hide();
                 }
+                this.ZoomChanged?.Invoke(this, EventArgs.Empty);
             }
         }
 
@@ -298,6 +331,7 @@ namespace Carnassial.Control
         {
             this.bookmark.Apply(this.displayImageScale, this.displayImageTranslation);
             this.RedrawMarkers();
+            this.ZoomChanged?.Invoke(this, EventArgs.Empty);
         }
 
         private void CanvasToMagnify_SizeChanged(object sender, SizeChangedEventArgs e)
@@ -323,6 +357,9 @@ namespace Carnassial.Control
         public void Display(FileDisplayMessage message)
         {
             this.FileDisplay.Display(message);
+            this.displayedImage = null;
+            this.RedrawDetailTiles();
+            this.SetChangeHeatmap(null);
         }
 
         /// <summary>
@@ -331,6 +368,8 @@ namespace Carnassial.Control
         public void Display(CachedImage image)
         {
             this.FileDisplay.Display(image);
+            this.displayedImage = image;
+            this.RedrawDetailTiles();
         }
 
         /// <summary>
@@ -355,6 +394,7 @@ namespace Carnassial.Control
             // due to the need to expose a marker property but is mitigated by accepting new markers through this API and performing the set above as 
             // this.markers rather than this.Markers.
             image.Image?.SetSource(this.imageToMagnify);
+            this.pixelsToMagnify = image.Image;
 
             // change to new markers
             // Assign property so any existing markers are cleared.
@@ -385,11 +425,16 @@ namespace Carnassial.Control
                 // leave the magnifying glass's enabled state unchanged so user doesn't have to constantly keep re-enabling it in hybrid image sets
                 this.FileDisplay.Display(fileInfo);
                 this.markers = displayMarkers;
+                this.displayedImage = null;
+                this.SetChangeHeatmap(null);
+                this.SetPyramid(null, null);
             }
             else
             {
                 CachedImage? currentImage = imageCache.GetCurrentImage();
                 Debug.Assert(currentImage != null);
+                imageCache.TryGetCurrentPyramid(out ImagePyramid? pyramid);
+                this.SetPyramid(pyramid, currentImage);
                 this.Display(currentImage, displayMarkers);
             }
         }
@@ -452,8 +497,10 @@ namespace Carnassial.Control
 
         private void FileDisplayImage_SizeChanged(object sender, SizeChangedEventArgs e)
         {
-            // when the display image size changes refresh the markers so they appear in the correct place
+            // when the display image size changes refresh the markers, detail tiles, and heatmap so they appear in the correct place
             this.RedrawDisplayMarkers();
+            this.RedrawDetailTiles();
+            this.RedrawChangeHeatmap();
         }
 
         private void ImageToMagnify_SizeChanged(object sender, SizeChangedEventArgs e)
@@ -480,6 +527,12 @@ namespace Carnassial.Control
             this.MagnifyingGlassFieldOfView *= Constant.ImageDisplay.MagnifyingGlassFieldOfViewIncrement;
         }
 
+        // resample the lens once the pyramid tiles under it are available
+        private void MagnifyingGlass_TilesDecoded(object? sender, EventArgs e)
+        {
+            this.RedrawMagnifyingGlassIfVisible();
+        }
+
         // hide the magnifying glass when the mouse leaves the canvas
         private void MarkableCanvas_MouseLeave(object sender, MouseEventArgs e)
         {
@@ -555,6 +608,85 @@ namespace Carnassial.Control
             this.RedrawMarkers();
         }
 
+        private void RedrawChangeHeatmap()
+        {
+            // stretch the heatmap over the display image, following its zoom and pan
+            double imageHeight = this.FileDisplay.Image.ActualHeight;
+            double imageWidth = this.FileDisplay.Image.ActualWidth;
+            if ((this.ChangeHeatmap.Source == null) || (imageHeight <= 0.0) || (imageWidth <= 0.0))
+            {
+                return;
+            }
+
+            Point topLeft = this.FileDisplay.Image.TranslatePoint(new Point(0.0, 0.0), this.HeatmapCanvas);
+            Point bottomRight = this.FileDisplay.Image.TranslatePoint(new Point(imageWidth, imageHeight), this.HeatmapCanvas);
+            Canvas.SetLeft(this.ChangeHeatmap, topLeft.X);
+            Canvas.SetTop(this.ChangeHeatmap, topLeft.Y);
+            this.ChangeHeatmap.Height = bottomRight.Y - topLeft.Y;
+            this.ChangeHeatmap.Width = bottomRight.X - topLeft.X;
+        }
+
+        private void RedrawDetailTiles()
+        {
+            // find the pyramid tiles in view, if the display's zoomed in past the display image's resolution
+            // Tiles are taken from the coarsest pyramid level with at least one pixel per display pixel.
+            List<(int Level, int Column, int Row)> tilesInView = [];
+            ImagePyramid? pyramid = this.pyramid;
+            double imageHeight = this.FileDisplay.Image.ActualHeight;
+            double imageWidth = this.FileDisplay.Image.ActualWidth;
+            if ((pyramid != null) && (this.displayedImage != null) && (this.displayedImage == this.pyramidImage) && (this.displayedImage.Image != null) &&
+                (imageHeight > 0.0) && (imageWidth > 0.0))
+            {
+                double displayPixelsPerImagePixel = VisualTreeHelper.GetDpi(this).DpiScaleX * imageWidth * this.displayImageScale.ScaleX / pyramid.PixelWidth;
+                int level = pyramid.GetLevel(displayPixelsPerImagePixel);
+                if (pyramid.GetLevelWidth(level) > this.displayedImage.Image.PixelWidth)
+                {
+                    Rect visibleRegion = this.DetailCanvas.TransformToVisual(this.FileDisplay.Image).TransformBounds(new Rect(this.DetailCanvas.RenderSize));
+                    visibleRegion.Intersect(new Rect(0.0, 0.0, imageWidth, imageHeight));
+                    if (visibleRegion.IsEmpty == false)
+                    {
+                        tilesInView = pyramid.GetTiles(level, new Rect(visibleRegion.X / imageWidth, visibleRegion.Y / imageHeight, visibleRegion.Width / imageWidth, visibleRegion.Height / imageHeight));
+                    }
+                }
+            }
+
+            // remove tiles which are no longer in view
+            foreach ((int Level, int Column, int Row) tile in this.detailTiles.Keys.Except(tilesInView).ToList())
+            {
+                this.DetailCanvas.Children.Remove(this.detailTiles[tile]);
+                this.detailTiles.Remove(tile);
+            }
+            if (pyramid == null)
+            {
+                return;
+            }
+
+            // position tiles over the display image, starting decodes of tiles newly in view
+            foreach ((int Level, int Column, int Row) tile in tilesInView)
+            {
+                if (this.detailTiles.TryGetValue(tile, out Image? tileImage) == false)
+                {
+                    tileImage = new Image()
+                    {
+                        Stretch = Stretch.Fill
+                    };
+                    this.detailTiles.Add(tile, tileImage);
+                    this.DetailCanvas.Children.Add(tileImage);
+                    _ = this.SetDetailTileSourceAsync(pyramid, tile, tileImage);
+                }
+
+                Int32Rect bounds = pyramid.GetTileBounds(tile.Level, tile.Column, tile.Row);
+                double imagePixelsPerLevelPixelX = imageWidth / pyramid.GetLevelWidth(tile.Level);
+                double imagePixelsPerLevelPixelY = imageHeight / pyramid.GetLevelHeight(tile.Level);
+                Point topLeft = this.FileDisplay.Image.TranslatePoint(new Point(imagePixelsPerLevelPixelX * bounds.X, imagePixelsPerLevelPixelY * bounds.Y), this.DetailCanvas);
+                Point bottomRight = this.FileDisplay.Image.TranslatePoint(new Point(imagePixelsPerLevelPixelX * (bounds.X + bounds.Width), imagePixelsPerLevelPixelY * (bounds.Y + bounds.Height)), this.DetailCanvas);
+                Canvas.SetLeft(tileImage, topLeft.X);
+                Canvas.SetTop(tileImage, topLeft.Y);
+                tileImage.Height = bottomRight.Y - topLeft.Y;
+                tileImage.Width = bottomRight.X - topLeft.X;
+            }
+        }
+
         private void RedrawMagnifyingGlassIfVisible()
         {
             // nothing to magnify
@@ -574,7 +706,9 @@ namespace Carnassial.Control
             }
 
             // update magnifier's view of the image to magnify and position for current mouse location
-            this.magnifyingGlass.RedrawIfVisible(this.magnifierCanvas, this.FileDisplay.Image, mouseImagePosition);
+            // As with detail tiles, the pyramid's used only for the unaltered image its frame was displayed with.
+            ImagePyramid? pyramidToMagnify = (this.displayedImage != null) && (this.displayedImage == this.pyramidImage) ? this.pyramid : null;
+            this.magnifyingGlass.RedrawIfVisible(this.magnifierCanvas, this.imageToMagnify, this.pixelsToMagnify, pyramidToMagnify, this.FileDisplay.Image, mouseImagePosition);
         }
 
         /// <summary>
@@ -584,6 +718,8 @@ namespace Carnassial.Control
         {
             this.RedrawDisplayMarkers();
             this.RedrawMagnifierMarkers();
+            this.RedrawDetailTiles();
+            this.RedrawChangeHeatmap();
         }
 
         private void RedrawDisplayMarkers()
@@ -659,6 +795,53 @@ namespace Carnassial.Control
 
                 this.RedrawMarkers();
             }
+            this.ZoomChanged?.Invoke(this, EventArgs.Empty);
+        }
+
+        /// <summary>
+        /// Overlay a heatmap of where the displayed file changed, such as from <see cref="BlockChangeMap.GetHeatmap(byte)"/>, or
+        /// remove the overlay if the heatmap's null.
+        /// </summary>
+        public void SetChangeHeatmap(BitmapSource? heatmap)
+        {
+            this.ChangeHeatmap.Source = heatmap;
+            this.ChangeHeatmap.Visibility = heatmap != null ? Visibility.Visible : Visibility.Collapsed;
+            this.RedrawChangeHeatmap();
+        }
+
+        private async Task SetDetailTileSourceAsync(ImagePyramid pyramid, (int Level, int Column, int Row) tile, Image tileImage)
+        {
+            // decode the tile off the UI thread if it's not already cached
+            if (pyramid.TryGetTile(tile.Level, tile.Column, tile.Row, out MemoryImage? tilePixels) == false)
+            {
+                try
+                {
+                    tilePixels = await Task.Run(() => pyramid.GetTile(tile.Level, tile.Column, tile.Row)).ConfigureAwait(true);
+                }
+                catch (ArgumentException)
+                {
+                    // jpeg's been truncated or otherwise can't be decoded, so the display image is left uncovered
+                    return;
+                }
+            }
+
+            // the tile may have moved out of view or the file may have changed while it was being decoded
+            if (this.detailTiles.TryGetValue(tile, out Image? currentTileImage) && (currentTileImage == tileImage))
+            {
+                tileImage.Source = tilePixels.AsBitmapSource();
+            }
+        }
+
+        // change to a new frame's pyramid, removing the previous frame's tiles
+        private void SetPyramid(ImagePyramid? pyramid, CachedImage? pyramidImage)
+        {
+            if (this.pyramid != pyramid)
+            {
+                this.DetailCanvas.Children.Clear();
+                this.detailTiles.Clear();
+                this.pyramid = pyramid;
+            }
+            this.pyramidImage = pyramid != null ? pyramidImage : null;
         }
 
         public void SetBookmark()
@@ -737,6 +920,7 @@ namespace Carnassial.Control
             this.displayImageTranslation.X = 0.0;
             this.displayImageTranslation.Y = 0.0;
             this.RedrawMarkers();
+            this.ZoomChanged?.Invoke(this, EventArgs.Empty);
         }
     }
 }
@@ -6,6 +6,7 @@ using System.Collections.Generic;
 using System.Data.SQLite;
 using System.Diagnostics;
 using System.Globalization;
+using System.Linq;
 
 namespace Carnassial.Data
 {
@@ -65,7 +66,10 @@ namespace Carnassial.Data
                 dataLabelsConcatenated = $", {String.Join(", ", userControlDataLabels)}";
                 defaultValuesConcatenated = $", {String.Join(", ", userControlDefaultValues)}";
             }
-            string fileInsertText = String.Create(CultureInfo.InvariantCulture, $"INSERT INTO {Constant.DatabaseTable.Files} ({Constant.FileColumn.DateTime}, {Constant.FileColumn.DeleteFlag}, {Constant.FileColumn.File}, {Constant.FileColumn.Classification}, {Constant.FileColumn.RelativePath}, {Constant.FileColumn.UtcOffset}{dataLabelsConcatenated}) VALUES (@DateTime, {deleteFlagDefaultValue}, @FileName, @Classification, @RelativePath, @UtcOffset{defaultValuesConcatenated})");
+            // image statistics are parameterized as they're calculated while files are added
+            string imageStatisticsColumnsConcatenated = String.Join(", ", Constant.FileColumn.ImageStatistics);
+            string imageStatisticsParametersConcatenated = String.Join(", ", Constant.FileColumn.ImageStatistics.Select(column => "@" + column));
+            string fileInsertText = String.Create(CultureInfo.InvariantCulture, $"INSERT INTO {Constant.DatabaseTable.Files} ({Constant.FileColumn.DateTime}, {Constant.FileColumn.DeleteFlag}, {Constant.FileColumn.File}, {Constant.FileColumn.Classification}, {Constant.FileColumn.RelativePath}, {Constant.FileColumn.UtcOffset}, {imageStatisticsColumnsConcatenated}{dataLabelsConcatenated}) VALUES (@DateTime, {deleteFlagDefaultValue}, @FileName, @Classification, @RelativePath, @UtcOffset, {imageStatisticsParametersConcatenated}{defaultValuesConcatenated})");
 
             this.Transaction = this.Database.Connection.BeginTransaction();
             this.addFiles = new SQLiteCommand(fileInsertText, this.Database.Connection, this.Transaction);
@@ -75,10 +79,15 @@ namespace Carnassial.Data
             this.addFiles.Parameters.Add(new SQLiteParameter("@FileName"));
             this.addFiles.Parameters.Add(new SQLiteParameter("@RelativePath"));
             this.addFiles.Parameters.Add(new SQLiteParameter("@UtcOffset"));
+            foreach (string column in Constant.FileColumn.ImageStatistics)
+            {
+                this.addFiles.Parameters.Add(new SQLiteParameter("@" + column));
+            }
         }
 
         /// <summary>
-        /// Inserts files in the file table with their name, relative path, date time offset, and classification populated.
+        /// Inserts files in the file table with their name, relative path, date time offset, classification, and image statistics
+        /// populated.
         /// Other fields are set to their default values.
         /// </summary>
         public override int AddToSequence(IList<FileLoad> files, int offset, int length)
@@ -110,6 +119,10 @@ namespace Carnassial.Data
                 this.addFiles.Parameters[2].Value = file.FileName;
                 this.addFiles.Parameters[3].Value = file.RelativePath;
                 this.addFiles.Parameters[4].Value = DateTimeHandler.ToDatabaseUtcOffset(file.UtcOffset);
+                for (int statistic = 0; statistic < Constant.FileColumn.ImageStatistics.Count; ++statistic)
+                {
+                    this.addFiles.Parameters[5 + statistic].Value = file.GetDatabaseValue(Constant.FileColumn.ImageStatistics[statistic]);
+                }
 
                 this.addFiles.ExecuteNonQuery();
                 file.AcceptChanges();
@@ -1,4 +1,5 @@
 ﻿using Carnassial.Images;
+using System;
 
 namespace Carnassial.Data
 {
@@ -13,12 +14,27 @@ namespace Carnassial.Data
         public bool FileNoLongerAvailable { get; set; }
         public MemoryImage? Image { get; private set; }
         public bool ImageNotDecodable { get; set; }
+        public ImageResolution Resolution { get; set; }
 
         public CachedImage()
         {
             this.FileNoLongerAvailable = false;
             this.Image = null;
             this.ImageNotDecodable = false;
+            this.Resolution = ImageResolution.Full;
+        }
+
+        // decoded at 1/8 scale for display during rapid navigation or until a higher resolution image is decoded
+        public bool IsPreview
+        {
+            get { return this.Resolution == ImageResolution.Preview; }
+        }
+
+        // approximate memory used by the image
+        // Images which couldn't be loaded are given a nominal size so caches can account for them.
+        public long SizeInBytes
+        {
+            get { return this.Image != null ? Math.Max(this.Image.SizeInBytes, Constant.Images.CachedImageMinimumSizeInBytes) : Constant.Images.CachedImageMinimumSizeInBytes; }
         }
 
         public CachedImage(MemoryImage image)
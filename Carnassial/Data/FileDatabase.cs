@@ -1,14 +1,17 @@
 ﻿using Carnassial.Control;
 using Carnassial.Database;
+using Carnassial.Images;
 using Carnassial.Interop;
 using Carnassial.Util;
 using System;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.Data.SQLite;
 using System.Diagnostics;
 using System.Globalization;
 using System.IO;
 using System.Linq;
+using System.Runtime.InteropServices;
 using System.Text;
 using ColumnDefinition = Carnassial.Database.ColumnDefinition;
 
@@ -17,6 +20,8 @@ namespace Carnassial.Data
     public class FileDatabase : TemplateDatabase
     {
         public AutocompletionCache AutocompletionCache { get; private init; }
+        // backgrounds by the relative path of the folder containing their images
+        public ConcurrentDictionary<string, BackgroundModel> Backgrounds { get; private init; }
         public List<string> ControlSynchronizationIssues { get; private init; }
         public CustomSelection? CustomSelection { get; set; }
 
@@ -29,6 +34,7 @@ namespace Carnassial.Data
             : base(filePath)
         {
             this.AutocompletionCache = new AutocompletionCache(this);
+            this.Backgrounds = new(StringComparer.OrdinalIgnoreCase);
             this.ControlSynchronizationIssues = [];
             this.FileName = Path.GetFileName(filePath);
             this.Files = new FileTable();
@@ -121,6 +127,33 @@ namespace Carnassial.Data
             return new AddFilesTransactionSequence(this, this.Controls);
         }
 
+        private static SQLiteTableSchema CreateBackgroundTableSchema()
+        {
+            SQLiteTableSchema schema = new(Constant.DatabaseTable.Backgrounds);
+            schema.ColumnDefinitions.Add(ColumnDefinition.CreatePrimaryKey());
+            schema.ColumnDefinitions.Add(new ColumnDefinition(Constant.BackgroundColumn.RelativePath, Constant.SQLiteAffinity.Text)
+            {
+                NotNull = true
+            });
+            schema.ColumnDefinitions.Add(new ColumnDefinition(Constant.BackgroundColumn.PixelWidth, Constant.SQLiteAffinity.Integer)
+            {
+                NotNull = true
+            });
+            schema.ColumnDefinitions.Add(new ColumnDefinition(Constant.BackgroundColumn.PixelHeight, Constant.SQLiteAffinity.Integer)
+            {
+                NotNull = true
+            });
+            schema.ColumnDefinitions.Add(new ColumnDefinition(Constant.BackgroundColumn.Frames, Constant.SQLiteAffinity.Integer)
+            {
+                NotNull = true
+            });
+            schema.ColumnDefinitions.Add(new ColumnDefinition(Constant.BackgroundColumn.Mean, Constant.SQLiteAffinity.Blob)
+            {
+                NotNull = true
+            });
+            return schema;
+        }
+
         public FileTransactionSequence CreateInsertFileTransaction()
         {
             return FileTransactionSequence.CreateInsert(this, this.Files);
@@ -438,6 +471,21 @@ namespace Carnassial.Data
             return (fileIndex >= 0) && (fileIndex < this.CurrentlySelectedFileCount);
         }
 
+        private void LoadBackgrounds()
+        {
+            this.Backgrounds.Clear();
+
+            using SQLiteCommand command = new($"SELECT {Constant.BackgroundColumn.RelativePath}, {Constant.BackgroundColumn.PixelWidth}, {Constant.BackgroundColumn.PixelHeight}, {Constant.BackgroundColumn.Frames}, {Constant.BackgroundColumn.Mean} FROM {Constant.DatabaseTable.Backgrounds}", this.Connection);
+            using SQLiteDataReader reader = command.ExecuteReader();
+            while (reader.Read())
+            {
+                string relativePath = reader.GetString(0);
+                byte[] meanBytes = (byte[])reader.GetValue(4);
+                Int16[] mean = MemoryMarshal.Cast<byte, Int16>(meanBytes).ToArray();
+                this.Backgrounds[relativePath] = new BackgroundModel(relativePath, reader.GetInt32(1), reader.GetInt32(2), reader.GetInt32(3), mean);
+            }
+        }
+
         public List<string> MoveSelectedFilesToFolder(string destinationFolderPath)
         {
             Debug.Assert(destinationFolderPath.StartsWith(this.FolderPath, StringComparison.OrdinalIgnoreCase), String.Create(CultureInfo.InvariantCulture, $"Destination path '{destinationFolderPath}' is not under '{this.FolderPath}'."));
@@ -478,6 +526,7 @@ namespace Carnassial.Data
             using (SQLiteTransaction transaction = this.Connection.BeginTransaction())
             {
                 fileTableSchema.CreateTableAndIndicies(this.Connection, transaction);
+                FileDatabase.CreateBackgroundTableSchema().CreateTableAndIndicies(this.Connection, transaction);
                 transaction.Commit();
             }
 
@@ -656,6 +705,39 @@ namespace Carnassial.Data
                 this.GetControlsSortedByControlOrder();
             }
 
+            // add image statistics columns to databases created before statistics were calculated
+            // Statistics don't depend on controls so, unlike control columns, they're added regardless of synchronization issues.
+            // Files already in the database have null statistics.
+            SQLiteTableSchema fileTableSchema = this.GetTableSchema(Constant.DatabaseTable.Files);
+            List<ColumnDefinition> imageStatisticsColumnsToAdd = FileTable.CreateImageStatisticsColumnDefinitions().Where(statisticsColumn => fileTableSchema.ColumnDefinitions.Any(column => String.Equals(column.Name, statisticsColumn.Name, StringComparison.Ordinal)) == false).ToList();
+            if (imageStatisticsColumnsToAdd.Count > 0)
+            {
+                using SQLiteTransaction transaction = this.Connection.BeginTransaction();
+                int columnNumber = fileTableSchema.ColumnDefinitions.Count;
+                foreach (ColumnDefinition columnToAdd in imageStatisticsColumnsToAdd)
+                {
+                    this.AddColumnToTable(transaction, Constant.DatabaseTable.Files, columnNumber++, columnToAdd);
+                    if (String.Equals(columnToAdd.Name, Constant.FileColumn.ChangeScore, StringComparison.Ordinal))
+                    {
+                        SecondaryIndex.CreateFileTableIndex(Constant.FileColumn.ChangeScore).Create(this.Connection, transaction);
+                    }
+                }
+                transaction.Commit();
+            }
+
+            // add the backgrounds table to databases created before backgrounds were modeled
+            // Backgrounds of folders whose files were added before then remain unavailable until more files are added to them.
+            if (this.GetTableNames().Contains(Constant.DatabaseTable.Backgrounds, StringComparer.Ordinal))
+            {
+                this.LoadBackgrounds();
+            }
+            else
+            {
+                using SQLiteTransaction transaction = this.Connection.BeginTransaction();
+                FileDatabase.CreateBackgroundTableSchema().CreateTableAndIndicies(this.Connection, transaction);
+                transaction.Commit();
+            }
+
             // index user controls
             // This is needed in the normal case of no synchronization issues and also when the user chooses to run with the
             // existing controls table to avoid synchronization issues.
@@ -735,6 +817,44 @@ namespace Carnassial.Data
             // Trace.WriteLine(stopwatch.Elapsed.ToString("s\\.fffffff", CultureInfo.CurrentCulture));
         }
 
+        /// <summary>
+        /// Replace the backgrounds in the database with those in <see cref="Backgrounds"/>.
+        /// </summary>
+        public void SyncBackgroundsToDatabase()
+        {
+            using SQLiteTransaction transaction = this.Connection.BeginTransaction();
+            using (SQLiteCommand deleteBackgrounds = new($"DELETE FROM {Constant.DatabaseTable.Backgrounds}", this.Connection, transaction))
+            {
+                deleteBackgrounds.ExecuteNonQuery();
+            }
+
+            using (SQLiteCommand insertBackground = new($"INSERT INTO {Constant.DatabaseTable.Backgrounds} ({Constant.BackgroundColumn.RelativePath}, {Constant.BackgroundColumn.PixelWidth}, {Constant.BackgroundColumn.PixelHeight}, {Constant.BackgroundColumn.Frames}, {Constant.BackgroundColumn.Mean}) VALUES (@{Constant.BackgroundColumn.RelativePath}, @{Constant.BackgroundColumn.PixelWidth}, @{Constant.BackgroundColumn.PixelHeight}, @{Constant.BackgroundColumn.Frames}, @{Constant.BackgroundColumn.Mean})", this.Connection, transaction))
+            {
+                insertBackground.Parameters.Add(new SQLiteParameter($"@{Constant.BackgroundColumn.RelativePath}"));
+                insertBackground.Parameters.Add(new SQLiteParameter($"@{Constant.BackgroundColumn.PixelWidth}"));
+                insertBackground.Parameters.Add(new SQLiteParameter($"@{Constant.BackgroundColumn.PixelHeight}"));
+                insertBackground.Parameters.Add(new SQLiteParameter($"@{Constant.BackgroundColumn.Frames}"));
+                insertBackground.Parameters.Add(new SQLiteParameter($"@{Constant.BackgroundColumn.Mean}"));
+                foreach (BackgroundModel background in this.Backgrounds.Values)
+                {
+                    // snapshot the mean and frame count together in case files are still being added to the background
+                    (int frames, byte[] mean) = background.GetSnapshot();
+                    if (frames < 1)
+                    {
+                        continue;
+                    }
+
+                    insertBackground.Parameters[0].Value = background.RelativePath;
+                    insertBackground.Parameters[1].Value = background.PixelWidth;
+                    insertBackground.Parameters[2].Value = background.PixelHeight;
+                    insertBackground.Parameters[3].Value = frames;
+                    insertBackground.Parameters[4].Value = mean;
+                    insertBackground.ExecuteNonQuery();
+                }
+            }
+            transaction.Commit();
+        }
+
         public static bool TryCreateOrOpen(string filePath, TemplateDatabase templateDatabase, bool orderFilesByDate, LogicalOperator customSelectionTermCombiningOperator, out FileDatabase fileDatabase)
         {
             // check for an existing database before instantiating the databse as SQL wrapper instantiation creates the database file
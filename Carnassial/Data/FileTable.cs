@@ -46,28 +46,40 @@ namespace Carnassial.Data
                     schema.Indices.Add(SecondaryIndex.CreateFileTableIndex(control));
                 }
             }
+            schema.ColumnDefinitions.AddRange(FileTable.CreateImageStatisticsColumnDefinitions());
+            // change scores are indexed so files can be sorted or selected by how much they differ from their folders' backgrounds
+            schema.Indices.Add(SecondaryIndex.CreateFileTableIndex(Constant.FileColumn.ChangeScore));
 
             return schema;
         }
 
+        public void AppendFile(ImageRow file)
+        {
+            this.Rows.Add(file);
+        }
+
         public ImageRow CreateAndAppendFile(string fileName, string relativePath)
         {
-            ImageRow file;
+            ImageRow file = this.CreateFile(fileName, relativePath);
+            this.Rows.Add(file);
+            return file;
+        }
+
+        /// <summary>
+        /// Creates a file belonging to this table without adding it to the table. Thread safe, so files can be created in parallel
+        /// and then added with <see cref="AppendFile(ImageRow)"/>.
+        /// </summary>
+        public ImageRow CreateFile(string fileName, string relativePath)
+        {
             if (FileTable.IsVideo(fileName))
             {
-                file = new VideoRow(fileName, relativePath, this);
+                return new VideoRow(fileName, relativePath, this);
             }
-            else if (JpegImage.IsJpeg(fileName))
+            if (JpegImage.IsJpeg(fileName))
             {
-                file = new ImageRow(fileName, relativePath, this);
+                return new ImageRow(fileName, relativePath, this);
             }
-            else
-            {
-                throw new NotSupportedException($"Unhandled extension for file '{fileName}'.");
-            }
-
-            this.Rows.Add(file);
-            return file;
+            throw new NotSupportedException($"Unhandled extension for file '{fileName}'.");
         }
 
         public static IEnumerable<ColumnDefinition> CreateFileTableColumnDefinitions(ControlRow control)
@@ -134,6 +146,22 @@ namespace Carnassial.Data
             }
         }
 
+        // image statistics aren't associated with controls and are null until calculated, so have no defaults
+        public static IEnumerable<ColumnDefinition> CreateImageStatisticsColumnDefinitions()
+        {
+            foreach (string column in Constant.FileColumn.ImageStatistics)
+            {
+                if (String.Equals(column, Constant.FileColumn.LuminosityHistogram, StringComparison.Ordinal))
+                {
+                    yield return new ColumnDefinition(column, Constant.SQLiteAffinity.Blob);
+                }
+                else
+                {
+                    yield return new ColumnDefinition(column, Constant.SQLiteAffinity.Real);
+                }
+            }
+        }
+
         public Dictionary<string, Dictionary<string, ImageRow>> GetFilesByRelativePathAndName()
         {
             Dictionary<string, Dictionary<string, ImageRow>> filesByRelativePathAndName = new(StringComparer.OrdinalIgnoreCase);
@@ -209,6 +237,15 @@ namespace Carnassial.Data
             int relativePathIndex = -1;
             int utcOffsetIndex = -1;
 
+            int changeScoreIndex = -1;
+            int highlightClippingIndex = -1;
+            int luminosityHistogramIndex = -1;
+            int luminosityPercentile5Index = -1;
+            int luminosityPercentile50Index = -1;
+            int luminosityPercentile95Index = -1;
+            int shadowClippingIndex = -1;
+            int sharpnessIndex = -1;
+
             int userCounter = -1;
             int[] userCounterSqlIndices = new int[this.UserCounters];
             int userFlag = -1;
@@ -244,6 +281,30 @@ namespace Carnassial.Data
                     case Constant.FileColumn.UtcOffset:
                         utcOffsetIndex = columnIndex;
                         break;
+                    case Constant.FileColumn.ChangeScore:
+                        changeScoreIndex = columnIndex;
+                        break;
+                    case Constant.FileColumn.HighlightClipping:
+                        highlightClippingIndex = columnIndex;
+                        break;
+                    case Constant.FileColumn.LuminosityHistogram:
+                        luminosityHistogramIndex = columnIndex;
+                        break;
+                    case Constant.FileColumn.LuminosityPercentile5:
+                        luminosityPercentile5Index = columnIndex;
+                        break;
+                    case Constant.FileColumn.LuminosityPercentile50:
+                        luminosityPercentile50Index = columnIndex;
+                        break;
+                    case Constant.FileColumn.LuminosityPercentile95:
+                        luminosityPercentile95Index = columnIndex;
+                        break;
+                    case Constant.FileColumn.ShadowClipping:
+                        shadowClippingIndex = columnIndex;
+                        break;
+                    case Constant.FileColumn.Sharpness:
+                        sharpnessIndex = columnIndex;
+                        break;
                     default:
                         FileTableColumn userColumn = this.UserColumnsByName[column];
                         int dataIndex;
@@ -284,6 +345,14 @@ namespace Carnassial.Data
             {
                 throw new SQLiteException(SQLiteErrorCode.Schema, $"At least one standard column is missing from table {reader.GetTableName(0)}.");
             }
+            // image statistics are optional as they're absent from databases created by earlier Carnassial versions
+            bool allImageStatisticsColumnsPresent = (highlightClippingIndex != -1) &&
+                                                    (luminosityHistogramIndex != -1) &&
+                                                    (luminosityPercentile5Index != -1) &&
+                                                    (luminosityPercentile50Index != -1) &&
+                                                    (luminosityPercentile95Index != -1) &&
+                                                    (shadowClippingIndex != -1) &&
+                                                    (sharpnessIndex != -1);
 
             this.Rows.Clear();
 
@@ -303,6 +372,21 @@ namespace Carnassial.Data
                 file.DateTimeOffset = DateTimeHandler.FromDatabaseDateTimeOffset(reader.GetDateTime(dateTimeIndex), DateTimeHandler.FromDatabaseUtcOffset(utcOffset));
                 file.DeleteFlag = reader.GetBoolean(deleteFlagIndex);
                 file.ID = reader.GetInt64(idIndex);
+                if (allImageStatisticsColumnsPresent && (reader.IsDBNull(sharpnessIndex) == false))
+                {
+                    // statistics are written together, so a non-null sharpness implies the other columns are also non-null
+                    file.Statistics = new ImageStatistics(reader.GetDouble(highlightClippingIndex),
+                                                          ImageStatistics.GetLuminosityHistogram((byte[])reader.GetValue(luminosityHistogramIndex)),
+                                                          reader.GetDouble(luminosityPercentile5Index),
+                                                          reader.GetDouble(luminosityPercentile50Index),
+                                                          reader.GetDouble(luminosityPercentile95Index),
+                                                          reader.GetDouble(shadowClippingIndex),
+                                                          reader.GetDouble(sharpnessIndex));
+                }
+                if ((changeScoreIndex != -1) && (reader.IsDBNull(changeScoreIndex) == false))
+                {
+                    file.ChangeScore = reader.GetDouble(changeScoreIndex);
+                }
                 foreach (FileTableColumn userColumn in this.UserColumnsByName.Values)
                 {
                     switch (userColumn.DataType)
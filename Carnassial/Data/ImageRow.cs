@@ -13,6 +13,7 @@ using System.Diagnostics;
 using System.Globalization;
 using System.IO;
 using System.Linq;
+using System.Threading;
 using System.Threading.Tasks;
 using MetadataDirectory = MetadataExtractor.Directory;
 
@@ -23,11 +24,13 @@ namespace Carnassial.Data
     /// </summary>
     public class ImageRow : SQLiteRow, INotifyPropertyChanged
     {
+        private double? changeScore;
         private FileClassification classification;
         private DateTimeOffset dateTimeOffset;
         private bool deleteFlag;
         private string fileName;
         private string relativePath;
+        private ImageStatistics? statistics;
         private readonly FileTable table;
 
         public int[] UserCounters { get; private init; }
@@ -42,6 +45,7 @@ namespace Carnassial.Data
             this.deleteFlag = false;
             this.fileName = fileName;
             this.relativePath = relativePath;
+            this.statistics = null;
             this.table = table;
             this.UserCounters = new int[table.UserCounters];
             this.UserFlags = new bool[table.UserFlags];
@@ -49,6 +53,24 @@ namespace Carnassial.Data
             this.UserNotesAndChoices = new string[table.UserNotesAndChoices];
         }
 
+        // fraction of the image's thumbnail which differs from its folder's background when the image was added
+        public double? ChangeScore
+        {
+            get
+            {
+                return this.changeScore;
+            }
+            set
+            {
+                if (this.changeScore == value)
+                {
+                    return;
+                }
+                this.HasChanges |= true;
+                this.changeScore = value;
+            }
+        }
+
         public FileClassification Classification
         {
             get
@@ -150,6 +172,23 @@ namespace Carnassial.Data
             }
         }
 
+        public ImageStatistics? Statistics
+        {
+            get
+            {
+                return this.statistics;
+            }
+            set
+            {
+                if (Object.ReferenceEquals(this.statistics, value))
+                {
+                    return;
+                }
+                this.HasChanges |= true;
+                this.statistics = value;
+            }
+        }
+
         public object this[string propertyName]
         {
             get
@@ -277,6 +316,23 @@ namespace Carnassial.Data
             return currentValue.SequenceEqual(newValue);
         }
 
+        /// <summary>
+        /// Decode a jpeg previously read with <see cref="TryReadJpegAsync(string, CancellationToken)"/>.
+        /// </summary>
+        public static CachedImage DecodeJpeg(byte[] jpeg, int? expectedDisplayWidthInPixels)
+        {
+            if (jpeg.Length < Constant.Images.SmallestValidJpegSizeInBytes)
+            {
+                return new CachedImage()
+                {
+                    ImageNotDecodable = true
+                };
+            }
+
+            MemoryImage image = new(jpeg, expectedDisplayWidthInPixels);
+            return new CachedImage(image);
+        }
+
         public object? GetDatabaseValue(string dataLabel)
         {
             switch (dataLabel)
@@ -297,6 +353,20 @@ namespace Carnassial.Data
                     return this.RelativePath;
                 case Constant.FileColumn.UtcOffset:
                     return DateTimeHandler.ToDatabaseUtcOffset(this.UtcOffset);
+                case Constant.FileColumn.ChangeScore:
+                    return this.ChangeScore.HasValue ? this.ChangeScore.Value : DBNull.Value;
+                case Constant.FileColumn.HighlightClipping:
+                case Constant.FileColumn.LuminosityHistogram:
+                case Constant.FileColumn.LuminosityPercentile5:
+                case Constant.FileColumn.LuminosityPercentile50:
+                case Constant.FileColumn.LuminosityPercentile95:
+                case Constant.FileColumn.ShadowClipping:
+                case Constant.FileColumn.Sharpness:
+                    if (this.Statistics == null)
+                    {
+                        return DBNull.Value;
+                    }
+                    return this.Statistics.GetDatabaseValue(dataLabel);
                 default:
                     FileTableColumn userColumn = this.table.UserColumnsByName[dataLabel];
                     return userColumn.DataType switch
@@ -885,14 +955,22 @@ namespace Carnassial.Data
         }
 
         public async virtual Task<CachedImage> TryLoadImageAsync(string imageSetFolderPath, int? expectedDisplayWidthInPixels)
+        {
+            return await this.TryLoadImageAsync(imageSetFolderPath, expectedDisplayWidthInPixels, CancellationToken.None).ConfigureAwait(true);
+        }
+
+        /// <summary>
+        /// Load a jpeg, stopping early if cancelled. Unlike the other overloads this doesn't load the first frames of videos.
+        /// </summary>
+        public async Task<CachedImage> TryLoadImageAsync(string imageSetFolderPath, int? expectedDisplayWidthInPixels, CancellationToken cancellationToken)
         {
             // 8MP average performance (n ~= 200), milliseconds
             // scale factor  1.0  1/2   1/4    1/8
             //               110  76.3  55.9   46.1
             // Stopwatch stopwatch = new Stopwatch();
             // stopwatch.Start();
-            FileInfo jpeg = this.GetFileInfo(imageSetFolderPath);
-            if (jpeg.Exists == false)
+            byte[]? jpeg = await this.TryReadJpegAsync(imageSetFolderPath, cancellationToken).ConfigureAwait(true);
+            if (jpeg == null)
             {
                 return new CachedImage()
                 {
@@ -900,21 +978,10 @@ namespace Carnassial.Data
                 };
             }
 
-            using FileStream stream = new(jpeg.FullName, FileMode.Open, FileAccess.Read, FileShare.Read, Constant.File.JpgPixelReadBufferSizeInBytes, FileOptions.Asynchronous | FileOptions.SequentialScan);
-            if (stream.Length < Constant.Images.SmallestValidJpegSizeInBytes)
-            {
-                return new CachedImage()
-                {
-                    ImageNotDecodable = true
-                };
-            }
-
-            byte[] buffer = new byte[stream.Length];
-            await stream.ReadExactlyAsync(buffer.AsMemory(0, buffer.Length)).ConfigureAwait(true);
-            MemoryImage image = new(buffer, expectedDisplayWidthInPixels);
+            CachedImage image = ImageRow.DecodeJpeg(jpeg, expectedDisplayWidthInPixels);
             // stopwatch.Stop();
             // Trace.WriteLine(stopwatch.Elapsed.ToString("s\\.fffffff"));
-            return new CachedImage(image);
+            return image;
         }
 
         public bool TryMoveFileToFolder(string imageSetFolderPath, string destinationFolderPath)
@@ -1051,5 +1118,32 @@ namespace Carnassial.Data
                 throw new NotSupportedException($"Unhandled DateTimeOriginal type {dateTimeOriginalAsObject.GetType()}.");
             }
         }
+
+        /// <summary>
+        /// Read a jpeg's bytes without decoding them, stopping early if cancelled.
+        /// </summary>
+        /// <returns>null if the file no longer exists.</returns>
+        public async Task<byte[]?> TryReadJpegAsync(string imageSetFolderPath, CancellationToken cancellationToken)
+        {
+            Debug.Assert(this.IsVideo == false, "Videos can't be loaded as jpegs.");
+
+            FileInfo jpeg = this.GetFileInfo(imageSetFolderPath);
+            if (jpeg.Exists == false)
+            {
+                return null;
+            }
+
+            using FileStream stream = new(jpeg.FullName, FileMode.Open, FileAccess.Read, FileShare.Read, Constant.File.JpgPixelReadBufferSizeInBytes, FileOptions.Asynchronous | FileOptions.SequentialScan);
+            if (stream.Length < Constant.Images.SmallestValidJpegSizeInBytes)
+            {
+                // too short to decode, so there's no need to read it
+                return Array.Empty<byte>();
+            }
+
+            byte[] buffer = new byte[stream.Length];
+            await stream.ReadExactlyAsync(buffer.AsMemory(0, buffer.Length), cancellationToken).ConfigureAwait(true);
+            cancellationToken.ThrowIfCancellationRequested();
+            return buffer;
+        }
     }
 }
@@ -1,4 +1,7 @@
-﻿using System;
+﻿using Carnassial.Images;
+using System;
+using System.Diagnostics.CodeAnalysis;
+using System.IO;
 using System.Threading.Tasks;
 
 namespace Carnassial.Data
@@ -20,11 +23,69 @@ namespace Carnassial.Data
             }
         }
 
+        public bool TryGetKeyframeStrip(string imageSetFolderPath, int frames, [NotNullWhen(true)] out VideoKeyframeStrip? keyframeStrip)
+        {
+            FileInfo video = this.GetFileInfo(imageSetFolderPath);
+            if ((video.Exists == false) || (String.Equals(video.Extension, Constant.File.AviFileExtension, StringComparison.OrdinalIgnoreCase) == false))
+            {
+                keyframeStrip = null;
+                return false;
+            }
+
+            try
+            {
+                return VideoKeyframeStrip.TryCreate(video.FullName, frames, out keyframeStrip);
+            }
+            catch (InvalidDataException)
+            {
+                keyframeStrip = null;
+                return false;
+            }
+        }
+
         #pragma warning disable CS1998 // Async method lacks 'await' operators and will run synchronously
         public async override Task<CachedImage> TryLoadImageAsync(string baseFolderPath, int? expectedDisplayWidth)
         #pragma warning restore CS1998 // Async method lacks 'await' operators and will run synchronously
         {
-            throw new NotSupportedException();
+            // the first frame of MJPEG AVIs is a jpeg and can be displayed, classified, and differenced like an image
+            // Other formats, such as H.264 AVIs and MP4s, are displayed only by the media player.
+            FileInfo video = this.GetFileInfo(baseFolderPath);
+            if (video.Exists == false)
+            {
+                return new CachedImage()
+                {
+                    FileNoLongerAvailable = true
+                };
+            }
+            if (String.Equals(video.Extension, Constant.File.AviFileExtension, StringComparison.OrdinalIgnoreCase) == false)
+            {
+                return new CachedImage()
+                {
+                    ImageNotDecodable = true
+                };
+            }
+
+            try
+            {
+                using AviMjpegReader avi = new(video.FullName);
+                byte[]? jpeg = null;
+                MemoryImage? firstFrame = null;
+                if (avi.TryDecodeFrame(0, expectedDisplayWidth, ref jpeg, ref firstFrame) == false)
+                {
+                    return new CachedImage()
+                    {
+                        ImageNotDecodable = true
+                    };
+                }
+                return new CachedImage(firstFrame);
+            }
+            catch (InvalidDataException)
+            {
+                return new CachedImage()
+                {
+                    ImageNotDecodable = true
+                };
+            }
         }
     }
 }
\ No newline at end of file
@@ -27,8 +27,13 @@ namespace Carnassial.Database
 
         public static SecondaryIndex CreateFileTableIndex(ControlRow control)
         {
-            string indexName = $"File{control.DataLabel}Index";
-            return new SecondaryIndex(Constant.DatabaseTable.Files, indexName, control.DataLabel);
+            return SecondaryIndex.CreateFileTableIndex(control.DataLabel);
+        }
+
+        public static SecondaryIndex CreateFileTableIndex(string column)
+        {
+            string indexName = $"File{column}Index";
+            return new SecondaryIndex(Constant.DatabaseTable.Files, indexName, column);
         }
 
         public void Drop(SQLiteConnection connection, SQLiteTransaction transaction)
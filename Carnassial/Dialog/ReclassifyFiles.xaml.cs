@@ -56,13 +56,14 @@ namespace Carnassial.Dialog
                     using JpegImage jpeg = new(fileInfo.FullName);
                     if (jpeg.TryGetMetadata())
                     {
+                        double darkLuminosityThreshold = 0.01 * this.DarkLuminosityThresholdPercent.Value;
                         MemoryImage? preallocatedImage = null;
                         imageProperties = jpeg.GetThumbnailProperties(ref preallocatedImage);
                         if (imageProperties.MetadataResult.HasFlag(MetadataReadResults.Thumbnail) == false)
                         {
-                            imageProperties = jpeg.GetProperties(Constant.Images.NoThumbnailClassificationRequestedWidthInPixels, ref preallocatedImage);
+                            imageProperties = jpeg.GetProperties(Constant.Images.NoThumbnailClassificationRequestedWidthInPixels, darkLuminosityThreshold, ref preallocatedImage);
                         }
-                        newClassification = imageProperties.EvaluateNewClassification(0.01 * this.DarkLuminosityThresholdPercent.Value);
+                        newClassification = imageProperties.EvaluateNewClassification(darkLuminosityThreshold);
                     }
                     else
                     {
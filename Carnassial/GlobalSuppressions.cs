@@ -52,7 +52,7 @@ using System.Diagnostics.CodeAnalysis;
 [assembly: SuppressMessage("Style", "IDE0270:Use coalesce expression", Justification = "readability", Scope = "member", Target = "~M:Carnassial.Data.Spreadsheet.SpreadsheetReaderWriter.TryImportXlsx(System.String,Carnassial.Data.FileDatabase)~Carnassial.Data.FileImportResult")]
 [assembly: SuppressMessage("Style", "IDE0270:Use coalesce expression", Justification = "readability", Scope = "member", Target = "~M:Carnassial.Data.TemplateDatabase.#ctor(System.String)")]
 [assembly: SuppressMessage("Style", "IDE0270:Use coalesce expression", Justification = "readability", Scope = "member", Target = "~M:Carnassial.Database.SQLiteDatabase.GetBackupFilePath~System.String")]
-[assembly: SuppressMessage("Style", "IDE0270:Use coalesce expression", Justification = "readability", Scope = "member", Target = "~M:Carnassial.Interop.UnbufferedSequentialReader.#ctor(System.String)")]
+[assembly: SuppressMessage("Style", "IDE0270:Use coalesce expression", Justification = "readability", Scope = "member", Target = "~M:Carnassial.Interop.UnbufferedSequentialReader.#ctor(System.String,System.Boolean)")]
 [assembly: SuppressMessage("Style", "IDE0270:Use coalesce expression", Justification = "readability", Scope = "member", Target = "~M:Carnassial.Util.MostRecentlyUsedList`1.#ctor(System.Collections.IList,System.Int32)")]
 [assembly: SuppressMessage("Style", "IDE0270:Use coalesce expression", Justification = "readability", Scope = "type", Target = "~T:Carnassial.CarnassialWindow")]
 [assembly: SuppressMessage("Style", "IDE0270:Use coalesce expression", Justification = "readability", Scope = "type", Target = "~T:Carnassial.Data.FileDatabase")]
@@ -96,6 +96,6 @@ using System.Diagnostics.CodeAnalysis;
 [assembly: SuppressMessage("Style", "IDE0350:Use implicitly typed lambda", Justification = "readability, type safety", Scope = "member", Target = "~M:Carnassial.Dialog.ReclassifyIOComputeTransaction.ReclassifyFilesAsync(Carnassial.Data.FileDatabase,System.Double,System.Int32)~System.Threading.Tasks.Task")]
 [assembly: SuppressMessage("Style", "IDE0350:Use implicitly typed lambda", Justification = "readability, type safety", Scope = "member", Target = "~M:Carnassial.Images.AddFilesIOComputeTransactionManager.AddFilesAsync(Carnassial.Data.FileDatabase,System.Int32)~System.Threading.Tasks.Task{System.Int32}")]
 [assembly: SuppressMessage("Style", "IDE0350:Use implicitly typed lambda", Justification = "readability, type safety", Scope = "member", Target = "~M:Carnassial.Images.ImageCache.CacheImage(System.Int64,Carnassial.Data.CachedImage)")]
-[assembly: SuppressMessage("Style", "IDE0350:Use implicitly typed lambda", Justification = "readability, type safety", Scope = "member", Target = "~M:Carnassial.Images.ImageCache.TryInitiatePrefetch(System.Int32)~System.Boolean")]
+[assembly: SuppressMessage("Style", "IDE0350:Use implicitly typed lambda", Justification = "readability, type safety", Scope = "member", Target = "~M:Carnassial.Images.ImageCache.TryInitiatePrefetch(System.Int32,Carnassial.Images.ImageResolution)~System.Boolean")]
 [assembly: SuppressMessage("Style", "IDE0350:Use implicitly typed lambda", Justification = "readability, type safety", Scope = "member", Target = "~M:Carnassial.Interop.UnbufferedSequentialReader.GetSectorSize~System.Int32")]
 [assembly: SuppressMessage("Usage", "CA2214:Do not call overridable methods in constructors", Justification = "reviewed", Scope = "member", Target = "~M:Carnassial.Data.FileTableEnumerator.#ctor(Carnassial.Data.FileDatabase,System.Int32)")]
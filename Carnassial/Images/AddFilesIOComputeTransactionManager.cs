@@ -1,17 +1,19 @@
 ﻿using Carnassial.Data;
 using Carnassial.Interop;
 using System;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.Diagnostics;
 using System.IO;
 using System.Linq;
-using System.Threading;
 using System.Threading.Tasks;
 
 namespace Carnassial.Images
 {
     internal class AddFilesIOComputeTransactionManager : FileIOComputeTransactionManager<FileLoadStatus>
     {
+        private ConcurrentDictionary<string, BackgroundModel>? backgrounds;
+        private FileTable? files;
         private readonly SortedDictionary<string, List<string>> filesToLoadByRelativeFolderPath;
 
         public int FilesToLoad { get; private set; }
@@ -20,6 +22,8 @@ namespace Carnassial.Images
         public AddFilesIOComputeTransactionManager(Action<FileLoadStatus> onProgressUpdate, TimeSpan desiredProgressInterval)
             : base(onProgressUpdate, desiredProgressInterval)
         {
+            this.backgrounds = null;
+            this.files = null;
             this.FilesToLoad = 0;
             this.filesToLoadByRelativeFolderPath = new(StringComparer.OrdinalIgnoreCase);
             this.FolderPaths = [];
@@ -61,32 +65,75 @@ namespace Carnassial.Images
                 return this.AddFilesCompute(fileDatabase, computeTaskNumber);
             };
 
-            using (ReaderWriterLockSlim fileCreateAndAppendLock = new())
+            // files are created in parallel by the IO tasks but only appended to the file table once they're added to the
+            // transaction, which happens in file order from a single thread at a time
+            // This keeps the file table consistent with the database if the add's cancelled or fails and avoids serializing IO
+            // tasks on appends.
+            this.files = fileDatabase.Files;
+
+            // backgrounds are updated as atoms' computation completes in file order so that change scores don't depend on
+            // which compute task finishes which atom first
+            this.backgrounds = fileDatabase.Backgrounds;
+
+            // where seeks are expensive read files in the order they're laid out on disk rather than in name order
+            // Cameras write files in name order but cards which have been partially erased, folders copied from several cards,
+            // and hard drives which have been written to over time often don't place files in name order.
+            if (NativeMethods.IncursSeekPenalty(fileDatabase.FolderPath))
             {
-                this.IOTaskBody = (int ioTaskNumber) =>
+                this.IOAtomPhysicalLocation = (FileLoadAtom loadAtom) =>
                 {
-                    for (FileLoadAtom? loadAtom = this.GetNextIOAtom(ioTaskNumber); loadAtom != null; loadAtom = this.GetNextIOAtom(ioTaskNumber))
+                    return NativeMethods.GetFirstLogicalClusterNumber(Path.Combine(fileDatabase.FolderPath, loadAtom.RelativePath, loadAtom.First.FileName!));
+                };
+            }
+
+            // each IO task queues metadata reads for a batch of atoms at once and then hands atoms off to the compute tasks in
+            // order as their reads complete
+            // Compared to one synchronous read at a time per IO task this keeps the drive's queue
+            // deep without needing more IO threads.
+            this.IOTaskBody = (int ioTaskNumber) =>
+            {
+                FileLoadAtom[] loadAtoms = new FileLoadAtom[Constant.Images.LoadAtomsPerIOBatch];
+                Task?[] jpegReads = new Task?[loadAtoms.Length];
+                for (int atoms = this.GetNextIOAtoms(ioTaskNumber, loadAtoms); atoms > 0; atoms = this.GetNextIOAtoms(ioTaskNumber, loadAtoms))
+                {
+                    for (int atom = 0; atom < atoms; ++atom)
                     {
-                        // CreateAndAppendFiles() ultimately calls List.Add(), which is not thread safe for more than one IO task
-                        // Considerig core counts in target hardware, assume at least two IO tasks will be running.
-                        bool filesCreated = false;
-                        fileCreateAndAppendLock.EnterWriteLock();
-                        try
-                        {
-                            filesCreated = loadAtom.CreateAndAppendFiles(filesAlreadyInFileTableByRelativePath, fileDatabase.Files);
-                        }
-                        finally
+                        FileLoadAtom loadAtom = loadAtoms[atom];
+                        jpegReads[atom] = loadAtom.CreateFiles(filesAlreadyInFileTableByRelativePath, fileDatabase.Files) ? loadAtom.CreateJpegsAsync(fileDatabase.FolderPath, false) : null;
+                    }
+
+                    int atomsCompleted = 0;
+                    try
+                    {
+                        for (; atomsCompleted < atoms; ++atomsCompleted)
                         {
-                            fileCreateAndAppendLock.ExitWriteLock();
+                            jpegReads[atomsCompleted]?.GetAwaiter().GetResult();
+                            this.CompleteIOAtom(ioTaskNumber, atomsCompleted);
                         }
-                        if (filesCreated)
+                    }
+                    catch
+                    {
+                        // let reads still in flight complete so their jpegs are disposed with their atoms
+                        for (int atom = atomsCompleted + 1; atom < atoms; ++atom)
                         {
-                            loadAtom.CreateJpegs(fileDatabase.FolderPath, false);
+                            try
+                            {
+                                jpegReads[atom]?.Wait();
+                            }
+                            catch (AggregateException)
+                            {
+                                // the first exception is the one propagated
+                            }
                         }
+                        throw;
                     }
-                };
-                await this.RunTasksAsync(fileDatabase.CreateAddFilesTransaction(), this.filesToLoadByRelativeFolderPath, this.FilesToLoad).ConfigureAwait(true);
-            }
+                    Array.Clear(jpegReads);
+                }
+            };
+            await this.RunTasksAsync(fileDatabase.CreateAddFilesTransaction(), this.filesToLoadByRelativeFolderPath, this.FilesToLoad).ConfigureAwait(true);
+
+            // backgrounds are updated in memory as files are classified and persisted once all files are added
+            fileDatabase.SyncBackgroundsToDatabase();
             return this.TransactionFileCount;
         }
 
@@ -107,7 +154,7 @@ namespace Carnassial.Images
                 if (loadAtom.HasAtLeastOneFile)
                 {
                     loadAtom.ReadDateTimeOffsets(fileDatabase.FolderPath, imageSetTimeZone);
-                    loadAtom.ClassifyFromThumbnails(ref preallocatedThumbnail);
+                    loadAtom.ClassifyFromThumbnails(fileDatabase.FolderPath, ref preallocatedThumbnail);
                 }
 
                 // check if progress needs to be reported
@@ -183,6 +230,27 @@ namespace Carnassial.Images
             this.Status.TotalFiles = this.FilesToLoad;
         }
 
+        protected override void OnAddedToSequence(IList<FileLoad> fileLoads, int offset, int length)
+        {
+            Debug.Assert(this.files != null);
+            int stopIndex = offset + length;
+            for (int fileIndex = offset; fileIndex < stopIndex; ++fileIndex)
+            {
+                // files already in the database aren't created
+                ImageRow? file = fileLoads[fileIndex].File;
+                if (file != null)
+                {
+                    this.files.AppendFile(file);
+                }
+            }
+        }
+
+        protected override void OnComputeAtomCompleted(FileLoadAtom loadAtom)
+        {
+            Debug.Assert(this.backgrounds != null);
+            loadAtom.UpdateBackgrounds(this.backgrounds);
+        }
+
         public void QueueProgressUpdate()
         {
             this.Progress.QueueProgressUpdate(this.Status);
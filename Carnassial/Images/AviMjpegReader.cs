@@ -0,0 +1,364 @@
+﻿using Microsoft.Win32.SafeHandles;
+using System;
+using System.Buffers.Binary;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Diagnostics.CodeAnalysis;
+using System.IO;
+
+namespace Carnassial.Images
+{
+    /// <summary>
+    /// Minimal RIFF AVI demultiplexer which indexes the frames of an AVI's first video stream and, if the stream is motion
+    /// JPEG, provides the frames' jpegs for decoding through <see cref="MemoryImage"/>.
+    /// </summary>
+    /// <remarks>
+    /// Hybrid trail cameras commonly write AVIs whose video stream is MJPEG, in which case each frame is a complete baseline
+    /// jpeg which turbojpeg decodes directly (MJPEG frames often omit DHT segments but turbojpeg supplies the standard
+    /// Huffman tables).  Other codecs, such as H.264, are indexed but their frames aren't decodable here. Only the idx1 index
+    /// is used; OpenDML AVIX extensions aren't needed at the file sizes trail cameras produce and frames beyond the first
+    /// RIFF list are therefore ignored. If idx1 is missing, as happens when a camera loses power mid-recording, the movi list
+    /// is walked instead.
+    /// </remarks>
+    public class AviMjpegReader : IDisposable
+    {
+        private const int ChunkHeaderSizeInBytes = 8;
+        private const int IndexEntrySizeInBytes = 16;
+        private const int MainHeaderSizeInBytes = 56;
+        private const int StreamHeaderMinimumSizeInBytes = 24;
+
+        private static readonly UInt32 Avi = AviMjpegReader.FourCC("AVI ");
+        private static readonly UInt32 Avih = AviMjpegReader.FourCC("avih");
+        private static readonly UInt32 Hdrl = AviMjpegReader.FourCC("hdrl");
+        private static readonly UInt32 Idx1 = AviMjpegReader.FourCC("idx1");
+        private static readonly UInt32 List = AviMjpegReader.FourCC("LIST");
+        private static readonly UInt32 Movi = AviMjpegReader.FourCC("movi");
+        private static readonly UInt32 Rec = AviMjpegReader.FourCC("rec ");
+        private static readonly UInt32 Riff = AviMjpegReader.FourCC("RIFF");
+        private static readonly UInt32 Strf = AviMjpegReader.FourCC("strf");
+        private static readonly UInt32 Strh = AviMjpegReader.FourCC("strh");
+        private static readonly UInt32 Strl = AviMjpegReader.FourCC("strl");
+        private static readonly UInt32 Vids = AviMjpegReader.FourCC("vids");
+
+        private bool disposed;
+        private readonly SafeFileHandle file;
+        private readonly long fileLength;
+        private readonly List<int> frameLengths;
+        private readonly List<long> frameOffsets;
+        private long moviListOffset;
+        private UInt32 videoChunkIDCompressed;
+        private UInt32 videoChunkIDUncompressed;
+
+        public TimeSpan FrameInterval { get; private set; }
+        public bool IsMjpeg { get; private set; }
+        public int PixelHeight { get; private set; }
+        public int PixelWidth { get; private set; }
+
+        public AviMjpegReader(string filePath)
+        {
+            this.disposed = false;
+            this.file = File.OpenHandle(filePath, FileMode.Open, FileAccess.Read, FileShare.Read, FileOptions.RandomAccess);
+            this.fileLength = RandomAccess.GetLength(this.file);
+            this.frameLengths = [];
+            this.frameOffsets = [];
+            this.moviListOffset = -1;
+
+            try
+            {
+                this.ReadRiff();
+            }
+            catch
+            {
+                this.file.Dispose();
+                throw;
+            }
+        }
+
+        public int FrameCount
+        {
+            get { return this.frameOffsets.Count; }
+        }
+
+        public void Dispose()
+        {
+            this.Dispose(true);
+            GC.SuppressFinalize(this);
+        }
+
+        protected virtual void Dispose(bool disposing)
+        {
+            if (this.disposed)
+            {
+                return;
+            }
+
+            if (disposing)
+            {
+                this.file.Dispose();
+            }
+
+            this.disposed = true;
+        }
+
+        private static UInt32 FourCC(string fourCC)
+        {
+            Debug.Assert(fourCC.Length == 4, "FourCCs are four characters.");
+            return (UInt32)fourCC[0] | ((UInt32)fourCC[1] << 8) | ((UInt32)fourCC[2] << 16) | ((UInt32)fourCC[3] << 24);
+        }
+
+        public (long offset, int length) GetFrameLocation(int frameIndex)
+        {
+            return (this.frameOffsets[frameIndex], this.frameLengths[frameIndex]);
+        }
+
+        private static bool IsMjpegFourCC(UInt32 fourCC)
+        {
+            // handlers and compressions seen in the wild are MJPG, mjpg, AVRn, and dmb1 (Matrox), all of which are baseline
+            // jpegs per frame
+            // Clearing bit 5 upper cases letters and, since it's applied to both sides, digits still compare correctly.
+            const UInt32 caseMask = 0xdfdfdfdf;
+            UInt32 upperCase = fourCC & caseMask;
+            return (upperCase == (AviMjpegReader.FourCC("MJPG") & caseMask)) ||
+                   (upperCase == (AviMjpegReader.FourCC("AVRn") & caseMask)) ||
+                   (upperCase == (AviMjpegReader.FourCC("dmb1") & caseMask));
+        }
+
+        private bool IsVideoChunk(UInt32 chunkID)
+        {
+            return (chunkID == this.videoChunkIDCompressed) || (chunkID == this.videoChunkIDUncompressed);
+        }
+
+        /// <summary>
+        /// Reads the jpeg for the specified frame into buffer, reallocating buffer if it's too small.
+        /// </summary>
+        /// <returns>The length of the frame's jpeg in bytes.</returns>
+        public int ReadFrame(int frameIndex, ref byte[]? buffer)
+        {
+            (long offset, int length) = this.GetFrameLocation(frameIndex);
+            if ((buffer == null) || (buffer.Length < length))
+            {
+                buffer = new byte[length];
+            }
+
+            RandomAccess.Read(this.file, buffer.AsSpan(0, length), offset);
+            return length;
+        }
+
+        private void ReadIndex(long indexDataOffset, int indexSizeInBytes)
+        {
+            byte[] index = new byte[indexSizeInBytes - indexSizeInBytes % AviMjpegReader.IndexEntrySizeInBytes];
+            int bytesRead = RandomAccess.Read(this.file, index, indexDataOffset);
+
+            // idx1 offsets are normally relative to the movi list's fourCC but some writers use absolute file offsets
+            // Determine which by checking if the first video entry points at a matching chunk header.
+            long offsetBase = -1;
+            for (int entryOffset = 0; entryOffset + AviMjpegReader.IndexEntrySizeInBytes <= bytesRead; entryOffset += AviMjpegReader.IndexEntrySizeInBytes)
+            {
+                UInt32 chunkID = BinaryPrimitives.ReadUInt32LittleEndian(index.AsSpan(entryOffset));
+                if (this.IsVideoChunk(chunkID) == false)
+                {
+                    continue;
+                }
+
+                UInt32 chunkOffset = BinaryPrimitives.ReadUInt32LittleEndian(index.AsSpan(entryOffset + 8));
+                int chunkLength = BinaryPrimitives.ReadInt32LittleEndian(index.AsSpan(entryOffset + 12));
+                if (offsetBase < 0)
+                {
+                    offsetBase = this.ReadUInt32(this.moviListOffset + chunkOffset) == chunkID ? this.moviListOffset : 0;
+                }
+
+                if ((chunkLength == 0) && (this.frameOffsets.Count > 0))
+                {
+                    // zero length chunks are dropped frames and repeat the previous frame
+                    this.frameOffsets.Add(this.frameOffsets[^1]);
+                    this.frameLengths.Add(this.frameLengths[^1]);
+                    continue;
+                }
+
+                long frameOffset = offsetBase + chunkOffset + AviMjpegReader.ChunkHeaderSizeInBytes;
+                if ((chunkLength <= 0) || (frameOffset + chunkLength > this.fileLength))
+                {
+                    // index points past the end of a truncated file
+                    break;
+                }
+                this.frameOffsets.Add(frameOffset);
+                this.frameLengths.Add(chunkLength);
+            }
+        }
+
+        private void ReadMovi(long listDataOffset, long listEndOffset)
+        {
+            for (long chunkOffset = listDataOffset; chunkOffset + AviMjpegReader.ChunkHeaderSizeInBytes <= listEndOffset;)
+            {
+                UInt32 chunkID = this.ReadUInt32(chunkOffset);
+                UInt32 chunkSize = this.ReadUInt32(chunkOffset + 4);
+                long chunkDataOffset = chunkOffset + AviMjpegReader.ChunkHeaderSizeInBytes;
+                if (chunkDataOffset + chunkSize > this.fileLength)
+                {
+                    // truncated file
+                    break;
+                }
+
+                if ((chunkID == AviMjpegReader.List) && (this.ReadUInt32(chunkDataOffset) == AviMjpegReader.Rec))
+                {
+                    this.ReadMovi(chunkDataOffset + 4, chunkDataOffset + chunkSize);
+                }
+                else if (this.IsVideoChunk(chunkID) && (chunkSize > 0))
+                {
+                    this.frameOffsets.Add(chunkDataOffset);
+                    this.frameLengths.Add((int)chunkSize);
+                }
+
+                chunkOffset = chunkDataOffset + chunkSize + (chunkSize & 0x1);
+            }
+        }
+
+        private void ReadRiff()
+        {
+            if ((this.fileLength < 3 * 4) || (this.ReadUInt32(0) != AviMjpegReader.Riff) || (this.ReadUInt32(8) != AviMjpegReader.Avi))
+            {
+                throw new InvalidDataException("File is not a RIFF AVI.");
+            }
+
+            long riffEndOffset = Math.Min(this.fileLength, AviMjpegReader.ChunkHeaderSizeInBytes + (long)this.ReadUInt32(4));
+            long indexDataOffset = -1;
+            int indexSizeInBytes = 0;
+            long moviEndOffset = -1;
+            for (long chunkOffset = 12; chunkOffset + AviMjpegReader.ChunkHeaderSizeInBytes <= riffEndOffset;)
+            {
+                UInt32 chunkID = this.ReadUInt32(chunkOffset);
+                UInt32 chunkSize = this.ReadUInt32(chunkOffset + 4);
+                long chunkDataOffset = chunkOffset + AviMjpegReader.ChunkHeaderSizeInBytes;
+                long chunkEndOffset = Math.Min(chunkDataOffset + chunkSize, riffEndOffset);
+                if (chunkID == AviMjpegReader.List)
+                {
+                    UInt32 listType = this.ReadUInt32(chunkDataOffset);
+                    if (listType == AviMjpegReader.Hdrl)
+                    {
+                        this.ReadStreamHeaders(chunkDataOffset + 4, chunkEndOffset);
+                    }
+                    else if (listType == AviMjpegReader.Movi)
+                    {
+                        this.moviListOffset = chunkDataOffset;
+                        moviEndOffset = chunkEndOffset;
+                    }
+                }
+                else if (chunkID == AviMjpegReader.Idx1)
+                {
+                    indexDataOffset = chunkDataOffset;
+                    indexSizeInBytes = (int)(chunkEndOffset - chunkDataOffset);
+                }
+
+                chunkOffset = chunkDataOffset + chunkSize + (chunkSize & 0x1);
+            }
+
+            if ((this.videoChunkIDCompressed == 0) || (this.moviListOffset < 0))
+            {
+                // no video stream or no frames
+                return;
+            }
+
+            if (indexDataOffset > 0)
+            {
+                this.ReadIndex(indexDataOffset, indexSizeInBytes);
+            }
+            if (this.frameOffsets.Count == 0)
+            {
+                this.ReadMovi(this.moviListOffset + 4, moviEndOffset);
+            }
+        }
+
+        private void ReadStreamHeaders(long listDataOffset, long listEndOffset)
+        {
+            int streamNumber = 0;
+            for (long chunkOffset = listDataOffset; chunkOffset + AviMjpegReader.ChunkHeaderSizeInBytes <= listEndOffset;)
+            {
+                UInt32 chunkID = this.ReadUInt32(chunkOffset);
+                UInt32 chunkSize = this.ReadUInt32(chunkOffset + 4);
+                long chunkDataOffset = chunkOffset + AviMjpegReader.ChunkHeaderSizeInBytes;
+                if ((chunkID == AviMjpegReader.Avih) && (chunkSize >= AviMjpegReader.MainHeaderSizeInBytes))
+                {
+                    this.FrameInterval = TimeSpan.FromMicroseconds(this.ReadUInt32(chunkDataOffset));
+                    this.PixelWidth = (int)this.ReadUInt32(chunkDataOffset + 32);
+                    this.PixelHeight = (int)this.ReadUInt32(chunkDataOffset + 36);
+                }
+                else if ((chunkID == AviMjpegReader.List) && (this.ReadUInt32(chunkDataOffset) == AviMjpegReader.Strl))
+                {
+                    if (this.videoChunkIDCompressed == 0)
+                    {
+                        this.TryReadVideoStream(streamNumber, chunkDataOffset + 4, chunkDataOffset + chunkSize);
+                    }
+                    ++streamNumber;
+                }
+
+                chunkOffset = chunkDataOffset + chunkSize + (chunkSize & 0x1);
+            }
+        }
+
+        private UInt32 ReadUInt32(long offset)
+        {
+            Span<byte> value = stackalloc byte[4];
+            if (RandomAccess.Read(this.file, value, offset) < value.Length)
+            {
+                return 0;
+            }
+            return BinaryPrimitives.ReadUInt32LittleEndian(value);
+        }
+
+        /// <summary>
+        /// Decodes the specified frame, reusing preallocatedImage if it's of the decoded size. As with jpeg files, frames which
+        /// are partially decodable are returned with <see cref="MemoryImageCppCli.DecompressionError"/> set.
+        /// </summary>
+        public bool TryDecodeFrame(int frameIndex, int? requestedWidth, ref byte[]? jpegBuffer, [NotNullWhen(true)] ref MemoryImage? preallocatedImage)
+        {
+            if ((this.IsMjpeg == false) || (frameIndex >= this.FrameCount))
+            {
+                return false;
+            }
+
+            int jpegLength = this.ReadFrame(frameIndex, ref jpegBuffer);
+            Debug.Assert(jpegBuffer != null, "Frame buffer unexpectedly null.");
+            if ((preallocatedImage == null) || (preallocatedImage.TryDecode(jpegBuffer, 0, jpegLength, requestedWidth) == false))
+            {
+                preallocatedImage = new MemoryImage(jpegBuffer, 0, jpegLength, requestedWidth);
+            }
+            return true;
+        }
+
+        private void TryReadVideoStream(int streamNumber, long listDataOffset, long listEndOffset)
+        {
+            bool isVideo = false;
+            UInt32 handler = 0;
+            UInt32 compression = 0;
+            for (long chunkOffset = listDataOffset; chunkOffset + AviMjpegReader.ChunkHeaderSizeInBytes <= listEndOffset;)
+            {
+                UInt32 chunkID = this.ReadUInt32(chunkOffset);
+                UInt32 chunkSize = this.ReadUInt32(chunkOffset + 4);
+                long chunkDataOffset = chunkOffset + AviMjpegReader.ChunkHeaderSizeInBytes;
+                if ((chunkID == AviMjpegReader.Strh) && (chunkSize >= AviMjpegReader.StreamHeaderMinimumSizeInBytes))
+                {
+                    isVideo = this.ReadUInt32(chunkDataOffset) == AviMjpegReader.Vids;
+                    handler = this.ReadUInt32(chunkDataOffset + 4);
+                }
+                else if (chunkID == AviMjpegReader.Strf)
+                {
+                    // BITMAPINFOHEADER.biCompression
+                    compression = this.ReadUInt32(chunkDataOffset + 16);
+                }
+
+                chunkOffset = chunkDataOffset + chunkSize + (chunkSize & 0x1);
+            }
+
+            if (isVideo == false)
+            {
+                return;
+            }
+
+            // video chunks are ##dc for compressed frames and ##db for uncompressed ones
+            UInt32 streamDigits = (UInt32)('0' + streamNumber / 10) | ((UInt32)('0' + streamNumber % 10) << 8);
+            this.videoChunkIDCompressed = streamDigits | ((UInt32)'d' << 16) | ((UInt32)'c' << 24);
+            this.videoChunkIDUncompressed = streamDigits | ((UInt32)'d' << 16) | ((UInt32)'b' << 24);
+            this.IsMjpeg = AviMjpegReader.IsMjpegFourCC(handler) || AviMjpegReader.IsMjpegFourCC(compression);
+        }
+    }
+}
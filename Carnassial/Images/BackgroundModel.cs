@@ -0,0 +1,114 @@
+﻿using System;
+using System.Numerics;
+using System.Runtime.InteropServices;
+
+namespace Carnassial.Images
+{
+    /// <summary>
+    /// The background of a camera station, estimated as the exponentially weighted mean of the thumbnails of the images in the
+    /// station's folder.
+    /// </summary>
+    /// <remarks>
+    /// Differencing against adjacent files cancels out animals which move only slightly across a burst and picks up lighting
+    /// changes between files. Differencing against a background accumulated over many files avoids both, at the cost of the
+    /// background's lower resolution. Backgrounds are updated from each image's thumbnail as files are added, so keeping them
+    /// current costs one pass over a thumbnail per file rather than a scan of the station's images, and they're stored in the
+    /// file database so they persist across sessions.
+    ///
+    /// Means are kept per BGRA channel in fixed point with seven fractional bits. Until a station has 2^
+    /// <see cref="Constant.Images.BackgroundWeightShift"/> images each image is weighted approximately equally, so backgrounds
+    /// aren't dominated by a station's first image. Updates are thread safe.
+    /// </remarks>
+    public class BackgroundModel
+    {
+        private readonly object updateLock;
+
+        public int Frames { get; private set; }
+        public Int16[] Mean { get; private init; }
+        public int PixelHeight { get; private init; }
+        public int PixelWidth { get; private init; }
+        public string RelativePath { get; private init; }
+
+        public BackgroundModel(string relativePath, int pixelWidth, int pixelHeight)
+            : this(relativePath, pixelWidth, pixelHeight, 0, new Int16[Constant.Images.BgraPixelSizeInBytes * pixelWidth * pixelHeight])
+        {
+        }
+
+        public BackgroundModel(string relativePath, int pixelWidth, int pixelHeight, int frames, Int16[] mean)
+        {
+            if (mean.Length != Constant.Images.BgraPixelSizeInBytes * pixelWidth * pixelHeight)
+            {
+                throw new ArgumentOutOfRangeException(nameof(mean), $"Background of {pixelWidth} x {pixelHeight} pixels has a mean of length {mean.Length}.");
+            }
+
+            this.Frames = frames;
+            this.Mean = mean;
+            this.PixelHeight = pixelHeight;
+            this.PixelWidth = pixelWidth;
+            this.RelativePath = relativePath;
+            this.updateLock = new();
+        }
+
+        /// <summary>
+        /// Get the number of images in the background and its mean as bytes, consistent with each other even if the background is
+        /// being updated.
+        /// </summary>
+        public (int Frames, byte[] Mean) GetSnapshot()
+        {
+            lock (this.updateLock)
+            {
+                return (this.Frames, MemoryMarshal.AsBytes(this.Mean.AsSpan()).ToArray());
+            }
+        }
+
+        public bool IsCompatible(MemoryImage image)
+        {
+            double aspectRatio = (double)this.PixelWidth / (double)this.PixelHeight;
+            double imageAspectRatio = (double)image.PixelWidth / (double)image.PixelHeight;
+            return (this.Frames > 0) && (this.PixelWidth > 1) && (Math.Abs(imageAspectRatio / aspectRatio - 1.0) <= Constant.Images.BackgroundAspectRatioTolerance);
+        }
+
+        /// <summary>
+        /// Add an image's thumbnail to the background.
+        /// </summary>
+        /// <returns>false if the thumbnail isn't the same size as the background.</returns>
+        public bool TryUpdate(MemoryImage thumbnail)
+        {
+            return this.TryUpdate(thumbnail, 0, null, out double? _);
+        }
+
+        /// <summary>
+        /// Score how much a thumbnail differs from the background and then add it to the background.
+        /// </summary>
+        /// <param name="bottomRowsToSkip">Rows at the bottom of the thumbnail excluded from its change score, such as an info bar.</param>
+        /// <param name="mask">Optional mask with one byte per pixel. Pixels whose mask bytes are zero are excluded from the change score.</param>
+        /// <param name="changeScore">The fraction of the thumbnail's pixels which differ from the background by more than
+        /// <see cref="Constant.Images.DifferenceThresholdDefault"/>, or null if the background has no images yet.</param>
+        /// <returns>false if the thumbnail isn't the same size as the background.</returns>
+        public bool TryUpdate(MemoryImage thumbnail, int bottomRowsToSkip, byte[]? mask, out double? changeScore)
+        {
+            changeScore = null;
+            lock (this.updateLock)
+            {
+                if ((thumbnail.PixelWidth != this.PixelWidth) || (thumbnail.PixelHeight != this.PixelHeight))
+                {
+                    return false;
+                }
+
+                if ((this.Frames > 0) && thumbnail.TryGetChangeScore(this.Mean, Constant.Images.DifferenceThresholdDefault, bottomRowsToSkip, mask, out double score))
+                {
+                    changeScore = score;
+                }
+
+                int weightShift = Math.Min(BitOperations.Log2((uint)this.Frames + 1), Constant.Images.BackgroundWeightShift);
+                if (thumbnail.TryAccumulateExponentialMean(this.Mean, weightShift) == false)
+                {
+                    return false;
+                }
+
+                ++this.Frames;
+                return true;
+            }
+        }
+    }
+}
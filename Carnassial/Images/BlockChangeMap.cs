@@ -0,0 +1,89 @@
+﻿using System;
+using System.Windows.Media;
+using System.Windows.Media.Imaging;
+
+namespace Carnassial.Images
+{
+    /// <summary>
+    /// How much each block of an image differs from the corresponding block of another image, as the mean absolute difference of
+    /// the block's blue, green, and red channels.
+    /// </summary>
+    /// <remarks>
+    /// Intended for triage, where whether and roughly where two images differ matters more than which pixels differ. Maps are
+    /// usually calculated from 1/8 scale decodes, where an eight pixel block covers 64 x 64 pixels of the full resolution image,
+    /// so an 8 MP image pair's map is some 2000 blocks and well under a millisecond to calculate. Averaging over blocks also
+    /// suppresses the pixel level noise and jpeg artifacts which a per pixel threshold has to be set above, so small animals can
+    /// be picked up with a lower threshold than differencing needs.
+    /// </remarks>
+    public class BlockChangeMap
+    {
+        private const int DefaultDpi = 96;
+
+        public int BlockSizeInPixels { get; private init; }
+        public int BlocksHigh { get; private init; }
+        public int BlocksWide { get; private init; }
+        public byte[] MeanAbsoluteDifferences { get; private init; }
+
+        public BlockChangeMap(int blockSizeInPixels, int blocksWide, int blocksHigh, byte[] meanAbsoluteDifferences)
+        {
+            if (meanAbsoluteDifferences.Length != blocksWide * blocksHigh)
+            {
+                throw new ArgumentOutOfRangeException(nameof(meanAbsoluteDifferences), $"Map of {blocksWide} x {blocksHigh} blocks has {meanAbsoluteDifferences.Length} differences.");
+            }
+
+            this.BlockSizeInPixels = blockSizeInPixels;
+            this.BlocksHigh = blocksHigh;
+            this.BlocksWide = blocksWide;
+            this.MeanAbsoluteDifferences = meanAbsoluteDifferences;
+        }
+
+        public int CountChangedBlocks(byte threshold)
+        {
+            int changedBlocks = 0;
+            foreach (byte meanAbsoluteDifference in this.MeanAbsoluteDifferences)
+            {
+                if (meanAbsoluteDifference > threshold)
+                {
+                    ++changedBlocks;
+                }
+            }
+            return changedBlocks;
+        }
+
+        /// <summary>
+        /// Get a heatmap of the changed blocks with one pixel per block, suitable for stretching over the image as an overlay.
+        /// </summary>
+        /// <returns>An image with changed blocks in red, more opaque the more they changed, and unchanged blocks transparent.</returns>
+        public BitmapSource GetHeatmap(byte threshold)
+        {
+            // pixels are premultiplied, so red equals alpha
+            byte[] pixels = new byte[Constant.Images.BgraPixelSizeInBytes * this.MeanAbsoluteDifferences.Length];
+            for (int block = 0; block < this.MeanAbsoluteDifferences.Length; ++block)
+            {
+                byte meanAbsoluteDifference = this.MeanAbsoluteDifferences[block];
+                if (meanAbsoluteDifference > threshold)
+                {
+                    byte opacity = (byte)Math.Min(Constant.Images.BlockChangeHeatmapGain * meanAbsoluteDifference, Byte.MaxValue);
+                    pixels[Constant.Images.BgraPixelSizeInBytes * block + 2] = opacity;
+                    pixels[Constant.Images.BgraPixelSizeInBytes * block + 3] = opacity;
+                }
+            }
+
+            BitmapSource heatmap = BitmapSource.Create(this.BlocksWide, this.BlocksHigh, BlockChangeMap.DefaultDpi, BlockChangeMap.DefaultDpi, PixelFormats.Pbgra32, null, pixels, Constant.Images.BgraPixelSizeInBytes * this.BlocksWide);
+            heatmap.Freeze();
+            return heatmap;
+        }
+
+        public bool HasChange(byte threshold)
+        {
+            foreach (byte meanAbsoluteDifference in this.MeanAbsoluteDifferences)
+            {
+                if (meanAbsoluteDifference > threshold)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+}
@@ -0,0 +1,27 @@
+﻿using Carnassial.Data;
+using System.Collections.Generic;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace Carnassial.Images
+{
+    /// <summary>
+    /// A request to calculate differences ahead of the user asking for them. Requests are cancelled by navigation and are
+    /// superseded by newer requests which haven't yet started.
+    /// </summary>
+    internal class DifferencePrecomputation
+    {
+        public CancellationToken CancellationToken { get; private init; }
+        public TaskCompletionSource Completion { get; private init; }
+        public List<(ImageRow? Previous, ImageRow File, ImageRow? Next)> Files { get; private init; }
+        public byte Threshold { get; private init; }
+
+        public DifferencePrecomputation(List<(ImageRow? Previous, ImageRow File, ImageRow? Next)> files, byte threshold, CancellationToken cancellationToken)
+        {
+            this.CancellationToken = cancellationToken;
+            this.Completion = new(TaskCreationOptions.RunContinuationsAsynchronously);
+            this.Files = files;
+            this.Threshold = threshold;
+        }
+    }
+}
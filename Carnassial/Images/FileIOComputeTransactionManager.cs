@@ -6,7 +6,7 @@ using Carnassial.Util;
 using System;
 using System.Collections.Generic;
 using System.Diagnostics;
-using System.Linq;
+using System.Diagnostics.CodeAnalysis;
 using System.Threading;
 using System.Threading.Tasks;
 
@@ -28,14 +28,19 @@ namespace Carnassial.Images
         private bool addFilesInProgress;
         private int addFileStartIndex;
         private int addFileStopIndex;
-        private int computeAtomIndex;
+        private readonly int[] computeAtomInProgressByTask;
+        private WorkStealingScheduler<int>? computeAtoms;
+        private bool[]? computeAtomsCompleted;
+        private int computeAtomWatermark;
         private int computeFileIndex;
         private readonly int computeTaskCount;
         private readonly Task<int>?[] computeTasks;
         private bool disposed;
         private FileLoad[]? fileLoads;
         private int ioAtomIndex;
-        private readonly int[] ioAtomsCompletedByTask;
+        private int[]? ioAtomReadOrder;
+        private int ioAtomReadOrderIndex;
+        private readonly int[][] ioAtomsInProgressByTask;
         private int ioFileIndex;
         private SortedDictionary<string, List<string>>.Enumerator ioFilesByRelativePathEnumerator;
         private List<string>? ioFilesInCurrentFolder;
@@ -49,6 +54,11 @@ namespace Carnassial.Images
         private WindowedTransactionSequence<FileLoad>? transactionSequence;
 
         protected Func<int, int>? ComputeTaskBody { get; set; }
+        /// <summary>
+        /// If set, atoms are read in the order of the physical locations this returns rather than in file order. Locations are
+        /// negative if unknown.
+        /// </summary>
+        protected Func<FileLoadAtom, long>? IOAtomPhysicalLocation { get; set; }
         protected Action<int>? IOTaskBody { get; set; }
         protected ExceptionPropagatingProgress<TProgress> Progress { get; private init; }
         protected TProgress Status { get; private set; }
@@ -65,7 +75,9 @@ namespace Carnassial.Images
             this.addFileStartIndex = 0;
             this.addFileStopIndex = 0;
 
-            this.computeAtomIndex = 0;
+            this.computeAtoms = null;
+            this.computeAtomsCompleted = null;
+            this.computeAtomWatermark = 0;
             this.ComputeDuration = TimeSpan.Zero;
             this.computeFileIndex = 0;
             this.ComputeTaskBody = null;
@@ -75,6 +87,9 @@ namespace Carnassial.Images
             this.fileLoads = null;
 
             this.ioAtomIndex = 0;
+            this.IOAtomPhysicalLocation = null;
+            this.ioAtomReadOrder = null;
+            this.ioAtomReadOrderIndex = 0;
             this.IODuration = TimeSpan.Zero;
             this.ioFilesInCurrentFolderIndex = 0;
             this.ioFileIndex = 0;
@@ -92,21 +107,30 @@ namespace Carnassial.Images
             this.transactionSequence = null;
             this.TransactionFileCount = 0;
 
+            // size tasks to processor topology
+            // Compute is jpeg decode bound and gains little from SMT, so compute tasks are sized to physical cores. IO tasks
+            // spend most of their time waiting on reads. With SMT they and the UI thread fit on the sibling logical processors;
+            // without it a core is left for them. Efficiency cores on hybrid processors are included since compute atoms are
+            // taken dynamically and slower cores simply complete fewer of them.
             this.ioTaskCount = 2;
-            this.computeTaskCount = Processor.PhysicalCores - this.ioTaskCount;
+            int coresReservedForIOAndUI = Processor.LogicalProcessors > Processor.PhysicalCores ? 0 : 1;
+            this.computeTaskCount = Math.Max(Processor.PhysicalCores - coresReservedForIOAndUI, 1);
             this.ioTasksActive = 0;
 
+            this.computeAtomInProgressByTask = new int[this.computeTaskCount];
             this.computeTasks = new Task<int>[this.computeTaskCount];
             for (int computeTaskIndex = 0; computeTaskIndex < this.computeTaskCount; ++computeTaskIndex)
             {
+                this.computeAtomInProgressByTask[computeTaskIndex] = -1;
                 this.computeTasks[computeTaskIndex] = null;
             }
 
             this.ioTasks = new Task[this.ioTaskCount];
-            this.ioAtomsCompletedByTask = new int[this.ioTaskCount];
+            this.ioAtomsInProgressByTask = new int[this.ioTaskCount][];
             for (int ioTaskIndex = 0; ioTaskIndex < this.ioTaskCount; ++ioTaskIndex)
             {
-                this.ioAtomsCompletedByTask[ioTaskIndex] = -1;
+                this.ioAtomsInProgressByTask[ioTaskIndex] = new int[Constant.Images.LoadAtomsPerIOBatch];
+                Array.Fill(this.ioAtomsInProgressByTask[ioTaskIndex], -1);
                 this.ioTasks[ioTaskIndex] = null;
             }
         }
@@ -131,6 +155,7 @@ namespace Carnassial.Images
 
             if (disposing)
             {
+                this.computeAtoms?.Dispose();
                 this.computeTasks.Dispose();
                 this.ioFilesByRelativePathEnumerator.Dispose();
                 this.ioTasks.Dispose();
@@ -146,160 +171,178 @@ namespace Carnassial.Images
         protected void AddToSequence()
         {
             Debug.Assert((this.fileLoads != null) && (this.transactionSequence != null));
-            this.TransactionFileCount += this.transactionSequence.AddToSequence(this.fileLoads, this.addFileStartIndex, this.addFileStopIndex - this.addFileStartIndex);
+            int length = this.addFileStopIndex - this.addFileStartIndex;
+            this.TransactionFileCount += this.transactionSequence.AddToSequence(this.fileLoads, this.addFileStartIndex, length);
+            this.OnAddedToSequence(this.fileLoads, this.addFileStartIndex, length);
             this.addFilesInProgress = false;
             this.addFileStartIndex = this.addFileStopIndex;
         }
 
-        protected FileLoadAtom? GetNextComputeAtom(int computeTaskNumber)
+        private void CompleteComputeAtom(int atomIndex)
         {
-            FileLoadAtom? atom = null;
-            while (atom == null)
+            // advance the count of files completed over the contiguous run of computed atoms
+            // Compute tasks finish atoms out of order, so files are only made available for addition to the transaction once all
+            // preceding atoms have also been computed.
+            Debug.Assert((this.computeAtomsCompleted != null) && (this.loadAtoms != null));
+            lock (this.computeAtomsCompleted)
             {
-                if (this.isExceptional || this.ShouldExitCurrentIteration)
+                this.computeAtomsCompleted[atomIndex] = true;
+                while ((this.computeAtomWatermark < this.computeAtomsCompleted.Length) && this.computeAtomsCompleted[this.computeAtomWatermark])
                 {
-                    return null;
+                    this.OnComputeAtomCompleted(this.loadAtoms[this.computeAtomWatermark]);
+                    this.computeFileIndex += this.loadAtoms[this.computeAtomWatermark].HasSecondFile ? 2 : 1;
+                    ++this.computeAtomWatermark;
                 }
+            }
+        }
 
-                int atomIndex = -1;
-                if (this.computeAtomIndex < this.ioAtomsCompletedByTask.Min())
-                {
-                    Debug.Assert(this.loadAtoms != null);
-                    lock (this.loadAtoms)
-                    {
-                        if (this.computeAtomIndex < this.ioAtomsCompletedByTask.Min())
-                        {
-                            atomIndex = this.computeAtomIndex++;
-                            atom = this.loadAtoms[atomIndex];
-                            if (atom.HasSecondFile)
-                            {
-                                this.computeFileIndex += 2;
-                            }
-                            else
-                            {
-                                ++this.computeFileIndex;
-                            }
-                        }
-                    }
-                }
-                else if (this.ioTasksActive == 0)
-                {
-                    if (this.computeAtomIndex < this.ioAtomIndex)
-                    {
-                        Debug.Assert(this.loadAtoms != null);
-                        lock (this.loadAtoms)
-                        {
-                            if (this.computeAtomIndex < this.ioAtomIndex)
-                            {
-                                atomIndex = this.computeAtomIndex++;
-                                atom = this.loadAtoms[atomIndex];
-                                if (atom.HasSecondFile)
-                                {
-                                    this.computeFileIndex += 2;
-                                }
-                                else
-                                {
-                                    ++this.computeFileIndex;
-                                }
-                            }
-                        }
-                    }
-                    else if (this.computeAtomIndex >= this.ioAtomIndex)
-                    {
-                        return null;
-                    }
-                }
-                if (atomIndex < 0)
-                {
-                    Thread.Sleep(TimeSpan.FromMilliseconds(2.5));
-                }
+        /// <summary>
+        /// Hand off an atom obtained from <see cref="GetNextIOAtoms(int, FileLoadAtom[])"/> to the compute tasks once it's loaded.
+        /// Atoms not handed off are handed off when the IO task asks for its next atoms or exits.
+        /// </summary>
+        protected void CompleteIOAtom(int ioThreadID, int batchIndex)
+        {
+            // the handoff blocks if the compute tasks are too far behind, which bounds the number of loaded atoms held in
+            // memory
+            // If the compute tasks are exiting the handoff is cancelled and the atom's dropped.
+            Debug.Assert(this.computeAtoms != null);
+            int atomIndex = this.ioAtomsInProgressByTask[ioThreadID][batchIndex];
+            if (atomIndex >= 0)
+            {
+                this.computeAtoms.Add(atomIndex);
+                this.ioAtomsInProgressByTask[ioThreadID][batchIndex] = -1;
             }
+        }
 
-            return atom;
+        private void CompleteIOAtoms(int ioThreadID)
+        {
+            // the atoms an IO task was working on are loaded once the task asks for its next atoms or exits
+            for (int batchIndex = 0; batchIndex < this.ioAtomsInProgressByTask[ioThreadID].Length; ++batchIndex)
+            {
+                this.CompleteIOAtom(ioThreadID, batchIndex);
+            }
+        }
+
+        protected FileLoadAtom? GetNextComputeAtom(int computeTaskNumber)
+        {
+            // the atom a compute task was working on is complete once the task asks for its next atom
+            int previousAtomIndex = this.computeAtomInProgressByTask[computeTaskNumber];
+            if (previousAtomIndex >= 0)
+            {
+                this.CompleteComputeAtom(previousAtomIndex);
+                this.computeAtomInProgressByTask[computeTaskNumber] = -1;
+            }
+
+            // block until the IO tasks hand off an atom or all IO tasks have exited
+            // Exit is checked again after an atom's taken as the task may have been blocked for some time.
+            // On early exit IO tasks are released in case they're blocked handing off atoms.
+            Debug.Assert((this.computeAtoms != null) && (this.loadAtoms != null));
+            if (this.isExceptional || this.ShouldExitCurrentIteration)
+            {
+                this.computeAtoms.Cancel();
+                return null;
+            }
+            if (this.computeAtoms.TryTake(computeTaskNumber, out int atomIndex) == false)
+            {
+                return null;
+            }
+            if (this.isExceptional || this.ShouldExitCurrentIteration)
+            {
+                this.computeAtoms.Cancel();
+                return null;
+            }
+
+            this.computeAtomInProgressByTask[computeTaskNumber] = atomIndex;
+            return this.loadAtoms[atomIndex];
         }
 
         protected FileLoadAtom? GetNextIOAtom(int ioThreadID)
         {
+            this.CompleteIOAtoms(ioThreadID);
             if (this.isExceptional || this.ShouldExitCurrentIteration)
             {
                 return null;
             }
 
-            Debug.Assert((this.ioFilesInCurrentFolder != null) && (this.transactionSequence != null));
-            int atomIndex;
-            int atomOffset;
-            string firstFileName;
-            string relativePath;
-            string? secondFileName = null;
-            lock (this.transactionSequence)
+            if (this.TryGetNextIOAtom(out int atomIndex, out FileLoadAtom? loadAtom) == false)
             {
-                while (this.ioFilesInCurrentFolderIndex >= this.ioFilesInCurrentFolder.Count)
-                {
-                    if (this.ioFilesByRelativePathEnumerator.MoveNext() == false)
-                    {
-                        return null;
-                    }
-                    this.ioFilesInCurrentFolder = this.ioFilesByRelativePathEnumerator.Current.Value;
-                    Debug.Assert(this.ioFilesInCurrentFolder != null, "List of files in folder is unexpectedly null.");
-                    this.ioFilesInCurrentFolderIndex = 0;
-                }
+                return null;
+            }
+            this.ioAtomsInProgressByTask[ioThreadID][0] = atomIndex;
+            return loadAtom;
+        }
 
-                firstFileName = this.ioFilesInCurrentFolder[this.ioFilesInCurrentFolderIndex];
-                Debug.Assert(firstFileName != null, "Unexpected null entry in collection of files to add.");
+        /// <summary>
+        /// Get up to atoms.Length atoms for an IO task to load concurrently. Atoms are handed off to the compute tasks by
+        /// <see cref="CompleteIOAtom(int, int)"/> or when the task next calls this method.
+        /// </summary>
+        /// <returns>The number of atoms obtained, zero if the IO task should exit.</returns>
+        protected int GetNextIOAtoms(int ioThreadID, FileLoadAtom[] atoms)
+        {
+            Debug.Assert(atoms.Length <= this.ioAtomsInProgressByTask[ioThreadID].Length, $"Batch of {atoms.Length} atoms exceeds maximum batch size of {this.ioAtomsInProgressByTask[ioThreadID].Length}.");
+            this.CompleteIOAtoms(ioThreadID);
+            if (this.isExceptional || this.ShouldExitCurrentIteration)
+            {
+                return 0;
+            }
 
-                if (this.ioFilesInCurrentFolderIndex + 1 < this.ioFilesInCurrentFolder.Count)
-                {
-                    secondFileName = this.ioFilesInCurrentFolder[this.ioFilesInCurrentFolderIndex + 1];
-                    Debug.Assert(secondFileName != null, "Unexpected null entry in collection of files to add.");
+            int atomCount = 0;
+            while ((atomCount < atoms.Length) && this.TryGetNextIOAtom(out int atomIndex, out FileLoadAtom? loadAtom))
+            {
+                atoms[atomCount] = loadAtom;
+                this.ioAtomsInProgressByTask[ioThreadID][atomCount] = atomIndex;
+                ++atomCount;
+            }
+            return atomCount;
+        }
 
-                    // in the case of an alternating sequence of images and videos, try to align atom such that file N is a video
-                    // This enables FolderLoadAtom to infer video date times from the metadata of preceeding .jpg files.  The
-                    // possibilities here are
-                    //
-                    // n is video  n+1 is video  n+2 is video
-                    // false       false         false         => two file atom ok
-                    // false       false         true          => one file atom preferred
-                    // false       true          false         => two file atom ok
-                    // false       true          true          => two file atom ok
-                    // true        false         false         => two file atom ok
-                    // true        false         true          => one file atom preferred
-                    // true        true          false         => two file atom ok
-                    // true        true          true          => two file atom ok
-                    //
-                    // It follows that if n+1 is not a video then n+2 should be checked and an atom containing one file returned
-                    // so that the next call aligns with n+2 being a video.
-                    if ((FileTable.IsVideo(secondFileName) == false) && (this.ioFilesInCurrentFolderIndex + 2 < this.ioFilesInCurrentFolder.Count))
-                    {
-                        string fileNameNPlus2 = this.ioFilesInCurrentFolder[this.ioFilesInCurrentFolderIndex + 2];
-                        if (FileTable.IsVideo(fileNameNPlus2))
-                        {
-                            secondFileName = null;
-                        }
-                    }
-                }
+        /// <summary>
+        /// Called once files have been added to the transaction sequence, in file order.
+        /// </summary>
+        protected virtual void OnAddedToSequence(IList<FileLoad> fileLoads, int offset, int length)
+        {
+            // nothing to do by default
+        }
 
-                atomIndex = this.ioAtomIndex++;
-                atomOffset = this.ioFileIndex;
-                relativePath = this.ioFilesByRelativePathEnumerator.Current.Key;
-                int increment = secondFileName != null ? 2 : 1;
-                this.ioFileIndex += increment;
-                this.ioFilesInCurrentFolderIndex += increment;
-            }
+        /// <summary>
+        /// Called once an atom and all preceding atoms have been computed, in file order and before the atom's files can be added
+        /// to the transaction sequence. Calls are serialized, so overrides should be brief.
+        /// </summary>
+        protected virtual void OnComputeAtomCompleted(FileLoadAtom loadAtom)
+        {
+            // nothing to do by default
+        }
 
-            Debug.Assert((this.fileLoads != null) && (this.loadAtoms != null));
-            FileLoad firstLoad = new(firstFileName);
-            this.fileLoads[atomOffset] = firstLoad;
-            FileLoad secondLoad = FileLoad.NoLoad;
-            if (secondFileName != null)
+        private void OrderIOAtomsByPhysicalLocation(Func<FileLoadAtom, long> getPhysicalLocation)
+        {
+            // create all atoms up front in file order
+            // Atom indices and file offsets are therefore the same as when atoms are created as they're read, so compute still
+            // completes atoms into the transaction in file order and only the order of reads changes.
+            Debug.Assert(this.loadAtoms != null);
+            int atomCount = 0;
+            while (this.TryCreateNextIOAtom(out int _, out FileLoadAtom? _))
             {
-                secondLoad = new FileLoad(secondFileName);
-                this.fileLoads[atomOffset + 1] = secondLoad;
+                ++atomCount;
             }
-            this.ioAtomsCompletedByTask[ioThreadID] = atomIndex - 1;
 
-            FileLoadAtom loadAtom = new(relativePath, firstLoad, secondLoad, atomOffset);
-            this.loadAtoms[atomIndex] = loadAtom;
-            return loadAtom;
+            // sort atoms by the location of their first file
+            // Atoms whose location is unknown are read first, in file order. Second files of atoms are usually written
+            // immediately after the first so aren't queried.
+            long[] locations = new long[atomCount];
+            int[] readOrder = new int[atomCount];
+            for (int atomIndex = 0; atomIndex < atomCount; ++atomIndex)
+            {
+                if (this.ShouldExitCurrentIteration)
+                {
+                    return;
+                }
+
+                long location = getPhysicalLocation.Invoke(this.loadAtoms[atomIndex]);
+                locations[atomIndex] = location >= 0 ? location : Int64.MinValue + atomIndex;
+                readOrder[atomIndex] = atomIndex;
+            }
+            Array.Sort(locations, readOrder);
+            this.ioAtomReadOrder = readOrder;
         }
 
         protected async Task RunTasksAsync(WindowedTransactionSequence<FileLoad> transactionSequence, SortedDictionary<string, List<string>> filesToLoadByRelativePath, int filesToLoad)
@@ -326,9 +369,21 @@ namespace Carnassial.Images
             this.ioFilesByRelativePathEnumerator.MoveNext();
             this.ioFilesInCurrentFolder = this.ioFilesByRelativePathEnumerator.Current.Value;
             Debug.Assert(this.ioFilesInCurrentFolder != null, "List of files in folder is unexpectedly null.");
+            WorkStealingScheduler<int> computeAtoms = new(this.computeTaskCount, Constant.Images.LoadAtomsQueuedPerComputeTask);
+            this.computeAtoms = computeAtoms;
+            this.computeAtomsCompleted = new bool[filesToLoad];
             this.loadAtoms = new FileLoadAtom[filesToLoad];
             this.transactionSequence = transactionSequence;
 
+            // on media where seeks are expensive, such as hard drives and memory cards, files may be read substantially faster
+            // in physical order than in name order
+            // Locations are queried off the calling thread as each query opens a file.
+            if (this.IOAtomPhysicalLocation != null)
+            {
+                Func<FileLoadAtom, long> getPhysicalLocation = this.IOAtomPhysicalLocation;
+                await Task.Run(() => this.OrderIOAtomsByPhysicalLocation(getPhysicalLocation)).ConfigureAwait(false);
+            }
+
             this.ioTasksActive = this.ioTaskCount;
             for (int ioTask = 0; ioTask < this.ioTaskCount; ++ioTask)
             {
@@ -344,6 +399,16 @@ namespace Carnassial.Images
                         this.isExceptional = true;
                         throw;
                     }
+                    finally
+                    {
+                        // hand off any atom remaining from an early exit and release the compute tasks once all IO is done
+                        // On exceptions compute tasks are released immediately so they can exit.
+                        this.CompleteIOAtoms(ioTaskNumber);
+                        if ((Interlocked.Decrement(ref this.ioTasksActive) == 0) || this.isExceptional)
+                        {
+                            computeAtoms.CompleteAdding();
+                        }
+                    }
                 });
             }
 
@@ -352,6 +417,9 @@ namespace Carnassial.Images
                 int computeTaskNumber = computeTask;
                 this.computeTasks[computeTask] = Task.Run(() =>
                 {
+                    // compute tasks already occupy the cores not reserved for IO and UI, so image kernels run on each task's thread
+                    // rather than spreading their blocks across cores
+                    MemoryImage.ProcessBlocksOnCurrentThread = true;
                     try
                     {
                         return this.ComputeTaskBody.Invoke(computeTaskNumber);
@@ -359,8 +427,13 @@ namespace Carnassial.Images
                     catch
                     {
                         this.isExceptional = true;
+                        computeAtoms.Cancel();
                         throw;
                     }
+                    finally
+                    {
+                        MemoryImage.ProcessBlocksOnCurrentThread = false;
+                    }
                 });
             }
 
@@ -368,7 +441,6 @@ namespace Carnassial.Images
             {
                 await Task.WhenAll(this.ioTasks!).ConfigureAwait(false);
             }
-            this.ioTasksActive = 0;
             this.IODuration = stopwatch.Elapsed;
 
             if (this.computeTasks != null)
@@ -401,5 +473,103 @@ namespace Carnassial.Images
             this.addFilesInProgress = (this.addFileStopIndex - this.addFileStartIndex) > Constant.Database.NominalRowsPerTransactionFill;
             return this.addFilesInProgress;
         }
+
+        private bool TryCreateNextIOAtom(out int atomIndex, [NotNullWhen(true)] out FileLoadAtom? loadAtom)
+        {
+            Debug.Assert((this.ioFilesInCurrentFolder != null) && (this.transactionSequence != null));
+            int atomOffset;
+            string firstFileName;
+            string relativePath;
+            string? secondFileName = null;
+            lock (this.transactionSequence)
+            {
+                while (this.ioFilesInCurrentFolderIndex >= this.ioFilesInCurrentFolder.Count)
+                {
+                    if (this.ioFilesByRelativePathEnumerator.MoveNext() == false)
+                    {
+                        atomIndex = -1;
+                        loadAtom = null;
+                        return false;
+                    }
+                    this.ioFilesInCurrentFolder = this.ioFilesByRelativePathEnumerator.Current.Value;
+                    Debug.Assert(this.ioFilesInCurrentFolder != null, "List of files in folder is unexpectedly null.");
+                    this.ioFilesInCurrentFolderIndex = 0;
+                }
+
+                firstFileName = this.ioFilesInCurrentFolder[this.ioFilesInCurrentFolderIndex];
+                Debug.Assert(firstFileName != null, "Unexpected null entry in collection of files to add.");
+
+                if (this.ioFilesInCurrentFolderIndex + 1 < this.ioFilesInCurrentFolder.Count)
+                {
+                    secondFileName = this.ioFilesInCurrentFolder[this.ioFilesInCurrentFolderIndex + 1];
+                    Debug.Assert(secondFileName != null, "Unexpected null entry in collection of files to add.");
+
+                    // in the case of an alternating sequence of images and videos, try to align atom such that file N is a video
+                    // This enables FolderLoadAtom to infer video date times from the metadata of preceeding .jpg files.  The
+                    // possibilities here are
+                    //
+                    // n is video  n+1 is video  n+2 is video
+                    // false       false         false         => two file atom ok
+                    // false       false         true          => one file atom preferred
+                    // false       true          false         => two file atom ok
+                    // false       true          true          => two file atom ok
+                    // true        false         false         => two file atom ok
+                    // true        false         true          => one file atom preferred
+                    // true        true          false         => two file atom ok
+                    // true        true          true          => two file atom ok
+                    //
+                    // It follows that if n+1 is not a video then n+2 should be checked and an atom containing one file returned
+                    // so that the next call aligns with n+2 being a video.
+                    if ((FileTable.IsVideo(secondFileName) == false) && (this.ioFilesInCurrentFolderIndex + 2 < this.ioFilesInCurrentFolder.Count))
+                    {
+                        string fileNameNPlus2 = this.ioFilesInCurrentFolder[this.ioFilesInCurrentFolderIndex + 2];
+                        if (FileTable.IsVideo(fileNameNPlus2))
+                        {
+                            secondFileName = null;
+                        }
+                    }
+                }
+
+                atomIndex = this.ioAtomIndex++;
+                atomOffset = this.ioFileIndex;
+                relativePath = this.ioFilesByRelativePathEnumerator.Current.Key;
+                int increment = secondFileName != null ? 2 : 1;
+                this.ioFileIndex += increment;
+                this.ioFilesInCurrentFolderIndex += increment;
+            }
+
+            Debug.Assert((this.fileLoads != null) && (this.loadAtoms != null));
+            FileLoad firstLoad = new(firstFileName);
+            this.fileLoads[atomOffset] = firstLoad;
+            FileLoad secondLoad = FileLoad.NoLoad;
+            if (secondFileName != null)
+            {
+                secondLoad = new FileLoad(secondFileName);
+                this.fileLoads[atomOffset + 1] = secondLoad;
+            }
+            loadAtom = new(relativePath, firstLoad, secondLoad, atomOffset);
+            this.loadAtoms[atomIndex] = loadAtom;
+            return true;
+        }
+
+        private bool TryGetNextIOAtom(out int atomIndex, [NotNullWhen(true)] out FileLoadAtom? loadAtom)
+        {
+            if (this.ioAtomReadOrder == null)
+            {
+                return this.TryCreateNextIOAtom(out atomIndex, out loadAtom);
+            }
+
+            Debug.Assert(this.loadAtoms != null);
+            int readIndex = Interlocked.Increment(ref this.ioAtomReadOrderIndex) - 1;
+            if (readIndex >= this.ioAtomReadOrder.Length)
+            {
+                atomIndex = -1;
+                loadAtom = null;
+                return false;
+            }
+            atomIndex = this.ioAtomReadOrder[readIndex];
+            loadAtom = this.loadAtoms[atomIndex];
+            return true;
+        }
     }
 }
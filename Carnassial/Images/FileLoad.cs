@@ -13,6 +13,8 @@ namespace Carnassial.Images
         public string? FileName { get; private set; }
         public JpegImage? Jpeg { get; set; }
         public MetadataReadResults MetadataReadResult { get; set; }
+        public MemoryImage? Thumbnail { get; set; }
+        public int ThumbnailInfoBarHeight { get; set; }
 
         public FileLoad(ImageRow file)
         {
@@ -21,6 +23,8 @@ namespace Carnassial.Images
             this.FileName = file.FileName;
             this.Jpeg = null;
             this.MetadataReadResult = MetadataReadResults.None;
+            this.Thumbnail = null;
+            this.ThumbnailInfoBarHeight = 0;
         }
 
         public FileLoad(string? fileName)
@@ -30,6 +34,8 @@ namespace Carnassial.Images
             this.FileName = fileName;
             this.Jpeg = null;
             this.MetadataReadResult = MetadataReadResults.None;
+            this.Thumbnail = null;
+            this.ThumbnailInfoBarHeight = 0;
         }
 
         public void Dispose()
@@ -1,9 +1,12 @@
 ﻿using Carnassial.Data;
 using System;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.Diagnostics;
+using System.Diagnostics.CodeAnalysis;
 using System.Globalization;
 using System.IO;
+using System.Threading.Tasks;
 
 namespace Carnassial.Images
 {
@@ -64,7 +67,7 @@ namespace Carnassial.Images
                     }
                     if ((firstProperties == null) || (firstProperties.HasColorationAndLuminosity == false))
                     {
-                        firstProperties = this.First.Jpeg.GetProperties(Constant.Images.NoThumbnailClassificationRequestedWidthInPixels, ref preallocatedImage);
+                        firstProperties = this.First.Jpeg.GetProperties(Constant.Images.NoThumbnailClassificationRequestedWidthInPixels, darkLuminosityThreshold, ref preallocatedImage);
                     }
                     if (firstProperties.HasColorationAndLuminosity)
                     {
@@ -113,13 +116,17 @@ namespace Carnassial.Images
             return firstProperties;
         }
 
-        public void ClassifyFromThumbnails(ref MemoryImage? preallocatedThumbnail)
+        public void ClassifyFromThumbnails(string imageSetFolderPath, ref MemoryImage? preallocatedThumbnail)
         {
             Debug.Assert(this.First.File != null, "First file unexpectedly null.");
             bool skipFileClassification = CarnassialSettings.Default.SkipFileClassification;
             if (this.First.File.IsVideo)
             {
                 this.First.File.Classification = FileClassification.Video;
+                if ((skipFileClassification == false) && (this.First.File is VideoRow video))
+                {
+                    FileLoadAtom.UpdateVideoFromKeyframeStrip(imageSetFolderPath, video);
+                }
             }
             else if (skipFileClassification)
             {
@@ -141,6 +148,8 @@ namespace Carnassial.Images
                         {
                             this.First.File.Classification = thumbnailProperties.EvaluateNewClassification(CarnassialSettings.Default.DarkLuminosityThreshold);
                             this.First.MetadataReadResult |= MetadataReadResults.Classification;
+                            this.First.File.Statistics = thumbnailProperties.Statistics;
+                            FileLoadAtom.RetainThumbnail(this.First, thumbnailProperties.InfoBarHeight, ref preallocatedThumbnail);
                         }
                     }
                 }
@@ -155,6 +164,10 @@ namespace Carnassial.Images
                 if (this.Second.File!.IsVideo)
                 {
                     this.Second.File.Classification = FileClassification.Video;
+                    if ((skipFileClassification == false) && (this.Second.File is VideoRow video))
+                    {
+                        FileLoadAtom.UpdateVideoFromKeyframeStrip(imageSetFolderPath, video);
+                    }
                 }
                 else if (skipFileClassification)
                 {
@@ -176,6 +189,8 @@ namespace Carnassial.Images
                             {
                                 this.Second.File.Classification = thumbnailProperties.EvaluateNewClassification(CarnassialSettings.Default.DarkLuminosityThreshold);
                                 this.Second.MetadataReadResult |= MetadataReadResults.Classification;
+                                this.Second.File.Statistics = thumbnailProperties.Statistics;
+                                FileLoadAtom.RetainThumbnail(this.Second, thumbnailProperties.InfoBarHeight, ref preallocatedThumbnail);
                             }
                         }
                     }
@@ -187,26 +202,41 @@ namespace Carnassial.Images
             }
         }
 
-        public bool CreateAndAppendFiles(Dictionary<string, HashSet<string>> fileNamesByRelativePath, FileTable files)
+        public bool CreateFiles(Dictionary<string, HashSet<string>> fileNamesByRelativePath, FileTable files)
         {
             bool databaseHasFilesInFolder = fileNamesByRelativePath.TryGetValue(this.RelativePath, out HashSet<string>? filesInFolder);
             Debug.Assert(this.First.FileName != null);
             if ((databaseHasFilesInFolder == false) || (filesInFolder!.Contains(this.First.FileName) == false))
             {
-                this.First.File = files.CreateAndAppendFile(this.First.FileName, this.RelativePath);
+                this.First.File = files.CreateFile(this.First.FileName, this.RelativePath);
             }
 
             if (this.Second.FileName != null)
             {
                 if ((databaseHasFilesInFolder == false) || (filesInFolder!.Contains(this.Second.FileName) == false))
                 {
-                    this.Second.File = files.CreateAndAppendFile(this.Second.FileName, this.RelativePath);
+                    this.Second.File = files.CreateFile(this.Second.FileName, this.RelativePath);
                 }
             }
 
             return this.HasAtLeastOneFile;
         }
 
+        private static async Task CreateJpegAsync(FileLoad fileLoad, string imageSetFolderPath, bool checkFilesExist)
+        {
+            if (FileLoadAtom.TryGetJpegPath(fileLoad, imageSetFolderPath, checkFilesExist, out string? filePath))
+            {
+                try
+                {
+                    fileLoad.Jpeg = await JpegImage.OpenAsync(filePath).ConfigureAwait(false);
+                }
+                catch (IOException)
+                {
+                    fileLoad.File!.Classification = FileClassification.Corrupt;
+                }
+            }
+        }
+
         public void CreateJpegs(string imageSetFolderPath)
         {
             this.CreateJpegs(imageSetFolderPath, true);
@@ -214,85 +244,44 @@ namespace Carnassial.Images
 
         public void CreateJpegs(string imageSetFolderPath, bool checkFilesExist)
         {
-            if (this.First.File != null)
+            if (FileLoadAtom.TryGetJpegPath(this.First, imageSetFolderPath, checkFilesExist, out string? firstFilePath))
             {
-                string? firstFilePath = null;
-                if (checkFilesExist)
+                try
                 {
-                    FileInfo firstFileInfo = this.First.File.GetFileInfo(imageSetFolderPath);
-                    if (firstFileInfo.Exists)
-                    {
-                        firstFilePath = firstFileInfo.FullName;
-                    }
+                    this.First.Jpeg = new JpegImage(firstFilePath);
                 }
-                else
+                catch (IOException)
                 {
-                    firstFilePath = this.First.File.GetFilePath(imageSetFolderPath);
+                    this.First.File!.Classification = FileClassification.Corrupt;
                 }
+            }
 
-                if (firstFilePath != null)
+            if (this.HasSecondFile && FileLoadAtom.TryGetJpegPath(this.Second, imageSetFolderPath, checkFilesExist, out string? secondFilePath))
+            {
+                try
                 {
-                    if (this.First.File.IsVideo)
-                    {
-                        this.First.File.Classification = FileClassification.Video;
-                    }
-                    else
-                    {
-                        try
-                        {
-                            this.First.Jpeg = new JpegImage(firstFilePath);
-                        }
-                        catch (IOException)
-                        {
-                            this.First.File.Classification = FileClassification.Corrupt;
-                        }
-                    }
+                    this.Second.Jpeg = new JpegImage(secondFilePath);
                 }
-                else
+                catch (IOException)
                 {
-                    this.First.File.Classification = FileClassification.NoLongerAvailable;
+                    this.Second.File!.Classification = FileClassification.Corrupt;
                 }
             }
+        }
 
+        /// <summary>
+        /// Asynchronous version of <see cref="CreateJpegs(string, bool)"/>. Reads of both files' metadata are queued before
+        /// returning.
+        /// </summary>
+        public Task CreateJpegsAsync(string imageSetFolderPath, bool checkFilesExist)
+        {
+            Task firstJpeg = FileLoadAtom.CreateJpegAsync(this.First, imageSetFolderPath, checkFilesExist);
             if (this.HasSecondFile)
             {
-                string? secondFilePath = null;
-                if (checkFilesExist)
-                {
-                    FileInfo secondFileInfo = this.Second.File!.GetFileInfo(imageSetFolderPath);
-                    if (secondFileInfo.Exists)
-                    {
-                        secondFilePath = secondFileInfo.FullName;
-                    }
-                }
-                else
-                {
-                    secondFilePath = this.Second.File!.GetFilePath(imageSetFolderPath);
-                }
-
-                if (secondFilePath != null)
-                {
-                    if (this.Second.File!.IsVideo)
-                    {
-                        this.Second.File.Classification = FileClassification.Video;
-                    }
-                    else
-                    {
-                        try
-                        {
-                            this.Second.Jpeg = new JpegImage(this.Second.File.GetFilePath(imageSetFolderPath));
-                        }
-                        catch (IOException)
-                        {
-                            this.Second.File.Classification = FileClassification.Corrupt;
-                        }
-                    }
-                }
-                else
-                {
-                    this.Second.File!.Classification = FileClassification.NoLongerAvailable;
-                }
+                Task secondJpeg = FileLoadAtom.CreateJpegAsync(this.Second, imageSetFolderPath, checkFilesExist);
+                return Task.WhenAll(firstJpeg, secondJpeg);
             }
+            return firstJpeg;
         }
 
         public void Dispose()
@@ -391,6 +380,23 @@ namespace Carnassial.Images
         // duplicate transaction and task code as well as an alternate FileLoadAtom implementation for relatively infrequent
         // reclassify, metadata, and datetime reread operations.  Carnassial's present implementation accepts the relatively small
         // runtime cost of adapting FileLoads to a populated file table over the cost of developing and maintaining the alternative.
+        // only color images are scored against and update backgrounds as greyscale night images differ from daytime backgrounds
+        // throughout
+        // Compute tasks finish atoms out of order, so color images' thumbnails are kept with their files until
+        // UpdateBackgrounds() is called in file order rather than being scored as soon as they're decoded. The compute task
+        // decodes its next thumbnail into a new buffer.
+        private static void RetainThumbnail(FileLoad fileLoad, int infoBarHeight, ref MemoryImage? thumbnail)
+        {
+            if (fileLoad.File!.Classification != FileClassification.Color)
+            {
+                return;
+            }
+
+            fileLoad.Thumbnail = thumbnail;
+            fileLoad.ThumbnailInfoBarHeight = infoBarHeight;
+            thumbnail = null;
+        }
+
         public void SetFiles(Dictionary<string, Dictionary<string, ImageRow>> filesByRelativePathAndName)
         {
             Debug.Assert(this.First.FileName != null);
@@ -405,5 +411,82 @@ namespace Carnassial.Images
                 Debug.Assert(String.Equals(this.RelativePath, this.Second.File.RelativePath, StringComparison.OrdinalIgnoreCase), String.Create(CultureInfo.InvariantCulture, $"Relative path of atom '{this.RelativePath}' doesn't match relative path of first file '{this.Second.File.RelativePath}'."));
             }
         }
+
+        private static bool TryGetJpegPath(FileLoad fileLoad, string imageSetFolderPath, bool checkFilesExist, [NotNullWhen(true)] out string? filePath)
+        {
+            filePath = null;
+            if (fileLoad.File == null)
+            {
+                return false;
+            }
+
+            if (checkFilesExist)
+            {
+                FileInfo fileInfo = fileLoad.File.GetFileInfo(imageSetFolderPath);
+                if (fileInfo.Exists == false)
+                {
+                    fileLoad.File.Classification = FileClassification.NoLongerAvailable;
+                    return false;
+                }
+                filePath = fileInfo.FullName;
+            }
+            else
+            {
+                filePath = fileLoad.File.GetFilePath(imageSetFolderPath);
+            }
+
+            if (fileLoad.File.IsVideo)
+            {
+                fileLoad.File.Classification = FileClassification.Video;
+                filePath = null;
+                return false;
+            }
+            return true;
+        }
+
+        // scores are against the background as it was when the file was added, so early files in a folder are scored against
+        // backgrounds of only a few images
+        private static void UpdateBackground(ConcurrentDictionary<string, BackgroundModel> backgrounds, string relativePath, ImageRow file, MemoryImage thumbnail, int infoBarHeight)
+        {
+            BackgroundModel background = backgrounds.GetOrAdd(relativePath, (string path) => new BackgroundModel(path, thumbnail.PixelWidth, thumbnail.PixelHeight));
+            if (background.TryUpdate(thumbnail, infoBarHeight, null, out double? changeScore))
+            {
+                file.ChangeScore = changeScore;
+            }
+        }
+
+        /// <summary>
+        /// Score the atom's color images against their folder's background and add their thumbnails to it. Backgrounds depend on
+        /// the order they're updated in, so this is called in file order for scores to be repeatable.
+        /// </summary>
+        public void UpdateBackgrounds(ConcurrentDictionary<string, BackgroundModel> backgrounds)
+        {
+            if (this.First.Thumbnail != null)
+            {
+                FileLoadAtom.UpdateBackground(backgrounds, this.RelativePath, this.First.File!, this.First.Thumbnail, this.First.ThumbnailInfoBarHeight);
+                this.First.Thumbnail = null;
+            }
+            if (this.Second.Thumbnail != null)
+            {
+                FileLoadAtom.UpdateBackground(backgrounds, this.RelativePath, this.Second.File!, this.Second.Thumbnail, this.Second.ThumbnailInfoBarHeight);
+                this.Second.Thumbnail = null;
+            }
+        }
+
+        // videos are scored by how much their sampled frames differ from their first frame as backgrounds are modeled from still
+        // images' thumbnails, which don't match video frames' sizes
+        // Only a few frames are read, so reading them from the compute task costs little compared to reading images' jpegs.
+        // Videos where no block of any sampled frame changed are scored zero so they sort and select with empty images, even if
+        // sensor noise or compression changed enough individual pixels to give them a small nonzero score. Videos' statistics
+        // come from their first frames, which play the role images' thumbnails do, but videos stay classified as videos since
+        // selections and file counts treat the video classification as identifying video files.
+        private static void UpdateVideoFromKeyframeStrip(string imageSetFolderPath, VideoRow video)
+        {
+            if (video.TryGetKeyframeStrip(imageSetFolderPath, Constant.Images.VideoKeyframeStripFrames, out VideoKeyframeStrip? keyframeStrip))
+            {
+                video.ChangeScore = keyframeStrip.HasChange ? keyframeStrip.MaximumChangeScore : 0.0;
+                video.Statistics = keyframeStrip.FirstFrameProperties.Statistics;
+            }
+        }
     }
 }
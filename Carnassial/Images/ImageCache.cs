@@ -6,37 +6,154 @@ using System.Collections.Generic;
 using System.Diagnostics;
 using System.Diagnostics.CodeAnalysis;
 using System.Globalization;
+using System.Threading;
 using System.Threading.Tasks;
 
 namespace Carnassial.Images
 {
+    /// <summary>
+    /// Caches images around the current file and differences of the current file from its neighbours.
+    /// </summary>
+    /// <remarks>
+    /// Images ahead of the current file are prefetched over a window sized to the rate the user's navigating at, so that holding
+    /// an arrow key doesn't outrun the prefetches. Prefetches which fall out of the window when navigation turns or jumps are
+    /// cancelled. When navigation's faster than full resolution decoding can keep up with, images are prefetched and displayed
+    /// as previews decoded at 1/8 scale, which is several times faster, and the current file's full resolution image is loaded
+    /// once navigation pauses.
+    ///
+    /// If <see cref="DisplayWidthInPixels"/> is set, display is progressive. A file which isn't already cached is shown first as a
+    /// preview and the cache then refines it to an image decoded at the smallest scale which covers the display width, raising
+    /// <see cref="CurrentImageRefined"/> when the refined image is ready. Full resolution is decoded only when
+    /// <see cref="RequireFullResolution(bool)"/> indicates the display's zoomed in or magnified. Refinement is cancelled by
+    /// navigation to another file.
+    ///
+    /// Images are cached within a memory budget rather than by count, with each resolution of the same file cached separately.
+    /// When the budget's reached images are evicted by greedy dual size frequency, so large images which decode quickly are
+    /// evicted ahead of small or slow to load ones.
+    ///
+    /// Behind the decoded images is a second tier holding files' jpegs, which are a tenth or so the size of their decoded images
+    /// and so can be kept for a window of several hundred files. Decoding a jpeg from memory is much faster than reading it again
+    /// from a network share or USB drive, so moving back and forth across the window doesn't touch the disk and refining a
+    /// preview to full resolution decodes the jpeg the preview was decoded from.
+    ///
+    /// Frames of <see cref="Constant.Images.PyramidMinimumPixels"/> or more are refined and prefetched only to display resolution,
+    /// even when zoomed in or magnified. Detail beyond display resolution is instead decoded tile by tile from the frame's
+    /// <see cref="ImagePyramid"/>, which <see cref="TryGetCurrentPyramid(out ImagePyramid?)"/> provides, so only the part of the
+    /// frame in view or under the magnifying glass is decoded at full resolution.
+    ///
+    /// Once navigation pauses, differences of the current file and the file ahead of it from their neighbours are calculated on a
+    /// low priority thread so that stepping through differences doesn't wait on differencing. Differences are calculated at full
+    /// resolution, so they're precomputed only once the display's at full resolution or the user's asked for a difference, and
+    /// never for frames large enough to be tiled, which are decoded at full resolution only when a difference of them is
+    /// requested. Differences are cached within their
+    /// own memory budget, keyed by the files differenced, so they remain valid if navigation returns to a file. Combined differences
+    /// are merged from sums of absolute differences between pairs of adjacent files, which are kept for the most recent pairs, so
+    /// that stepping through files in combined difference mode calculates one new set of sums per file rather than differencing
+    /// three images.
+    ///
+    /// If <see cref="CompensateCameraShake"/> is set, the translation between each pair of neighbouring images is estimated before
+    /// they're differenced so that a camera shaken by wind doesn't outline every edge in the scene. Translations are kept for
+    /// the most recent pairs alongside the sums of absolute differences. If <see cref="NormalizeIllumination"/> is set, the
+    /// second image of each pair is also scaled and offset to match the first image's exposure and colour balance before it's
+    /// differenced so that files taken at dawn or dusk, or with differing infrared flash strength, aren't different throughout.
+    ///
+    /// Images can also be differenced against their folder's <see cref="BackgroundModel"/>, which picks out animals standing
+    /// still across a burst that differencing against neighbours cancels out. Background differences aren't precomputed as
+    /// they're one pass over the current image and need no other image to be loaded. Backgrounds are averaged over many files,
+    /// so they aren't compensated for camera shake or normalized for illumination.
+    /// </remarks>
     public class ImageCache : FileTableEnumerator
     {
+        private int backgroundDifferencesCalculated;
+        private TimeSpan backgroundDifferenceTime;
         private int combinedDifferencesCalculated;
         private TimeSpan combinedDifferenceTime;
+        private bool compensateCameraShake;
         private readonly Dictionary<ImageDifference, CachedImage?> differenceCache;
+        private DifferencePrecomputation? differencePrecomputation;
+        private readonly object differencePrecomputationLock;
+        private bool differencePrecomputationStopped;
+        private Thread? differencePrecomputationThread;
+        private readonly GreedyDualSizeFrequencyCache<(long PreviousID, long ID, long NextID, int BackgroundFrames, byte Threshold), CachedImage> differences;
         private int differencesCalculated;
+        private int differenceSettingsGeneration;
+        private bool differencesRequested;
         private TimeSpan differenceTime;
-        private readonly MostRecentlyUsedList<long> mostRecentlyUsedIDs;
-        private readonly ConcurrentDictionary<long, Task> prefetchesByID;
-        private readonly ConcurrentDictionary<long, CachedImage> unalteredImagesByID;
+        private bool disposed;
+        private long fullResolutionDecodes;
+        private bool fullResolutionRequired;
+        private readonly GreedyDualSizeFrequencyCache<(long ID, ImageResolution Resolution), CachedImage> images;
+        private readonly GreedyDualSizeFrequencyCache<long, byte[]> jpegs;
+        private TimeSpan mostRecentNavigation;
+        private CancellationTokenSource navigationCancellation;
+        private int navigationDirection;
+        private double navigationRate;
+        private readonly Stopwatch navigationStopwatch;
+        private bool normalizeIllumination;
+        private readonly ConcurrentDictionary<long, ImagePrefetch> prefetchesByID;
+        private ImagePyramid? pyramid;
+        private long pyramidID;
+        private readonly object pyramidLock;
+        private readonly RecentPairWindow<UInt16[]> sumsOfAbsoluteDifferences;
+        private readonly RecentPairWindow<(int X, int Y)> translations;
 
         public ImageDifference CurrentDifferenceState { get; private set; }
 
+        /// <summary>
+        /// Gets or sets the width images are displayed at. Zero, the default, displays images at full resolution.
+        /// </summary>
+        public int DisplayWidthInPixels { get; set; }
+
+        /// <summary>
+        /// Raised when the current file's image is replaced by a higher resolution one and needs to be redisplayed. Raised on the
+        /// synchronization context of the navigation which displayed the file.
+        /// </summary>
+        public event EventHandler? CurrentImageRefined;
+
         public ImageCache(FileDatabase fileDatabase)
             : base(fileDatabase)
         {
+            this.backgroundDifferencesCalculated = 0;
+            this.backgroundDifferenceTime = TimeSpan.Zero;
+            this.compensateCameraShake = true;
             this.CurrentDifferenceState = ImageDifference.Unaltered;
-            this.differenceCache = new Dictionary<ImageDifference, CachedImage?>(4);
+            this.differenceCache = new Dictionary<ImageDifference, CachedImage?>(5);
             foreach (ImageDifference differenceState in Enum.GetValues(typeof(ImageDifference)))
             {
                 this.differenceCache.Add(differenceState, null);
             }
+            this.differencePrecomputation = null;
+            this.differencePrecomputationLock = new();
+            this.differencePrecomputationStopped = false;
+            this.differencePrecomputationThread = null;
+            this.differences = new(ImageCache.GetCapacityInBytes(Constant.Images.DifferenceCacheFractionOfMemory, Constant.Images.DifferenceCacheMinimumSizeInBytes, Constant.Images.DifferenceCacheMaximumSizeInBytes));
             this.differencesCalculated = 0;
+            this.differenceSettingsGeneration = 0;
+            this.differencesRequested = false;
             this.differenceTime = TimeSpan.Zero;
-            this.mostRecentlyUsedIDs = new MostRecentlyUsedList<long>(Constant.Images.ImageCacheSize);
-            this.prefetchesByID = new ConcurrentDictionary<long, Task>();
-            this.unalteredImagesByID = new ConcurrentDictionary<long, CachedImage>();
+            this.disposed = false;
+            this.DisplayWidthInPixels = 0;
+            this.fullResolutionDecodes = 0;
+            this.fullResolutionRequired = false;
+            this.images = new(ImageCache.GetCapacityInBytes(Constant.Images.ImageCacheFractionOfMemory, Constant.Images.ImageCacheMinimumSizeInBytes, Constant.Images.ImageCacheMaximumSizeInBytes));
+            this.jpegs = new(ImageCache.GetCapacityInBytes(Constant.Images.JpegCacheFractionOfMemory, Constant.Images.JpegCacheMinimumSizeInBytes, Constant.Images.JpegCacheMaximumSizeInBytes));
+            this.mostRecentNavigation = TimeSpan.Zero;
+            this.navigationCancellation = new();
+            this.navigationDirection = 0;
+            this.navigationRate = 0.0;
+            this.navigationStopwatch = Stopwatch.StartNew();
+            this.normalizeIllumination = false;
+            this.prefetchesByID = new ConcurrentDictionary<long, ImagePrefetch>();
+            this.pyramid = null;
+            this.pyramidID = Constant.Database.InvalidID;
+            this.pyramidLock = new();
+            this.sumsOfAbsoluteDifferences = new(Constant.Images.SumsOfAbsoluteDifferencesWindowPairs);
+            this.translations = new(Constant.Images.TranslationWindowPairs, translation => (-translation.X, -translation.Y));
+        }
+
+        public double AverageBackgroundDifferenceTimeInSeconds
+        {
+            get { return this.backgroundDifferencesCalculated == 0 ? 0.0 : this.backgroundDifferenceTime.TotalSeconds / this.backgroundDifferencesCalculated; }
         }
 
         public double AverageCombinedDifferenceTimeInSeconds
@@ -49,6 +166,140 @@ namespace Carnassial.Images
             get { return this.differencesCalculated == 0 ? 0.0 : this.differenceTime.TotalSeconds / this.differencesCalculated; }
         }
 
+        /// <summary>
+        /// Gets or sets whether images are aligned to their neighbours before they're differenced. Defaults to true. Changing the
+        /// setting discards cached differences as they're no longer valid.
+        /// </summary>
+        public bool CompensateCameraShake
+        {
+            get
+            {
+                return this.compensateCameraShake;
+            }
+            set
+            {
+                lock (this.differenceCache)
+                {
+                    if (this.compensateCameraShake == value)
+                    {
+                        return;
+                    }
+
+                    this.compensateCameraShake = value;
+                    this.translations.Clear();
+                    this.DiscardDifferences();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Gets how many images have been decoded at full resolution.
+        /// </summary>
+        public long FullResolutionDecodes
+        {
+            get { return Interlocked.Read(ref this.fullResolutionDecodes); }
+        }
+
+        public long JpegHits
+        {
+            get { return this.jpegs.Hits; }
+        }
+
+        public long JpegMisses
+        {
+            get { return this.jpegs.Misses; }
+        }
+
+        /// <summary>
+        /// Gets or sets whether the second image of each pair differenced is matched to the first's illumination. Defaults to
+        /// false. Changing the setting discards cached differences as they're no longer valid.
+        /// </summary>
+        public bool NormalizeIllumination
+        {
+            get
+            {
+                return this.normalizeIllumination;
+            }
+            set
+            {
+                lock (this.differenceCache)
+                {
+                    if (this.normalizeIllumination == value)
+                    {
+                        return;
+                    }
+
+                    this.normalizeIllumination = value;
+                    this.DiscardDifferences();
+                }
+            }
+        }
+
+        // whether navigation is faster than full resolution images can be decoded and displayed
+        private bool IsNavigatingRapidly
+        {
+            get { return this.navigationRate > Constant.Images.PreviewNavigationRate; }
+        }
+
+        // resolution the current file's image is refined to
+        private ImageResolution TargetResolution
+        {
+            get { return this.fullResolutionRequired || (this.DisplayWidthInPixels <= 0) ? ImageResolution.Full : ImageResolution.Display; }
+        }
+
+        protected override void Dispose(bool disposing)
+        {
+            if (this.disposed)
+            {
+                return;
+            }
+
+            if (disposing)
+            {
+                foreach (ImagePrefetch prefetch in this.prefetchesByID.Values)
+                {
+                    prefetch.Cancel();
+                }
+                lock (this.differenceCache)
+                {
+                    this.navigationCancellation.Cancel();
+                    this.navigationCancellation.Dispose();
+                }
+                lock (this.differencePrecomputationLock)
+                {
+                    this.differencePrecomputation?.Completion.TrySetResult();
+                    this.differencePrecomputation = null;
+                    this.differencePrecomputationStopped = true;
+                    Monitor.PulseAll(this.differencePrecomputationLock);
+                }
+            }
+
+            base.Dispose(disposing);
+            this.disposed = true;
+        }
+
+        private static long GetCapacityInBytes(double fractionOfMemory, long minimumSizeInBytes, long maximumSizeInBytes)
+        {
+            // budget a fixed fraction of the machine's memory
+            // Counting images wouldn't bound memory as image sizes range from under 10 MB for 2 MP images to around 100 MB for 24 MP
+            // images.
+            long availableMemory = GC.GetGCMemoryInfo().TotalAvailableMemoryBytes;
+            return Math.Clamp((long)(fractionOfMemory * availableMemory), minimumSizeInBytes, maximumSizeInBytes);
+        }
+
+        // resolution a file's image is refined to
+        // Frames large enough to have pyramids are kept at display resolution as the display and magnifying glass use full
+        // resolution tiles.
+        private ImageResolution GetTargetResolution(long id)
+        {
+            ImageResolution targetResolution = this.TargetResolution;
+            if ((targetResolution == ImageResolution.Full) && (this.DisplayWidthInPixels > 0) && this.TryGetPyramid(id, out ImagePyramid? _))
+            {
+                return ImageResolution.Display;
+            }
+            return targetResolution;
+        }
+
         public CachedImage? GetCurrentImage()
         {
             lock (this.differenceCache)
@@ -57,6 +308,22 @@ namespace Carnassial.Images
             }
         }
 
+        private (long PreviousID, long ID, long NextID, int BackgroundFrames, byte Threshold) GetDifferenceKey(ImageDifference difference, byte threshold)
+        {
+            // called under the difference cache lock once the difference's been checked as calculable
+            // Background differences have neither a previous nor a next file, which distinguishes their keys. Backgrounds change
+            // as files are added to their folders, so background differences are also keyed by how many images their background
+            // has averaged. Differences computed against an older background then miss and age out of the cache.
+            long previousID = (difference == ImageDifference.Previous) || (difference == ImageDifference.Combined) ? this.FileDatabase.Files[this.CurrentRow - 1].ID : Constant.Database.InvalidID;
+            long nextID = (difference == ImageDifference.Next) || (difference == ImageDifference.Combined) ? this.FileDatabase.Files[this.CurrentRow + 1].ID : Constant.Database.InvalidID;
+            int backgroundFrames = 0;
+            if ((difference == ImageDifference.Background) && this.FileDatabase.Backgrounds.TryGetValue(this.Current!.RelativePath, out BackgroundModel? background))
+            {
+                backgroundFrames = background.Frames;
+            }
+            return (previousID, this.Current!.ID, nextID, backgroundFrames, threshold);
+        }
+
         private ImageDifference GetNextStateInCombinedDifferenceCycle()
         {
             Debug.Assert(this.IsFileAvailable && (this.Current.IsVideo == false), "No current file or current file is an image.");
@@ -80,8 +347,8 @@ namespace Carnassial.Images
         {
             Debug.Assert(this.IsFileAvailable && (this.Current.IsVideo == false), "No current file or current file is an image.");
 
-            // always go to unaltered from combined difference
-            if (this.CurrentDifferenceState == ImageDifference.Combined)
+            // always go to unaltered from background and combined differences
+            if ((this.CurrentDifferenceState == ImageDifference.Background) || (this.CurrentDifferenceState == ImageDifference.Combined))
             {
                 return ImageDifference.Unaltered;
             }
@@ -123,32 +390,248 @@ namespace Carnassial.Images
             return nextDifference;
         }
 
-        private void CacheImage(long id, CachedImage image)
+        private (bool CompensateCameraShake, bool NormalizeIllumination, int Generation) GetDifferenceSettings()
         {
-            lock (this.mostRecentlyUsedIDs)
+            // called under the difference cache lock so a difference is calculated with one consistent set of settings, which
+            // CompensateCameraShake and NormalizeIllumination may change on another thread while the difference is calculated
+            return (this.compensateCameraShake, this.normalizeIllumination, this.differenceSettingsGeneration);
+        }
+
+        private (int X, int Y) GetTranslation((bool CompensateCameraShake, bool NormalizeIllumination, int Generation) settings, long id, MemoryImage image, long otherID, MemoryImage otherImage)
+        {
+            // images too small to have a translation estimated are differenced untranslated
+            // Translations depend only on the images, so they're valid whichever settings they were estimated under.
+            if (settings.CompensateCameraShake == false)
+            {
+                return (0, 0);
+            }
+            if (this.translations.TryGet(id, otherID, out (int X, int Y) translation) == false)
+            {
+                image.TryGetTranslation(otherImage, out int offsetX, out int offsetY);
+                translation = (offsetX, offsetY);
+                this.translations.Add(id, otherID, translation);
+            }
+            return translation;
+        }
+
+        private void CacheImage(long id, CachedImage image, TimeSpan loadTime)
+        {
+            // images are weighted by how long they took to load, so images which are slow to decode or are on slow media are
+            // more likely to be kept
+            this.images.AddOrUpdate((id, image.Resolution), image, image.SizeInBytes, loadTime.TotalMilliseconds);
+
+            // lower resolution images of a file aren't needed once a higher resolution image is available
+            for (ImageResolution resolution = ImageResolution.Preview; resolution < image.Resolution; ++resolution)
             {
-                // cache the image, replacing any existing image with the one passed
-                this.unalteredImagesByID.AddOrUpdate(id,
-                    (long newID) =>
+                this.images.TryRemove((id, resolution));
+            }
+        }
+
+        private void CancelNavigation()
+        {
+            // called under the difference cache lock
+            this.navigationCancellation.Cancel();
+            this.navigationCancellation.Dispose();
+            this.navigationCancellation = new();
+        }
+
+        private void DiscardDifferences()
+        {
+            // called under the difference cache lock when a setting differences depend on changes
+            // Differences calculated under the previous settings are discarded on completion rather than cached.
+            ++this.differenceSettingsGeneration;
+            this.differences.Clear();
+            this.sumsOfAbsoluteDifferences.Clear();
+            foreach (ImageDifference difference in new ImageDifference[] { ImageDifference.Previous, ImageDifference.Next, ImageDifference.Combined, ImageDifference.Background })
+            {
+                this.differenceCache[difference] = null;
+            }
+            this.CurrentDifferenceState = ImageDifference.Unaltered;
+        }
+
+        private ImageRow? GetDifferenceableFile(int fileRow)
+        {
+            if (this.TryGetFile(fileRow, out ImageRow? file) && (file.IsVideo == false))
+            {
+                return file;
+            }
+            return null;
+        }
+
+        private void PrecomputeDifference((long PreviousID, long ID, long NextID, int BackgroundFrames, byte Threshold) differenceKey, MemoryImage unaltered, MemoryImage? previous, MemoryImage? next, CancellationToken cancellationToken)
+        {
+            if (((previous == null) && (next == null)) || this.differences.ContainsKey(differenceKey))
+            {
+                return;
+            }
+
+            cancellationToken.ThrowIfCancellationRequested();
+            (bool CompensateCameraShake, bool NormalizeIllumination, int Generation) settings;
+            lock (this.differenceCache)
+            {
+                settings = this.GetDifferenceSettings();
+            }
+            Stopwatch stopwatch = Stopwatch.StartNew();
+            MemoryImage? difference;
+            bool success;
+            if ((previous != null) && (next != null))
+            {
+                success = this.TryGetCombinedDifference(settings, differenceKey, unaltered, previous, next, out difference);
+            }
+            else
+            {
+                long comparisonID = previous != null ? differenceKey.PreviousID : differenceKey.NextID;
+                MemoryImage comparison = previous ?? next!;
+                (int offsetX, int offsetY) = this.GetTranslation(settings, differenceKey.ID, unaltered, comparisonID, comparison);
+                success = unaltered.TryDifference(comparison, offsetX, offsetY, settings.NormalizeIllumination, differenceKey.Threshold, out difference);
+            }
+            if (success)
+            {
+                // a difference calculated while camera shake compensation or illumination normalization was changed is discarded
+                // rather than cached
+                lock (this.differenceCache)
+                {
+                    if (settings.Generation == this.differenceSettingsGeneration)
                     {
-                        // if the image cache is full make room for the incoming image
-                        if (this.mostRecentlyUsedIDs.IsFull())
-                        {
-                            if (this.mostRecentlyUsedIDs.TryGetLeastRecent(out long fileIDToRemove))
-                            {
-                                this.unalteredImagesByID.TryRemove(fileIDToRemove, out CachedImage? imageForID);
-                            }
-                        }
+                        CachedImage differenceImage = new(difference!);
+                        this.differences.AddOrUpdate(differenceKey, differenceImage, differenceImage.SizeInBytes, stopwatch.Elapsed.TotalMilliseconds);
+                    }
+                }
+            }
+        }
+
+        private void PrecomputeDifferences(ImageRow? previous, ImageRow file, ImageRow? next, byte threshold, CancellationToken cancellationToken)
+        {
+            MemoryImage? unaltered = this.TryGetPrecomputationImage(file, cancellationToken);
+            if (unaltered == null)
+            {
+                return;
+            }
+
+            MemoryImage? previousImage = null;
+            if (previous != null)
+            {
+                previousImage = this.TryGetPrecomputationImage(previous, cancellationToken);
+                this.PrecomputeDifference((previous.ID, file.ID, Constant.Database.InvalidID, 0, threshold), unaltered, previousImage, null, cancellationToken);
+            }
+
+            MemoryImage? nextImage = null;
+            if (next != null)
+            {
+                nextImage = this.TryGetPrecomputationImage(next, cancellationToken);
+                this.PrecomputeDifference((Constant.Database.InvalidID, file.ID, next.ID, 0, threshold), unaltered, null, nextImage, cancellationToken);
+            }
+
+            if ((previousImage != null) && (nextImage != null))
+            {
+                this.PrecomputeDifference((previous!.ID, file.ID, next!.ID, 0, threshold), unaltered, previousImage, nextImage, cancellationToken);
+            }
+        }
+
+        /// <summary>
+        /// Calculate the differences of the current file, and of the file navigation's heading to, from their neighbours on a low
+        /// priority thread. The calculation's cancelled if navigation moves to another file and a request which hasn't started is
+        /// superseded by the next request.
+        /// </summary>
+        /// <returns>A task which completes once the differences are calculated or the request's cancelled or superseded.</returns>
+        public Task PrecomputeDifferencesAsync(byte differenceThreshold)
+        {
+            DifferencePrecomputation precomputation;
+            lock (this.differenceCache)
+            {
+                if ((this.IsFileAvailable == false) || this.Current.IsVideo || (this.Current.IsDisplayable() == false))
+                {
+                    return Task.CompletedTask;
+                }
+
+                // differences are calculated at full resolution, so precomputing them while the display's at display resolution
+                // would decode the current file and its neighbours at full resolution on every pause in navigation even if no
+                // difference is ever asked for
+                // Once the user's asked for a difference it's likely they'll ask for more, so precomputation then goes ahead.
+                // Frames large enough to be tiled are differenced only on request.
+                if (((this.TargetResolution != ImageResolution.Full) && (this.differencesRequested == false)) || this.TryGetPyramid(this.Current.ID, out ImagePyramid? _))
+                {
+                    return Task.CompletedTask;
+                }
 
-                        // indicate to add the image
-                        return image;
-                    },
-                    (long existingID, CachedImage newImage) =>
+                // the current file's differences are calculated first as they're the ones most likely to be asked for
+                List<(ImageRow? Previous, ImageRow File, ImageRow? Next)> files = new(1 + Constant.Images.DifferencePrecomputationSteps);
+                int direction = this.navigationDirection < 0 ? -1 : 1;
+                for (int step = 0; step <= Constant.Images.DifferencePrecomputationSteps; ++step)
+                {
+                    int fileRow = this.CurrentRow + direction * step;
+                    ImageRow? file = this.GetDifferenceableFile(fileRow);
+                    if (file != null)
                     {
-                        // indicate to update the image
-                        return newImage;
-                    });
-                this.mostRecentlyUsedIDs.SetMostRecent(id);
+                        files.Add((this.GetDifferenceableFile(fileRow - 1), file, this.GetDifferenceableFile(fileRow + 1)));
+                    }
+                }
+                precomputation = new(files, differenceThreshold, this.navigationCancellation.Token);
+            }
+
+            lock (this.differencePrecomputationLock)
+            {
+                if (this.differencePrecomputationStopped)
+                {
+                    return Task.CompletedTask;
+                }
+
+                this.differencePrecomputation?.Completion.TrySetResult();
+                this.differencePrecomputation = precomputation;
+                if (this.differencePrecomputationThread == null)
+                {
+                    // a dedicated thread allows differences to be calculated at low priority, which also runs differencing kernels
+                    // serially rather than spreading them across cores (see MemoryImage.ForEachBlock())
+                    this.differencePrecomputationThread = new(this.RunDifferencePrecomputation)
+                    {
+                        IsBackground = true,
+                        Name = "difference precomputation",
+                        Priority = ThreadPriority.Lowest
+                    };
+                    this.differencePrecomputationThread.Start();
+                }
+                Monitor.Pulse(this.differencePrecomputationLock);
+            }
+            return precomputation.Completion.Task;
+        }
+
+        private async Task RefineCurrentImageAsync(bool afterNavigationPause)
+        {
+            // if navigation's rapid, wait to see if it pauses on this file before spending a decode on it
+            if (afterNavigationPause)
+            {
+                CancellationToken cancellationToken;
+                lock (this.differenceCache)
+                {
+                    cancellationToken = this.navigationCancellation.Token;
+                }
+                try
+                {
+                    await Task.Delay(Constant.ThrottleValues.PreviewRefinementDelay, cancellationToken).ConfigureAwait(true);
+                }
+                catch (OperationCanceledException)
+                {
+                    return;
+                }
+            }
+
+            if (await this.TryRefineCurrentImageAsync().ConfigureAwait(true))
+            {
+                this.CurrentImageRefined?.Invoke(this, EventArgs.Empty);
+            }
+        }
+
+        /// <summary>
+        /// Indicate whether the display needs full resolution images, such as when it's zoomed in or magnified. If full resolution's
+        /// newly required the current file's image is refined to full resolution.
+        /// </summary>
+        public void RequireFullResolution(bool required)
+        {
+            bool refine = required && (this.fullResolutionRequired == false);
+            this.fullResolutionRequired = required;
+            if (refine)
+            {
+                _ = this.RefineCurrentImageAsync(false);
             }
         }
 
@@ -165,15 +648,127 @@ namespace Carnassial.Images
         private void ResetDifferenceState()
         {
             this.CurrentDifferenceState = ImageDifference.Unaltered;
-            // unaltered image is also contained in this.unalteredImagesByID and is disposed from that collection
+            // unaltered image is also contained in this.images and is disposed from that collection
             this.differenceCache[ImageDifference.Unaltered] = null;
 
-            foreach (ImageDifference difference in new ImageDifference[] { ImageDifference.Previous, ImageDifference.Next, ImageDifference.Combined })
+            foreach (ImageDifference difference in new ImageDifference[] { ImageDifference.Previous, ImageDifference.Next, ImageDifference.Combined, ImageDifference.Background })
             {
                 this.differenceCache[difference] = null;
             }
         }
 
+        private void RunDifferencePrecomputation()
+        {
+            while (true)
+            {
+                DifferencePrecomputation? precomputation;
+                lock (this.differencePrecomputationLock)
+                {
+                    while ((this.differencePrecomputation == null) && (this.differencePrecomputationStopped == false))
+                    {
+                        Monitor.Wait(this.differencePrecomputationLock);
+                    }
+                    if (this.differencePrecomputationStopped)
+                    {
+                        return;
+                    }
+
+                    precomputation = this.differencePrecomputation!;
+                    this.differencePrecomputation = null;
+                }
+
+                try
+                {
+                    foreach ((ImageRow? previous, ImageRow file, ImageRow? next) in precomputation.Files)
+                    {
+                        this.PrecomputeDifferences(previous, file, next, precomputation.Threshold, precomputation.CancellationToken);
+                    }
+                }
+                catch (OperationCanceledException)
+                {
+                    // navigation's moved to another file, so the differences may no longer be needed
+                }
+                finally
+                {
+                    precomputation.Completion.TrySetResult();
+                }
+            }
+        }
+
+        private bool TryGetCombinedDifference((bool CompensateCameraShake, bool NormalizeIllumination, int Generation) settings, (long PreviousID, long ID, long NextID, int BackgroundFrames, byte Threshold) differenceKey, MemoryImage unaltered, MemoryImage previous, MemoryImage next, [NotNullWhen(true)] out MemoryImage? difference)
+        {
+            if ((this.TryGetSumsOfAbsoluteDifferences(settings, differenceKey.PreviousID, previous, differenceKey.ID, unaltered, out UInt16[]? previousSums) == false) ||
+                (this.TryGetSumsOfAbsoluteDifferences(settings, differenceKey.ID, unaltered, differenceKey.NextID, next, out UInt16[]? nextSums) == false))
+            {
+                difference = null;
+                return false;
+            }
+
+            // previous sums are in the previous image's pixel coordinates and next sums are in the current image's
+            (int previousOffsetX, int previousOffsetY) = this.GetTranslation(settings, differenceKey.ID, unaltered, differenceKey.PreviousID, previous);
+            return unaltered.TryDifference(previousSums, previousOffsetX, previousOffsetY, nextSums, 0, 0, differenceKey.Threshold, out difference);
+        }
+
+        private bool TryGetCachedImage(long id, ImageResolution minimumResolution, [NotNullWhen(true)] out CachedImage? image)
+        {
+            // prefer the highest resolution available
+            for (ImageResolution resolution = ImageResolution.Full; resolution >= minimumResolution; --resolution)
+            {
+                if (this.images.TryGetValue((id, resolution), out image))
+                {
+                    return true;
+                }
+            }
+            image = null;
+            return false;
+        }
+
+        /// <summary>
+        /// Get how much each block of the current image changed from the previous file's image, if both files are images of the
+        /// same size.
+        /// </summary>
+        /// <remarks>
+        /// Maps are calculated from previews, which are 1/8 scale decodes, so each block covers 64 x 64 pixels of the full
+        /// resolution image. Previews are cached like other images, so moving forward through files decodes only the new file's
+        /// preview and its jpeg's usually still in memory from being displayed.
+        /// </remarks>
+        public async Task<BlockChangeMap?> TryGetChangeMapAsync()
+        {
+            if (this.IsFileAvailable == false)
+            {
+                return null;
+            }
+            ImageRow? file = this.GetDifferenceableFile(this.CurrentRow);
+            ImageRow? previousFile = this.GetDifferenceableFile(this.CurrentRow - 1);
+            if ((file == null) || (previousFile == null))
+            {
+                return null;
+            }
+
+            CachedImage preview = await this.TryGetPreviewAsync(file).ConfigureAwait(true);
+            CachedImage previousPreview = await this.TryGetPreviewAsync(previousFile).ConfigureAwait(true);
+            if ((preview.Image == null) || (previousPreview.Image == null) ||
+                (preview.Image.TryGetBlockChangeMap(previousPreview.Image, Constant.Images.BlockChangeSizeInPixels, out BlockChangeMap? changeMap) == false))
+            {
+                return null;
+            }
+            return changeMap;
+        }
+
+        /// <summary>
+        /// Get the current file's pyramid if it's large enough to be tiled.
+        /// </summary>
+        public bool TryGetCurrentPyramid([NotNullWhen(true)] out ImagePyramid? pyramid)
+        {
+            ImageRow? file = this.Current;
+            if ((file == null) || file.IsVideo)
+            {
+                pyramid = null;
+                return false;
+            }
+            return this.TryGetPyramid(file.ID, out pyramid);
+        }
+
         private async Task<CachedImage?> TryGetImageAsync(int fileRow)
         {
             if ((this.TryGetFile(fileRow, out ImageRow? file) == false) || file.IsVideo)
@@ -181,35 +776,31 @@ namespace Carnassial.Images
                 return null;
             }
 
-            return await this.TryGetImageAsync(file, 0).ConfigureAwait(true);
+            return await this.TryGetImageAsync(file, ImageResolution.Full).ConfigureAwait(true);
         }
 
-        private async Task<CachedImage> TryGetImageAsync(ImageRow file, int prefetchStride)
+        private async Task<CachedImage> TryGetImageAsync(ImageRow file, ImageResolution minimumResolution)
         {
             // locate the requested image
-            if (this.unalteredImagesByID.TryGetValue(file.ID, out CachedImage? image) == false)
+            if (this.TryGetCachedImage(file.ID, minimumResolution, out CachedImage? image))
             {
-                if (this.prefetchesByID.TryGetValue(file.ID, out Task? prefetch))
-                {
-                    // image retrieval's already in progress, so wait for it to complete
-                    await prefetch.ConfigureAwait(true);
-                    image = this.unalteredImagesByID[file.ID];
-                }
-                else
-                {
-                    // load the requested image from disk as it isn't cached, doesn't have a prefetch running, and is needed right now 
-                    // by the caller
-                    image = await file.TryLoadImageAsync(this.FileDatabase.FolderPath).ConfigureAwait(true);
-                    this.CacheImage(file.ID, image);
-                }
+                return image;
             }
 
-            // start prefetches of nearby images if requested
-            if (prefetchStride != 0)
+            // if image retrieval's already in progress wait for it to complete
+            // The prefetch may have been cancelled by navigation on another thread, in which case the image is loaded below.
+            if (this.prefetchesByID.TryGetValue(file.ID, out ImagePrefetch? prefetch) && (prefetch.Resolution >= minimumResolution))
             {
-                this.TryInitiatePrefetch(this.CurrentRow + prefetchStride);
+                await prefetch.Completion.ConfigureAwait(true);
+                if (this.TryGetCachedImage(file.ID, minimumResolution, out image))
+                {
+                    return image;
+                }
             }
-            return image;
+
+            // load the requested image from disk as it isn't cached, doesn't have a prefetch running, and is needed right now by
+            // the caller
+            return await this.TryLoadImageAsync(file, minimumResolution, CancellationToken.None).ConfigureAwait(true);
         }
 
         private bool TryGetFile(int fileRow, [MaybeNullWhen(false), NotNullWhen(true)] out ImageRow? file)
@@ -231,7 +822,102 @@ namespace Carnassial.Images
             return file.IsDisplayable();
         }
 
-        private bool TryInitiatePrefetch(int fileIndex)
+        private async Task<byte[]?> TryGetJpegAsync(ImageRow file, CancellationToken cancellationToken)
+        {
+            // read the file's jpeg if it's not already in memory
+            // Jpegs are charged their read time so that jpegs from slow media are the ones kept in the jpeg tier.
+            if (this.jpegs.TryGetValue(file.ID, out byte[]? jpeg) == false)
+            {
+                Stopwatch stopwatch = Stopwatch.StartNew();
+                jpeg = await file.TryReadJpegAsync(this.FileDatabase.FolderPath, cancellationToken).ConfigureAwait(false);
+                if (jpeg != null)
+                {
+                    this.jpegs.AddOrUpdate(file.ID, jpeg, Math.Max(jpeg.Length, Constant.Images.CachedImageMinimumSizeInBytes), stopwatch.Elapsed.TotalMilliseconds);
+                }
+            }
+            return jpeg;
+        }
+
+        private MemoryImage? TryGetPrecomputationImage(ImageRow file, CancellationToken cancellationToken)
+        {
+            // images are loaded at full resolution as differences are always calculated at full resolution
+            // Usually the images are already cached by prefetching. Frames large enough to be tiled are skipped unless they're
+            // already cached at full resolution since avoiding whole frame decodes of them is what their pyramids are for. Their
+            // sizes are read from their jpegs' headers, so checking them costs a read the decode would have needed anyway.
+            cancellationToken.ThrowIfCancellationRequested();
+            if (this.TryGetCachedImage(file.ID, ImageResolution.Full, out CachedImage? image) == false)
+            {
+                byte[]? jpeg = this.TryGetJpegAsync(file, cancellationToken).GetAwaiter().GetResult();
+                if ((jpeg == null) || ImagePyramid.IsLargeEnoughToTile(jpeg))
+                {
+                    return null;
+                }
+                cancellationToken.ThrowIfCancellationRequested();
+                image = this.TryGetImageAsync(file, ImageResolution.Full).GetAwaiter().GetResult();
+            }
+            return image.Image;
+        }
+
+        private async Task<CachedImage> TryGetPreviewAsync(ImageRow file)
+        {
+            if (this.images.TryGetValue((file.ID, ImageResolution.Preview), out CachedImage? preview))
+            {
+                return preview;
+            }
+
+            // decode off the UI thread as, if the jpeg's cached, loading completes synchronously
+            return await Task.Run(() => this.TryLoadImageAsync(file, ImageResolution.Preview, CancellationToken.None)).ConfigureAwait(true);
+        }
+
+        private bool TryGetPyramid(long id, [NotNullWhen(true)] out ImagePyramid? pyramid)
+        {
+            // pyramids are created from the jpeg tier and only the most recent file's is kept as it's the one being displayed
+            // If the file's jpeg isn't cached yet it's checked again on the next call.
+            lock (this.pyramidLock)
+            {
+                if (this.pyramidID != id)
+                {
+                    this.pyramid = null;
+                    if (this.jpegs.TryGetValue(id, out byte[]? jpeg))
+                    {
+                        this.pyramidID = id;
+                        if (ImagePyramid.TryCreate(jpeg, out ImagePyramid? created) && (created.TotalPixels >= Constant.Images.PyramidMinimumPixels))
+                        {
+                            this.pyramid = created;
+                        }
+                    }
+                }
+
+                pyramid = this.pyramid;
+                return pyramid != null;
+            }
+        }
+
+        private bool TryGetSumsOfAbsoluteDifferences((bool CompensateCameraShake, bool NormalizeIllumination, int Generation) settings, long id, MemoryImage image, long otherID, MemoryImage otherImage, [NotNullWhen(true)] out UInt16[]? sums)
+        {
+            if (this.sumsOfAbsoluteDifferences.TryGet(id, otherID, out sums))
+            {
+                return true;
+            }
+            (int offsetX, int offsetY) = this.GetTranslation(settings, id, image, otherID, otherImage);
+            if (image.TryGetSumsOfAbsoluteDifferences(otherImage, offsetX, offsetY, settings.NormalizeIllumination, out sums) == false)
+            {
+                return false;
+            }
+
+            // sums depend on the settings, so sums calculated under settings which have since changed are used for this difference,
+            // which is then discarded, but aren't kept for later differences
+            lock (this.differenceCache)
+            {
+                if (settings.Generation == this.differenceSettingsGeneration)
+                {
+                    this.sumsOfAbsoluteDifferences.Add(id, otherID, sums);
+                }
+            }
+            return true;
+        }
+
+        private bool TryInitiatePrefetch(int fileIndex, ImageResolution resolution)
         {
             if (this.FileDatabase.IsFileRowInRange(fileIndex) == false)
             {
@@ -239,24 +925,64 @@ namespace Carnassial.Images
             }
 
             ImageRow nextFile = this.FileDatabase.Files[fileIndex];
-            if (nextFile.IsVideo || this.unalteredImagesByID.ContainsKey(nextFile.ID) || this.prefetchesByID.ContainsKey(nextFile.ID))
+            if (nextFile.IsVideo || this.TryGetCachedImage(nextFile.ID, resolution, out _) || this.prefetchesByID.ContainsKey(nextFile.ID))
             {
                 return false;
             }
 
-            Task prefetch = Task.Run((Func<Task>)(async () =>
+            // the prefetch is registered before it starts so it can't complete and remove itself before it's been added
+            ImagePrefetch prefetch = new(fileIndex, resolution, async (ImagePrefetch thisPrefetch, CancellationToken cancellationToken) =>
             {
-                CachedImage nextImage = await nextFile.TryLoadImageAsync((string)this.FileDatabase.FolderPath).ConfigureAwait(true);
-                this.CacheImage(nextFile.ID, nextImage);
-                this.prefetchesByID.TryRemove(nextFile.ID, out Task? _);
-            }));
-            this.prefetchesByID.AddOrUpdate(nextFile.ID, prefetch, (long id, Task newPrefetch) => { return newPrefetch; });
+                try
+                {
+                    // frames large enough to be tiled are prefetched at display resolution as that's all they're refined to
+                    // Their sizes are read from their jpegs' headers, so checking them costs a read the decode needs anyway.
+                    ImageResolution prefetchResolution = resolution;
+                    if ((resolution == ImageResolution.Full) && (this.DisplayWidthInPixels > 0))
+                    {
+                        byte[]? jpeg = await this.TryGetJpegAsync(nextFile, cancellationToken).ConfigureAwait(false);
+                        if ((jpeg != null) && ImagePyramid.IsLargeEnoughToTile(jpeg))
+                        {
+                            prefetchResolution = ImageResolution.Display;
+                        }
+                    }
+                    if ((prefetchResolution == resolution) || (this.TryGetCachedImage(nextFile.ID, prefetchResolution, out _) == false))
+                    {
+                        await this.TryLoadImageAsync(nextFile, prefetchResolution, cancellationToken).ConfigureAwait(false);
+                    }
+                }
+                catch (OperationCanceledException)
+                {
+                    // navigation's moved away from the file, so there's nothing to cache
+                }
+                finally
+                {
+                    this.prefetchesByID.TryRemove(new KeyValuePair<long, ImagePrefetch>(nextFile.ID, thisPrefetch));
+                    thisPrefetch.Dispose();
+                }
+            });
+            if (this.prefetchesByID.TryAdd(nextFile.ID, prefetch) == false)
+            {
+                prefetch.Dispose();
+                return false;
+            }
+            prefetch.Start();
             return true;
         }
 
         public bool TryInvalidate(long id)
         {
-            if (this.unalteredImagesByID.ContainsKey(id) == false)
+            this.jpegs.TryRemove(id);
+            lock (this.pyramidLock)
+            {
+                if (this.pyramidID == id)
+                {
+                    this.pyramid = null;
+                    this.pyramidID = Constant.Database.InvalidID;
+                }
+            }
+            this.images.TryRemove((id, ImageResolution.Preview));
+            if ((this.images.ContainsKey((id, ImageResolution.Display)) == false) && (this.images.ContainsKey((id, ImageResolution.Full)) == false))
             {
                 return false;
             }
@@ -266,10 +992,44 @@ namespace Carnassial.Images
                 this.Reset();
             }
 
-            lock (this.mostRecentlyUsedIDs)
+            bool displayRemoved = this.images.TryRemove((id, ImageResolution.Display));
+            return this.images.TryRemove((id, ImageResolution.Full)) || displayRemoved;
+        }
+
+        private async Task<CachedImage> TryLoadImageAsync(ImageRow file, ImageResolution resolution, CancellationToken cancellationToken)
+        {
+            // the jpeg and the image decoded from it are each charged their own load time so that jpegs from slow media are the
+            // ones kept in the jpeg tier
+            Stopwatch stopwatch = Stopwatch.StartNew();
+            CachedImage image;
+            byte[]? jpeg = await this.TryGetJpegAsync(file, cancellationToken).ConfigureAwait(false);
+
+            if (jpeg == null)
+            {
+                image = new CachedImage()
+                {
+                    FileNoLongerAvailable = true
+                };
+            }
+            else
             {
-                return this.mostRecentlyUsedIDs.TryRemove(id);
+                cancellationToken.ThrowIfCancellationRequested();
+                stopwatch.Restart();
+                int? requestedWidth = resolution switch
+                {
+                    ImageResolution.Preview => Constant.Images.PreviewRequestedWidthInPixels,
+                    ImageResolution.Display => this.DisplayWidthInPixels,
+                    _ => null
+                };
+                if (resolution == ImageResolution.Full)
+                {
+                    Interlocked.Increment(ref this.fullResolutionDecodes);
+                }
+                image = ImageRow.DecodeJpeg(jpeg, requestedWidth);
             }
+            image.Resolution = resolution;
+            this.CacheImage(file.ID, image, stopwatch.Elapsed);
+            return image;
         }
 
         public override bool TryMoveToFile(int fileIndex)
@@ -306,22 +1066,131 @@ namespace Carnassial.Images
                     // all moves are to display of unaltered images and invalidate any cached differences
                     // it is assumed images on disk are not altered while Carnassial is running and hence unaltered images can safely be cached by their IDs
                     this.ResetDifferenceState();
+                    this.CancelNavigation();
+                    this.UpdateNavigationRate(prefetchStride);
                 }
             }
 
             // if this file is an image ensure it's loaded from disk and cached
+            // If navigation's rapid or display is progressive, a preview is shown if the file isn't already cached at the resolution
+            // it's displayed at and the cache refines the image once it's shown.
             if (afterMoveFile.IsVideo == false)
             {
-                this.differenceCache[ImageDifference.Unaltered] = await this.TryGetImageAsync(afterMoveFile, prefetchStride).ConfigureAwait(true);
+                bool navigatingRapidly = this.IsNavigatingRapidly;
+                bool showPreview = movedToNewFile && (navigatingRapidly || (this.DisplayWidthInPixels > 0));
+                ImageResolution targetResolution = this.GetTargetResolution(afterMoveFile.ID);
+                if ((showPreview == false) || (this.TryGetCachedImage(afterMoveFile.ID, targetResolution, out CachedImage? unaltered) == false))
+                {
+                    unaltered = await this.TryGetImageAsync(afterMoveFile, showPreview ? ImageResolution.Preview : targetResolution).ConfigureAwait(true);
+                }
+                this.differenceCache[ImageDifference.Unaltered] = unaltered;
+
+                if (showPreview && (unaltered.Resolution < targetResolution) && (unaltered.FileNoLongerAvailable == false) && (unaltered.ImageNotDecodable == false))
+                {
+                    _ = this.RefineCurrentImageAsync(navigatingRapidly);
+                }
             }
 
+            // start prefetches of nearby images if requested and cancel prefetches navigation's moved away from
+            if (movedToNewFile || (prefetchStride != 0))
+            {
+                this.UpdatePrefetchWindow(prefetchStride);
+            }
             return new MoveToFileResult(movedToNewFile);
         }
 
+        /// <summary>
+        /// Toggle between the current image and its difference from its folder's background.
+        /// </summary>
+        public async Task<ImageDifferenceResult> TryMoveToNextBackgroundDifferenceImageAsync(byte differenceThreshold)
+        {
+            BackgroundModel? background;
+            (long PreviousID, long ID, long NextID, int BackgroundFrames, byte Threshold) differenceKey;
+            ImageDifference initialDifferenceState;
+            int initialRow;
+            CachedImage? unaltered;
+            lock (this.differenceCache)
+            {
+                if ((this.IsFileAvailable == false) || this.Current.IsVideo || (this.Current.IsDisplayable() == false))
+                {
+                    this.CurrentDifferenceState = ImageDifference.Unaltered;
+                    return ImageDifferenceResult.CurrentImageNotAvailable;
+                }
+                unaltered = this.differenceCache[ImageDifference.Unaltered];
+                if ((unaltered == null) || (unaltered.Image == null))
+                {
+                    return ImageDifferenceResult.CurrentImageNotAvailable;
+                }
+
+                if (this.CurrentDifferenceState != ImageDifference.Unaltered)
+                {
+                    this.CurrentDifferenceState = ImageDifference.Unaltered;
+                    return ImageDifferenceResult.Success;
+                }
+
+                if (this.FileDatabase.Backgrounds.TryGetValue(this.Current.RelativePath, out background) == false)
+                {
+                    return ImageDifferenceResult.BackgroundNotAvailable;
+                }
+
+                // unlike neighbour differences, the current file's background difference is always looked up as its background
+                // may have been updated since it was last displayed
+                differenceKey = this.GetDifferenceKey(ImageDifference.Background, differenceThreshold);
+                if (this.differences.TryGetValue(differenceKey, out CachedImage? cachedDifference))
+                {
+                    this.CurrentDifferenceState = ImageDifference.Background;
+                    this.differenceCache[ImageDifference.Background] = cachedDifference;
+                    return ImageDifferenceResult.Success;
+                }
+
+                initialDifferenceState = this.CurrentDifferenceState;
+                initialRow = this.CurrentRow;
+            }
+
+            // differences are calculated at full resolution
+            if (unaltered.Resolution != ImageResolution.Full)
+            {
+                unaltered = await this.TryGetImageAsync(initialRow).ConfigureAwait(true);
+                if ((unaltered == null) || (unaltered.Image == null))
+                {
+                    return ImageDifferenceResult.CurrentImageNotAvailable;
+                }
+            }
+
+            return await Task.Run(() =>
+            {
+                Stopwatch stopwatch = new();
+                stopwatch.Start();
+                bool success = unaltered.Image.TryDifference(background, differenceThreshold, out MemoryImage? difference);
+                stopwatch.Stop();
+                if (success)
+                {
+                    lock (this.differenceCache)
+                    {
+                        ++this.backgroundDifferencesCalculated;
+                        this.backgroundDifferenceTime += stopwatch.Elapsed;
+                        CachedImage differenceImage = new(difference!); // suppress spurious CS8604, VS 17.8.3
+                        this.differences.AddOrUpdate(differenceKey, differenceImage, differenceImage.SizeInBytes, stopwatch.Elapsed.TotalMilliseconds);
+
+                        if ((this.CurrentRow == initialRow) && (this.CurrentDifferenceState == initialDifferenceState))
+                        {
+                            this.CurrentDifferenceState = ImageDifference.Background;
+                            this.differenceCache[ImageDifference.Background] = differenceImage;
+                            return ImageDifferenceResult.Success;
+                        }
+                        return ImageDifferenceResult.NoLongerValid;
+                    }
+                }
+                return ImageDifferenceResult.NotCalculable;
+            }).ConfigureAwait(true);
+        }
+
         public async Task<ImageDifferenceResult> TryMoveToNextCombinedDifferenceImageAsync(byte differenceThreshold)
         {
+            (long PreviousID, long ID, long NextID, int BackgroundFrames, byte Threshold) differenceKey;
             ImageDifference initialDifferenceState;
             int initialRow;
+            (bool CompensateCameraShake, bool NormalizeIllumination, int Generation) settings;
             CachedImage? unaltered;
             lock (this.differenceCache)
             {
@@ -344,6 +1213,7 @@ namespace Carnassial.Images
                     this.CurrentDifferenceState = nextDifferenceState;
                     return ImageDifferenceResult.Success;
                 }
+                this.differencesRequested = true;
 
                 CachedImage? cachedDifference = this.differenceCache[nextDifferenceState];
                 if ((cachedDifference != null) && (cachedDifference.Image != null))
@@ -352,8 +1222,27 @@ namespace Carnassial.Images
                     return ImageDifferenceResult.Success;
                 }
 
+                differenceKey = this.GetDifferenceKey(nextDifferenceState, differenceThreshold);
+                if (this.differences.TryGetValue(differenceKey, out cachedDifference))
+                {
+                    this.CurrentDifferenceState = nextDifferenceState;
+                    this.differenceCache[nextDifferenceState] = cachedDifference;
+                    return ImageDifferenceResult.Success;
+                }
+
                 initialDifferenceState = this.CurrentDifferenceState;
                 initialRow = this.CurrentRow;
+                settings = this.GetDifferenceSettings();
+            }
+
+            // differences are calculated at full resolution
+            if (unaltered.Resolution != ImageResolution.Full)
+            {
+                unaltered = await this.TryGetImageAsync(initialRow).ConfigureAwait(true);
+                if ((unaltered == null) || (unaltered.Image == null))
+                {
+                    return ImageDifferenceResult.CurrentImageNotAvailable;
+                }
             }
 
             CachedImage? previous = await this.TryGetImageAsync(initialRow - 1).ConfigureAwait(true);
@@ -373,19 +1262,26 @@ namespace Carnassial.Images
             {
                 Stopwatch stopwatch = new();
                 stopwatch.Start();
-                bool success = unaltered.Image.TryDifference(previous.Image, next.Image, differenceThreshold, out MemoryImage? difference);
+                bool success = this.TryGetCombinedDifference(settings, differenceKey, unaltered.Image, previous.Image, next.Image, out MemoryImage? difference);
                 stopwatch.Stop();
                 if (success)
                 {
                     lock (this.differenceCache)
                     {
+                        if (settings.Generation != this.differenceSettingsGeneration)
+                        {
+                            return ImageDifferenceResult.NoLongerValid;
+                        }
+
                         ++this.combinedDifferencesCalculated;
                         this.combinedDifferenceTime += stopwatch.Elapsed;
+                        CachedImage differenceImage = new(difference!); // suppress spurious CS8604, VS 17.8.3
+                        this.differences.AddOrUpdate(differenceKey, differenceImage, differenceImage.SizeInBytes, stopwatch.Elapsed.TotalMilliseconds);
 
                         if ((this.CurrentRow == initialRow) && (this.CurrentDifferenceState == initialDifferenceState))
                         {
                             this.CurrentDifferenceState = ImageDifference.Combined;
-                            this.differenceCache[ImageDifference.Combined] = new CachedImage(difference!); // suppress spurious CS8604, VS 17.8.3
+                            this.differenceCache[ImageDifference.Combined] = differenceImage;
                             return ImageDifferenceResult.Success;
                         }
                         return ImageDifferenceResult.NoLongerValid;
@@ -399,9 +1295,11 @@ namespace Carnassial.Images
         {
             ImageDifferenceResult comparisonImageNotAvailable;
             int comparisonRow;
+            (long PreviousID, long ID, long NextID, int BackgroundFrames, byte Threshold) differenceKey;
             ImageDifference initialDifferenceState;
             int initialRow;
             ImageDifference nextDifferenceState;
+            (bool CompensateCameraShake, bool NormalizeIllumination, int Generation) settings;
             CachedImage? unaltered;
             lock (this.differenceCache)
             {
@@ -439,6 +1337,7 @@ namespace Carnassial.Images
                     default:
                         throw new NotSupportedException($"Unhandled difference state {nextDifferenceState}.");
                 }
+                this.differencesRequested = true;
 
                 CachedImage? cachedDifference = this.differenceCache[nextDifferenceState];
                 if ((cachedDifference != null) && (cachedDifference.Image != null))
@@ -446,6 +1345,25 @@ namespace Carnassial.Images
                     this.CurrentDifferenceState = nextDifferenceState;
                     return ImageDifferenceResult.Success;
                 }
+
+                differenceKey = this.GetDifferenceKey(nextDifferenceState, differenceThreshold);
+                if (this.differences.TryGetValue(differenceKey, out cachedDifference))
+                {
+                    this.CurrentDifferenceState = nextDifferenceState;
+                    this.differenceCache[nextDifferenceState] = cachedDifference;
+                    return ImageDifferenceResult.Success;
+                }
+                settings = this.GetDifferenceSettings();
+            }
+
+            // differences are calculated at full resolution
+            if (unaltered.Resolution != ImageResolution.Full)
+            {
+                unaltered = await this.TryGetImageAsync(initialRow).ConfigureAwait(true);
+                if ((unaltered == null) || (unaltered.Image == null))
+                {
+                    return ImageDifferenceResult.CurrentImageNotAvailable;
+                }
             }
 
             // determine which image to use for differencing
@@ -459,18 +1377,27 @@ namespace Carnassial.Images
             {
                 Stopwatch stopwatch = new();
                 stopwatch.Start();
-                bool success = unaltered.Image.TryDifference(comparisonImage.Image, differenceThreshold, out MemoryImage? difference);
+                long comparisonID = nextDifferenceState == ImageDifference.Previous ? differenceKey.PreviousID : differenceKey.NextID;
+                (int offsetX, int offsetY) = this.GetTranslation(settings, differenceKey.ID, unaltered.Image, comparisonID, comparisonImage.Image);
+                bool success = unaltered.Image.TryDifference(comparisonImage.Image, offsetX, offsetY, settings.NormalizeIllumination, differenceThreshold, out MemoryImage? difference);
                 if (success)
                 {
                     lock (this.differenceCache)
                     {
+                        if (settings.Generation != this.differenceSettingsGeneration)
+                        {
+                            return ImageDifferenceResult.NoLongerValid;
+                        }
+
                         ++this.differencesCalculated;
                         this.differenceTime += stopwatch.Elapsed;
+                        CachedImage differenceImage = new(difference!); // suppress spurious CS8604, VS 17.8.3
+                        this.differences.AddOrUpdate(differenceKey, differenceImage, differenceImage.SizeInBytes, stopwatch.Elapsed.TotalMilliseconds);
 
                         if ((this.CurrentRow == initialRow) && (this.CurrentDifferenceState == initialDifferenceState))
                         {
                             this.CurrentDifferenceState = nextDifferenceState;
-                            this.differenceCache[nextDifferenceState] = new CachedImage(difference!); // suppress spurious CS8604, VS 17.8.3
+                            this.differenceCache[nextDifferenceState] = differenceImage;
                             return ImageDifferenceResult.Success;
                         }
                         return ImageDifferenceResult.NoLongerValid;
@@ -479,5 +1406,114 @@ namespace Carnassial.Images
                 return ImageDifferenceResult.NotCalculable;
             }).ConfigureAwait(true);
         }
+
+        /// <summary>
+        /// If the current file's image is a preview or is below the resolution needed for display, replace it with the file's image
+        /// at the resolution needed.
+        /// </summary>
+        /// <returns>true if the current image was replaced and needs to be redisplayed.</returns>
+        /// <remarks>
+        /// Called by the cache when a file's shown at less than the resolution needed and so usually needn't be called directly.
+        /// If navigation moves to another file before the image is loaded the load is cancelled.
+        /// </remarks>
+        public async Task<bool> TryRefineCurrentImageAsync()
+        {
+            CancellationToken cancellationToken;
+            ImageRow file;
+            int row;
+            ImageResolution targetResolution;
+            lock (this.differenceCache)
+            {
+                CachedImage? unaltered = this.differenceCache[ImageDifference.Unaltered];
+                if ((this.IsFileAvailable == false) || (unaltered == null))
+                {
+                    return false;
+                }
+                targetResolution = this.GetTargetResolution(this.Current.ID);
+                if (unaltered.Resolution >= targetResolution)
+                {
+                    return false;
+                }
+
+                cancellationToken = this.navigationCancellation.Token;
+                file = this.Current;
+                row = this.CurrentRow;
+            }
+
+            if (this.TryGetCachedImage(file.ID, targetResolution, out CachedImage? image) == false)
+            {
+                try
+                {
+                    image = await this.TryLoadImageAsync(file, targetResolution, cancellationToken).ConfigureAwait(true);
+                }
+                catch (OperationCanceledException)
+                {
+                    return false;
+                }
+            }
+
+            lock (this.differenceCache)
+            {
+                CachedImage? unaltered = this.differenceCache[ImageDifference.Unaltered];
+                if ((this.CurrentRow != row) || (unaltered == null) || (unaltered.Resolution >= image.Resolution))
+                {
+                    return false;
+                }
+                this.differenceCache[ImageDifference.Unaltered] = image;
+                return this.CurrentDifferenceState == ImageDifference.Unaltered;
+            }
+        }
+
+        private void UpdateNavigationRate(int prefetchStride)
+        {
+            // estimate how quickly the user's stepping through files
+            // Jumps, reversals, and the first step after a pause start a new estimate. Otherwise the estimate's smoothed so a
+            // single slow or fast step doesn't swing the prefetch window.
+            TimeSpan now = this.navigationStopwatch.Elapsed;
+            double secondsSinceMostRecentNavigation = (now - this.mostRecentNavigation).TotalSeconds;
+            this.mostRecentNavigation = now;
+
+            int direction = Math.Sign(prefetchStride);
+            if ((direction == 0) || (direction != this.navigationDirection) || (secondsSinceMostRecentNavigation > Constant.Images.NavigationPauseInSeconds))
+            {
+                this.navigationDirection = direction;
+                this.navigationRate = 0.0;
+                return;
+            }
+
+            double stepsPerSecond = 1.0 / Math.Max(secondsSinceMostRecentNavigation, Constant.Images.NavigationMinimumStepInSeconds);
+            this.navigationRate = this.navigationRate == 0.0 ? stepsPerSecond : 0.5 * (this.navigationRate + stepsPerSecond);
+        }
+
+        private void UpdatePrefetchWindow(int prefetchStride)
+        {
+            // size the window to the files navigation will reach within the lookahead time at its current rate
+            // Navigation always looks at least one step ahead so stepping at a leisurely pace still finds the next image cached.
+            int steps = 0;
+            if (prefetchStride != 0)
+            {
+                steps = Math.Clamp((int)Math.Ceiling(this.navigationRate * Constant.Images.PrefetchLookaheadInSeconds), 1, Constant.Images.PrefetchMaximumSteps);
+            }
+
+            // cancel prefetches outside of the window
+            int currentRow = this.CurrentRow;
+            foreach (ImagePrefetch prefetch in this.prefetchesByID.Values)
+            {
+                int offset = prefetch.Row - currentRow;
+                bool inWindow = (prefetchStride != 0) && (offset % prefetchStride == 0) && (offset / prefetchStride >= 1) && (offset / prefetchStride <= steps);
+                if (inWindow == false)
+                {
+                    prefetch.Cancel();
+                }
+            }
+
+            // prefetch previews if navigation is too rapid for full resolution decoding to keep up
+            // Files navigation pauses on are refined to the resolution they're displayed at by RefineCurrentImageAsync().
+            ImageResolution resolution = this.IsNavigatingRapidly ? ImageResolution.Preview : this.TargetResolution;
+            for (int step = 1; step <= steps; ++step)
+            {
+                this.TryInitiatePrefetch(currentRow + step * prefetchStride, resolution);
+            }
+        }
     }
 }
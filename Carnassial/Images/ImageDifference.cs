@@ -5,6 +5,7 @@
         Previous = 0,
         Unaltered = 1,
         Next = 2,
-        Combined = 3
+        Combined = 3,
+        Background = 4
     }
 }
@@ -2,6 +2,7 @@
 {
     public enum ImageDifferenceResult
     {
+        BackgroundNotAvailable,
         CurrentImageNotAvailable,
         NextImageNotAvailable,
         NoLongerValid,
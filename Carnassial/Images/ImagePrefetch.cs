@@ -0,0 +1,74 @@
+﻿using System;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace Carnassial.Images
+{
+    /// <summary>
+    /// A load of an image ahead of navigation reaching it. Prefetches are cancelled if navigation turns away from their image.
+    /// </summary>
+    internal class ImagePrefetch : IDisposable
+    {
+        private readonly CancellationTokenSource cancellation;
+        private bool disposed;
+        private readonly Task<Task> load;
+
+        public Task Completion { get; private init; }
+        public ImageResolution Resolution { get; private init; }
+        public int Row { get; private init; }
+
+        /// <summary>
+        /// Create a prefetch. The load doesn't run until <see cref="Start"/> is called so that the prefetch can be made visible to
+        /// other threads before it can complete.
+        /// </summary>
+        public ImagePrefetch(int row, ImageResolution resolution, Func<ImagePrefetch, CancellationToken, Task> load)
+        {
+            this.cancellation = new();
+            this.disposed = false;
+            this.load = new(() => load.Invoke(this, this.cancellation.Token));
+            this.Completion = this.load.Unwrap();
+            this.Resolution = resolution;
+            this.Row = row;
+        }
+
+        /// <summary>
+        /// Request the load stop. Safe to call at any time, including after the load's completed and the prefetch is disposed.
+        /// </summary>
+        public void Cancel()
+        {
+            lock (this.cancellation)
+            {
+                if (this.disposed == false)
+                {
+                    this.cancellation.Cancel();
+                }
+            }
+        }
+
+        public void Dispose()
+        {
+            this.Dispose(true);
+            GC.SuppressFinalize(this);
+        }
+
+        protected virtual void Dispose(bool disposing)
+        {
+            if (disposing)
+            {
+                lock (this.cancellation)
+                {
+                    if (this.disposed == false)
+                    {
+                        this.cancellation.Dispose();
+                    }
+                    this.disposed = true;
+                }
+            }
+        }
+
+        public void Start()
+        {
+            this.load.Start(TaskScheduler.Default);
+        }
+    }
+}
@@ -7,8 +7,11 @@ namespace Carnassial.Images
     public class ImageProperties
     {
         public double Coloration { get; private set; }
+        // rows at the bottom of the image occupied by the camera's info bar, if any
+        public int InfoBarHeight { get; set; }
         public double Luminosity { get; private set; }
         public MetadataReadResults MetadataResult { get; set; }
+        public ImageStatistics? Statistics { get; set; }
 
         public ImageProperties(MetadataReadResults metadataResult)
         {
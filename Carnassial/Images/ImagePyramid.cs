@@ -0,0 +1,249 @@
+﻿using Carnassial.Native;
+using Carnassial.Util;
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Diagnostics.CodeAnalysis;
+using System.Windows;
+using System.Windows.Media;
+
+namespace Carnassial.Images
+{
+    /// <summary>
+    /// A jpeg's image at full, 1/2, 1/4, and 1/8 scale, divided into fixed size tiles which are decoded from the jpeg as they're
+    /// needed.
+    /// </summary>
+    /// <remarks>
+    /// Intended for frames too large to be worth decoding whole, such as those from 30+ MP cameras and stitched panoramas. When
+    /// zoomed in only the tiles in view are decoded, at the coarsest level which still has at least one pixel per display pixel,
+    /// so memory scales with the display rather than the sensor. Each tile is a scaled decode of a region of the jpeg. Rows above
+    /// the region are entropy decoded but not transformed, so a tile costs a fraction of a whole image decode.
+    ///
+    /// Level 0 is full resolution and each following level is half the size of the one before it. Tiles are
+    /// <see cref="Constant.Images.PyramidTileSizeInPixels"/> square, apart from those along the right and bottom edges of
+    /// each level. Decoded tiles are kept within <see cref="Constant.Images.PyramidTileCacheSizeInBytes"/>. All members are
+    /// thread safe.
+    ///
+    /// Consumers which sample across tile boundaries, such as the magnifying glass, can get the tiles covering a region copied
+    /// into a single block. The most recent block is kept so regions falling within the same tiles, as they do while the pointer
+    /// moves across a tile, don't recopy them.
+    /// </remarks>
+    public class ImagePyramid
+    {
+        private MemoryImage? block;
+        private (int Level, int FirstColumn, int FirstRow, int LastColumn, int LastRow) blockTiles;
+        private readonly object blockLock;
+        private readonly byte[] jpeg;
+        private readonly GreedyDualSizeFrequencyCache<(int Level, int Column, int Row), MemoryImage> tiles;
+
+        public int PixelHeight { get; private init; }
+        public int PixelWidth { get; private init; }
+
+        private ImagePyramid(byte[] jpeg, int pixelWidth, int pixelHeight)
+        {
+            this.block = null;
+            this.blockLock = new();
+            this.blockTiles = (-1, 0, 0, -1, -1);
+            this.jpeg = jpeg;
+            this.PixelHeight = pixelHeight;
+            this.PixelWidth = pixelWidth;
+            this.tiles = new(Constant.Images.PyramidTileCacheSizeInBytes);
+        }
+
+        public long TotalPixels
+        {
+            get { return (long)this.PixelWidth * this.PixelHeight; }
+        }
+
+        /// <summary>
+        /// Get the tiles covering a region of a level copied into one image, decoding any tiles which aren't already cached.
+        /// </summary>
+        /// <param name="region">The region in the level's pixels. Parts of the region outside the level are ignored.</param>
+        /// <param name="blockBounds">The block's position and size in the level's pixels.</param>
+        /// <returns>The block, or null if the region doesn't overlap the level.</returns>
+        /// <exception cref="ArgumentException">The jpeg's header isn't decodable.</exception>
+        public MemoryImage? GetBlock(int level, Int32Rect region, out Int32Rect blockBounds)
+        {
+            return this.GetBlock(level, region, true, out blockBounds);
+        }
+
+        private MemoryImage? GetBlock(int level, Int32Rect region, bool decode, out Int32Rect blockBounds)
+        {
+            blockBounds = Int32Rect.Empty;
+            int levelHeight = this.GetLevelHeight(level);
+            int levelWidth = this.GetLevelWidth(level);
+            int left = Math.Max(region.X, 0);
+            int top = Math.Max(region.Y, 0);
+            int right = Math.Min(region.X + region.Width, levelWidth);
+            int bottom = Math.Min(region.Y + region.Height, levelHeight);
+            if ((left >= right) || (top >= bottom))
+            {
+                return null;
+            }
+
+            (int Level, int FirstColumn, int FirstRow, int LastColumn, int LastRow) blockTiles = (level, left / Constant.Images.PyramidTileSizeInPixels, top / Constant.Images.PyramidTileSizeInPixels, (right - 1) / Constant.Images.PyramidTileSizeInPixels, (bottom - 1) / Constant.Images.PyramidTileSizeInPixels);
+            Int32Rect firstTileBounds = this.GetTileBounds(level, blockTiles.FirstColumn, blockTiles.FirstRow);
+            Int32Rect lastTileBounds = this.GetTileBounds(level, blockTiles.LastColumn, blockTiles.LastRow);
+            blockBounds = new(firstTileBounds.X, firstTileBounds.Y, lastTileBounds.X + lastTileBounds.Width - firstTileBounds.X, lastTileBounds.Y + lastTileBounds.Height - firstTileBounds.Y);
+            lock (this.blockLock)
+            {
+                if ((this.block != null) && (this.blockTiles == blockTiles))
+                {
+                    return this.block;
+                }
+            }
+
+            // tiles are gathered before the block's allocated so a missing tile doesn't cost a block
+            List<(MemoryImage Tile, Int32Rect Bounds)> tiles = [];
+            for (int row = blockTiles.FirstRow; row <= blockTiles.LastRow; ++row)
+            {
+                for (int column = blockTiles.FirstColumn; column <= blockTiles.LastColumn; ++column)
+                {
+                    MemoryImage? tile;
+                    if (decode)
+                    {
+                        tile = this.GetTile(level, column, row);
+                    }
+                    else if (this.TryGetTile(level, column, row, out tile) == false)
+                    {
+                        return null;
+                    }
+                    tiles.Add((tile, this.GetTileBounds(level, column, row)));
+                }
+            }
+
+            MemoryImage block = new(blockBounds.Width, blockBounds.Height, PixelFormats.Pbgra32);
+            foreach ((MemoryImage Tile, Int32Rect Bounds) tile in tiles)
+            {
+                tile.Tile.CopyTo(block, tile.Bounds.X - blockBounds.X, tile.Bounds.Y - blockBounds.Y);
+            }
+            lock (this.blockLock)
+            {
+                this.block = block;
+                this.blockTiles = blockTiles;
+            }
+            return block;
+        }
+
+        /// <summary>
+        /// Get the coarsest level with at least one pixel per display pixel.
+        /// </summary>
+        public int GetLevel(double displayPixelsPerImagePixel)
+        {
+            int level = 0;
+            while ((level < Constant.Images.PyramidLevels - 1) && (displayPixelsPerImagePixel <= 1.0 / (2 << level)))
+            {
+                ++level;
+            }
+            return level;
+        }
+
+        // levels' sizes round up, matching the sizes of scaled jpeg decodes
+        public int GetLevelHeight(int level)
+        {
+            return (this.PixelHeight + (1 << level) - 1) >> level;
+        }
+
+        public int GetLevelWidth(int level)
+        {
+            return (this.PixelWidth + (1 << level) - 1) >> level;
+        }
+
+        /// <summary>
+        /// Get a tile, decoding it if it's not already cached.
+        /// </summary>
+        /// <exception cref="ArgumentException">The jpeg's header isn't decodable.</exception>
+        public MemoryImage GetTile(int level, int column, int row)
+        {
+            if (this.tiles.TryGetValue((level, column, row), out MemoryImage? tile))
+            {
+                return tile;
+            }
+
+            // tiles are charged their decode time so tiles far down large jpegs, which take longer to decode, are kept in
+            // preference to those near the top
+            Stopwatch stopwatch = Stopwatch.StartNew();
+            tile = new(this.jpeg, 1 << level, this.GetTileBounds(level, column, row));
+            this.tiles.AddOrUpdate((level, column, row), tile, tile.SizeInBytes, stopwatch.Elapsed.TotalMilliseconds);
+            return tile;
+        }
+
+        /// <summary>
+        /// Get the tile's position and size in its level's pixels.
+        /// </summary>
+        public Int32Rect GetTileBounds(int level, int column, int row)
+        {
+            int x = column * Constant.Images.PyramidTileSizeInPixels;
+            int y = row * Constant.Images.PyramidTileSizeInPixels;
+            int width = Math.Min(Constant.Images.PyramidTileSizeInPixels, this.GetLevelWidth(level) - x);
+            int height = Math.Min(Constant.Images.PyramidTileSizeInPixels, this.GetLevelHeight(level) - y);
+            return new Int32Rect(x, y, width, height);
+        }
+
+        /// <summary>
+        /// Get the tiles overlapping a region of the image.
+        /// </summary>
+        /// <param name="region">The region as fractions of the image's width and height.</param>
+        public List<(int Level, int Column, int Row)> GetTiles(int level, Rect region)
+        {
+            List<(int Level, int Column, int Row)> tiles = [];
+            if (region.IsEmpty || (region.Width <= 0.0) || (region.Height <= 0.0))
+            {
+                return tiles;
+            }
+
+            int levelHeight = this.GetLevelHeight(level);
+            int levelWidth = this.GetLevelWidth(level);
+            int firstColumn = Math.Max((int)(region.Left * levelWidth), 0) / Constant.Images.PyramidTileSizeInPixels;
+            int firstRow = Math.Max((int)(region.Top * levelHeight), 0) / Constant.Images.PyramidTileSizeInPixels;
+            int lastColumn = (Math.Min((int)Math.Ceiling(region.Right * levelWidth), levelWidth) - 1) / Constant.Images.PyramidTileSizeInPixels;
+            int lastRow = (Math.Min((int)Math.Ceiling(region.Bottom * levelHeight), levelHeight) - 1) / Constant.Images.PyramidTileSizeInPixels;
+
+            for (int row = firstRow; row <= lastRow; ++row)
+            {
+                for (int column = firstColumn; column <= lastColumn; ++column)
+                {
+                    tiles.Add((level, column, row));
+                }
+            }
+            return tiles;
+        }
+
+        /// <summary>
+        /// Whether a jpeg's image has at least <see cref="Constant.Images.PyramidMinimumPixels"/>, read from its header without
+        /// decoding it.
+        /// </summary>
+        public static bool IsLargeEnoughToTile(byte[] jpeg)
+        {
+            return MemoryImageCppCli.TryGetJpegSize(jpeg, out int width, out int height) && ((long)width * height >= Constant.Images.PyramidMinimumPixels);
+        }
+
+        public static bool TryCreate(byte[] jpeg, [NotNullWhen(true)] out ImagePyramid? pyramid)
+        {
+            if (MemoryImageCppCli.TryGetJpegSize(jpeg, out int width, out int height) == false)
+            {
+                pyramid = null;
+                return false;
+            }
+
+            pyramid = new(jpeg, width, height);
+            return true;
+        }
+
+        /// <summary>
+        /// Get the tiles covering a region of a level copied into one image if all of the tiles are already decoded.
+        /// </summary>
+        /// <param name="region">The region in the level's pixels. Parts of the region outside the level are ignored.</param>
+        /// <param name="blockBounds">The block's position and size in the level's pixels.</param>
+        public bool TryGetBlock(int level, Int32Rect region, [NotNullWhen(true)] out MemoryImage? block, out Int32Rect blockBounds)
+        {
+            block = this.GetBlock(level, region, false, out blockBounds);
+            return block != null;
+        }
+
+        public bool TryGetTile(int level, int column, int row, [NotNullWhen(true)] out MemoryImage? tile)
+        {
+            return this.tiles.TryGetValue((level, column, row), out tile);
+        }
+    }
+}
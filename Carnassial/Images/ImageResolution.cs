@@ -0,0 +1,10 @@
+﻿namespace Carnassial.Images
+{
+    // resolutions a file's image may be cached at, from the quickest to decode to the slowest
+    public enum ImageResolution
+    {
+        Preview = 0,
+        Display = 1,
+        Full = 2
+    }
+}
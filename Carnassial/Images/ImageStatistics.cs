@@ -0,0 +1,120 @@
+﻿using System;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+
+namespace Carnassial.Images
+{
+    /// <summary>
+    /// An image's luminosity distribution and sharpness, as stored in the file table.
+    /// </summary>
+    /// <remarks>
+    /// Percentiles are of eight bit luminosities and, like <see cref="ImageProperties.Luminosity"/>, are expressed as fractions
+    /// of full scale. Clipping is the fraction of pixels at the extremes of the luminosity range. Sharpness is the variance of
+    /// the image's Laplacian in eight bit luminosity units, so focused images typically score in the hundreds and blurred or
+    /// fogged ones in the tens or less. The Laplacian depends on scale, so sharpness is comparable only between images decoded
+    /// at the same size, such as thumbnails from the same camera model.
+    /// </remarks>
+    public class ImageStatistics
+    {
+        public double HighlightClipping { get; private init; }
+        public float[] LuminosityHistogram { get; private init; }
+        public double LuminosityPercentile5 { get; private init; }
+        public double LuminosityPercentile50 { get; private init; }
+        public double LuminosityPercentile95 { get; private init; }
+        public double ShadowClipping { get; private init; }
+        public double Sharpness { get; private init; }
+
+        public ImageStatistics(double highlightClipping, float[] luminosityHistogram, double luminosityPercentile5, double luminosityPercentile50, double luminosityPercentile95, double shadowClipping, double sharpness)
+        {
+            this.HighlightClipping = highlightClipping;
+            this.LuminosityHistogram = luminosityHistogram;
+            this.LuminosityPercentile5 = luminosityPercentile5;
+            this.LuminosityPercentile50 = luminosityPercentile50;
+            this.LuminosityPercentile95 = luminosityPercentile95;
+            this.ShadowClipping = shadowClipping;
+            this.Sharpness = sharpness;
+        }
+
+        /// <summary>
+        /// Calculate statistics from counts of pixels at each eight bit luminosity.
+        /// </summary>
+        public static ImageStatistics FromLuminosityCounts(ReadOnlySpan<int> luminosityCounts, double sharpness)
+        {
+            Debug.Assert(luminosityCounts.Length == 256, "Luminosity counts should have one bin per eight bit luminosity.");
+
+            long pixels = 0;
+            foreach (int count in luminosityCounts)
+            {
+                pixels += count;
+            }
+            if (pixels == 0)
+            {
+                return new ImageStatistics(0.0, new float[Constant.Images.LuminosityHistogramBins], 0.0, 0.0, 0.0, 0.0, sharpness);
+            }
+
+            // percentiles are the lowest luminosities at which the cumulative count reaches the percentile's rank
+            int luminositiesPerBin = luminosityCounts.Length / Constant.Images.LuminosityHistogramBins;
+            float[] histogram = new float[Constant.Images.LuminosityHistogramBins];
+            long highlightPixels = 0;
+            long shadowPixels = 0;
+            long cumulativePixels = 0;
+            int percentile5 = -1;
+            int percentile50 = -1;
+            int percentile95 = -1;
+            for (int luminosity = 0; luminosity < luminosityCounts.Length; ++luminosity)
+            {
+                int count = luminosityCounts[luminosity];
+                histogram[luminosity / luminositiesPerBin] += count;
+                if (luminosity <= Constant.Images.ShadowClippingMaximumLuminosity)
+                {
+                    shadowPixels += count;
+                }
+                else if (luminosity >= Constant.Images.HighlightClippingMinimumLuminosity)
+                {
+                    highlightPixels += count;
+                }
+
+                cumulativePixels += count;
+                if ((percentile5 < 0) && (20 * cumulativePixels >= pixels))
+                {
+                    percentile5 = luminosity;
+                }
+                if ((percentile50 < 0) && (2 * cumulativePixels >= pixels))
+                {
+                    percentile50 = luminosity;
+                }
+                if ((percentile95 < 0) && (20 * cumulativePixels >= 19 * pixels))
+                {
+                    percentile95 = luminosity;
+                }
+            }
+            for (int bin = 0; bin < histogram.Length; ++bin)
+            {
+                histogram[bin] /= pixels;
+            }
+
+            return new ImageStatistics((double)highlightPixels / pixels, histogram, percentile5 / 255.0, percentile50 / 255.0, percentile95 / 255.0, (double)shadowPixels / pixels, sharpness);
+        }
+
+        public object GetDatabaseValue(string column)
+        {
+            return column switch
+            {
+                Constant.FileColumn.HighlightClipping => this.HighlightClipping,
+                Constant.FileColumn.LuminosityHistogram => MemoryMarshal.AsBytes<float>(this.LuminosityHistogram).ToArray(),
+                Constant.FileColumn.LuminosityPercentile5 => this.LuminosityPercentile5,
+                Constant.FileColumn.LuminosityPercentile50 => this.LuminosityPercentile50,
+                Constant.FileColumn.LuminosityPercentile95 => this.LuminosityPercentile95,
+                Constant.FileColumn.ShadowClipping => this.ShadowClipping,
+                Constant.FileColumn.Sharpness => this.Sharpness,
+                _ => throw new NotSupportedException($"Unhandled image statistics column {column}.")
+            };
+        }
+
+        // histograms are stored as packed floats, as are marker positions
+        public static float[] GetLuminosityHistogram(byte[] packedFloats)
+        {
+            return MemoryMarshal.Cast<byte, float>(packedFloats).ToArray();
+        }
+    }
+}
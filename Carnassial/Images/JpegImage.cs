@@ -8,6 +8,7 @@ using System.Diagnostics;
 using System.Diagnostics.CodeAnalysis;
 using System.Globalization;
 using System.Linq;
+using System.Threading.Tasks;
 using MetadataDirectory = MetadataExtractor.Directory;
 
 namespace Carnassial.Images
@@ -29,11 +30,16 @@ namespace Carnassial.Images
         }
 
         public JpegImage(string filePath)
+            : this(filePath, false)
+        {
+            this.reader.ExtendBuffer(Constant.Images.JpegInitialBufferSize);
+        }
+
+        private JpegImage(string filePath, bool overlapped)
         {
             this.disposed = false;
             this.Metadata = null;
-            this.reader = new UnbufferedSequentialReader(filePath);
-            this.reader.ExtendBuffer(Constant.Images.JpegInitialBufferSize);
+            this.reader = new UnbufferedSequentialReader(filePath, overlapped);
         }
 
         public void Dispose()
@@ -81,23 +87,35 @@ namespace Carnassial.Images
             }
 
             Debug.Assert(preallocatedThumbnail != null);
-            double thumbnailScale = (double)preallocatedThumbnail.PixelHeight / (double)imageHeight;
-            infoBarHeight = (int)Math.Round(thumbnailScale * infoBarHeight);
-            (double luminosity, double coloration) = preallocatedThumbnail.GetLuminosityAndColoration(infoBarHeight);
+            if (imageHeight > 0)
+            {
+                double thumbnailScale = (double)preallocatedThumbnail.PixelHeight / (double)imageHeight;
+                infoBarHeight = (int)Math.Round(thumbnailScale * infoBarHeight);
+            }
+            else
+            {
+                infoBarHeight = 0;
+            }
+
+            // the thumbnail is already decoded, so the luminosity distribution and sharpness are found in the same pass as
+            // luminosity and coloration
+            (double luminosity, double coloration, ImageStatistics statistics) = preallocatedThumbnail.GetStatistics(infoBarHeight);
             return new ImageProperties(luminosity, coloration)
             {
-                MetadataResult = MetadataReadResults.Thumbnail
+                InfoBarHeight = infoBarHeight,
+                MetadataResult = MetadataReadResults.Thumbnail,
+                Statistics = statistics
             };
         }
 
-        public ImageProperties GetProperties(int? requestedWidth, ref MemoryImage? preallocatedImage)
+        public ImageProperties GetProperties(int? requestedWidth, double darkLuminosityThreshold, ref MemoryImage? preallocatedImage)
         {
-            Debug.Assert(this.reader.Buffer != null, $"Reader's buffer is unexpectedly null. {nameof(this.reader.ExtendBuffer)}() should have been called on the reader..");
+            Debug.Assert(this.reader.BufferLength > 0, $"Reader's buffer is unexpectedly empty. {nameof(this.reader.ExtendBuffer)}() should have been called on the reader..");
 
-            this.reader.ExtendBuffer((int)this.reader.Length - this.reader.Buffer.Length);
-            if ((preallocatedImage == null) || (preallocatedImage.TryDecode(this.reader.Buffer, 0, this.reader.Buffer.Length, requestedWidth) == false))
+            ArraySegment<byte> jpeg = this.reader.ExtendBufferToEndOfFile();
+            if ((preallocatedImage == null) || (preallocatedImage.TryDecode(jpeg.Array!, jpeg.Offset, jpeg.Count, requestedWidth) == false))
             {
-                preallocatedImage = new MemoryImage(this.reader.Buffer, 0, this.reader.Buffer.Length, requestedWidth);
+                preallocatedImage = new MemoryImage(jpeg.Array!, jpeg.Offset, jpeg.Count, requestedWidth);
             }
 
             this.TryGetInfoBarHeight(out int infoBarHeight);
@@ -113,7 +131,9 @@ namespace Carnassial.Images
 
             double decodingScale = (double)preallocatedImage.PixelHeight / (double)imageHeight;
             infoBarHeight = (int)Math.Round(decodingScale * infoBarHeight);
-            (double luminosity, double coloration) = preallocatedImage.GetLuminosityAndColoration(infoBarHeight);
+
+            // scaled decodes are several times larger than thumbnails, so pixels are sampled rather than all being visited
+            (double luminosity, double coloration, double _, double _) = preallocatedImage.GetLuminosityAndColoration(infoBarHeight, Constant.Images.ClassificationSamplingStride, darkLuminosityThreshold);
             return new ImageProperties(luminosity, coloration);
         }
 
@@ -127,6 +147,29 @@ namespace Carnassial.Images
             return JpegMetadataReader.ReadMetadata(filePath);
         }
 
+        /// <summary>
+        /// Opens a jpeg for overlapped IO and reads the start of the file, which contains its metadata and thumbnail.
+        /// </summary>
+        /// <remarks>
+        /// The file's opened synchronously and the read is queued before this method returns, so calling it for a batch of files
+        /// places a read for every file in the batch in the drive's queue at once. Solid state drives and arrays reach their rated
+        /// throughput only at queue depths well beyond what a few threads issuing synchronous reads can provide.
+        /// </remarks>
+        public static async Task<JpegImage> OpenAsync(string filePath)
+        {
+            JpegImage jpeg = new(filePath, true);
+            try
+            {
+                await jpeg.reader.ExtendBufferAsync(Constant.Images.JpegInitialBufferSize).ConfigureAwait(false);
+            }
+            catch
+            {
+                jpeg.Dispose();
+                throw;
+            }
+            return jpeg;
+        }
+
         public bool TryGetInfoBarHeight(out int infoBarHeight)
         {
             if (this.Metadata == null)
@@ -200,10 +243,10 @@ namespace Carnassial.Images
             {
                 throw new ImageProcessingException($"Jpeg thumbnail sizeof {thumbnailLength} bytes is below smallest expected size {Constant.Images.SmallestValidJpegSizeInBytes}.");
             }
-            Debug.Assert(this.reader.Buffer != null, $"Reader's buffer is unexpectedly null. {nameof(this.reader.ExtendBuffer)}() should have been called on the reader..");
-            if ((thumbnailOffset + thumbnailLength + Constant.Exif.MaxMetadataExtractorIssue35Offset) > this.reader.Buffer.Length)
+            Debug.Assert(this.reader.BufferLength > 0, $"Reader's buffer is unexpectedly empty. {nameof(this.reader.ExtendBuffer)}() should have been called on the reader..");
+            if ((thumbnailOffset + thumbnailLength + Constant.Exif.MaxMetadataExtractorIssue35Offset) > this.reader.BufferLength)
             {
-                throw new ImageProcessingException($"End position of thumbnail (byte {thumbnailOffset + thumbnailLength}) may exceed file buffer length of '{this.reader.Buffer.Length}'.");
+                throw new ImageProcessingException($"End position of thumbnail (byte {thumbnailOffset + thumbnailLength}) may exceed file buffer length of '{this.reader.BufferLength}'.");
             }
 
             // work around Metadata Extractor issue #35
@@ -218,7 +261,7 @@ namespace Carnassial.Images
                 // 0xffd8 is the JFIF start of image segment indicator
                 // https://en.wikipedia.org/wiki/JPEG_File_Interchange_Format#File_format_structure
                 int candidateThumbnailStartPosition = thumbnailOffset + offset;
-                if ((this.reader.Buffer[candidateThumbnailStartPosition] == 0xff) && (this.reader.Buffer[candidateThumbnailStartPosition + 1] == 0xd8))
+                if ((this.reader.GetBufferedByte(candidateThumbnailStartPosition) == 0xff) && (this.reader.GetBufferedByte(candidateThumbnailStartPosition + 1) == 0xd8))
                 {
                     issue35Offset = offset;
                     break;
@@ -226,14 +269,15 @@ namespace Carnassial.Images
             }
 
             thumbnailOffset += issue35Offset;
-            if ((thumbnailOffset + thumbnailLength) > this.reader.Buffer.Length)
+            if ((thumbnailOffset + thumbnailLength) > this.reader.BufferLength)
             {
-                throw new ImageProcessingException($"End position of thumbnail (byte {thumbnailOffset + thumbnailLength}) is beyond the file's buffer length of '{this.reader.Buffer.Length}'.");
+                throw new ImageProcessingException($"End position of thumbnail (byte {thumbnailOffset + thumbnailLength}) is beyond the file's buffer length of '{this.reader.BufferLength}'.");
             }
 
-            if ((preallocatedThumbnail == null) || (preallocatedThumbnail.TryDecode(this.reader.Buffer, thumbnailOffset, thumbnailLength, null) == false))
+            ArraySegment<byte> thumbnail = this.reader.GetContiguousBytes(thumbnailOffset, thumbnailLength);
+            if ((preallocatedThumbnail == null) || (preallocatedThumbnail.TryDecode(thumbnail.Array!, thumbnail.Offset, thumbnail.Count, null) == false))
             {
-                preallocatedThumbnail = new MemoryImage(this.reader.Buffer, thumbnailOffset, thumbnailLength, null);
+                preallocatedThumbnail = new MemoryImage(thumbnail.Array!, thumbnail.Offset, thumbnail.Count, null);
             }
             if (preallocatedThumbnail.DecompressionError)
             {
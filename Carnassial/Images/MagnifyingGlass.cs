@@ -2,6 +2,7 @@
 using System;
 using System.Diagnostics;
 using System.Globalization;
+using System.Threading.Tasks;
 using System.Windows;
 using System.Windows.Controls;
 using System.Windows.Input;
@@ -21,6 +22,13 @@ namespace Carnassial.Images
         private double magnifyingGlassAngle;
         private readonly Ellipse magnifierLens;
 
+        // the lens's view of the image, sampled from the image's pixels at the display's resolution or, for frames with pyramids,
+        // from the pyramid's tiles so detail beyond display resolution is shown without decoding the whole frame
+        // Markers are still rendered from the canvas to magnify and are overlaid by the magnifier lens's fill.
+        private MemoryImage? lensPixels;
+        private readonly Image sampledLens;
+        private bool tilesDecoding;
+
         private readonly RotateTransform rotation;
 
         /// <summary>Gets or sets the diameter of the image shown in the magnifying glass's lens in pixels.</summary>
@@ -30,9 +38,15 @@ namespace Carnassial.Images
         /// </remarks>
         public double FieldOfView { get; set; }
 
+        /// <summary>
+        /// Raised when pyramid tiles the lens needed have been decoded and the lens can be redrawn with them.
+        /// </summary>
+        public event EventHandler? TilesDecoded;
+
         public MagnifyingGlass()
         {
             this.FieldOfView = Constant.ImageDisplay.MagnifyingGlassDefaultFieldOfView;
+            this.tilesDecoding = false;
             this.IsEnabled = false;
             this.IsHitTestVisible = false;
             this.HorizontalAlignment = HorizontalAlignment.Left;
@@ -77,6 +91,14 @@ namespace Carnassial.Images
                 Fill = (Brush)App.Current.FindResource(Constant.UserInterface.ApplicationBackgroundBrush)
             };
             this.lensCanvas.Children.Add(lensBackground);
+            this.sampledLens = new Image()
+            {
+                Width = Constant.ImageDisplay.MagnifyingGlassDiameter,
+                Height = Constant.ImageDisplay.MagnifyingGlassDiameter,
+                Stretch = Stretch.Fill,
+                Visibility = Visibility.Collapsed
+            };
+            this.lensCanvas.Children.Add(this.sampledLens);
             this.Children.Add(this.lensCanvas);
 
             this.magnifierLens = new Ellipse()
@@ -146,7 +168,7 @@ namespace Carnassial.Images
             this.Visibility = Visibility.Collapsed;
         }
 
-        public void RedrawIfVisible(Canvas canvasToMagnify, Image displayImage, Point mouseImagePosition)
+        public void RedrawIfVisible(Canvas canvasToMagnify, Image imageToMagnify, MemoryImage? pixelsToMagnify, ImagePyramid? pyramidToMagnify, Image displayImage, Point mouseImagePosition)
         {
             // not visible or nothing to draw
             if ((this.IsEnabled == false) ||
@@ -160,6 +182,13 @@ namespace Carnassial.Images
             Point mouseNormalizedPosition = Marker.ConvertPointToRatio(mouseImagePosition, displayImage.ActualWidth, displayImage.ActualHeight);
             Point magnifierCenterPoint = Marker.ConvertRatioToPoint(mouseNormalizedPosition, canvasToMagnify.Width, canvasToMagnify.Height);
 
+            // sample the lens from the image's pixels if possible, in which case only markers need to be rendered from the canvas
+            // Rendering the image through the canvas is much slower as WPF draws the canvas on the UI thread at the resolution of
+            // the display image, rather than of the image to magnify, and then scales it up.
+            bool lensSampled = this.TrySampleLens(pixelsToMagnify, pyramidToMagnify, mouseNormalizedPosition, canvasToMagnify.Width);
+            imageToMagnify.Visibility = lensSampled ? Visibility.Hidden : Visibility.Visible;
+            this.sampledLens.Visibility = lensSampled ? Visibility.Visible : Visibility.Collapsed;
+
             // create a brush from the unaltered image in the magnification canvas and use it to fill the magnifying glass
             VisualBrush magnifierBrush = new(canvasToMagnify)
             {
@@ -269,5 +298,97 @@ namespace Carnassial.Images
         {
             this.Visibility = Visibility.Visible;
         }
+
+        // start decoding pyramid tiles the lens needs off the UI thread, raising TilesDecoded once they're available
+        // Only one decode's in flight at a time. If the pointer's moved on by the time it completes the redraw requests the tiles
+        // under the pointer's new position.
+        private async Task DecodeTilesAsync(ImagePyramid pyramid, int level, Int32Rect region)
+        {
+            if (this.tilesDecoding)
+            {
+                return;
+            }
+
+            this.tilesDecoding = true;
+            MemoryImage? block;
+            try
+            {
+                block = await Task.Run(() => pyramid.GetBlock(level, region, out Int32Rect _)).ConfigureAwait(true);
+            }
+            catch (ArgumentException)
+            {
+                // jpeg's been truncated or otherwise can't be decoded, so the lens stays at display resolution
+                return;
+            }
+            finally
+            {
+                this.tilesDecoding = false;
+            }
+            if (block != null)
+            {
+                this.TilesDecoded?.Invoke(this, EventArgs.Empty);
+            }
+        }
+
+        private bool TrySampleLens(MemoryImage? pixelsToMagnify, ImagePyramid? pyramidToMagnify, Point normalizedCenter, double canvasWidth)
+        {
+            if ((pixelsToMagnify == null) || (canvasWidth <= 0.0))
+            {
+                return false;
+            }
+
+            // size the lens to the display's pixels so it's as sharp as the display allows
+            // The lens sampler works in groups of four pixels so the diameter's rounded up to a multiple of four.
+            int lensDiameterInPixels = 4 * (int)Math.Ceiling(VisualTreeHelper.GetDpi(this).DpiScaleX * Constant.ImageDisplay.MagnifyingGlassDiameter / 4.0);
+            if ((this.lensPixels == null) || (this.lensPixels.PixelWidth != lensDiameterInPixels))
+            {
+                this.lensPixels = new(lensDiameterInPixels, lensDiameterInPixels, PixelFormats.Pbgra32);
+            }
+
+            // if the frame has a pyramid, sample from the coarsest level with at least one pixel per lens pixel when that's more
+            // detailed than the display image
+            // Until the level's tiles under the lens are decoded the lens is sampled from the display image.
+            // The field of view is in the canvas's units, which may differ from the image's pixels.
+            if (pyramidToMagnify != null)
+            {
+                double levelZeroPixelsPerLensPixel = this.FieldOfView * pyramidToMagnify.PixelWidth / (canvasWidth * lensDiameterInPixels);
+                int level = pyramidToMagnify.GetLevel(1.0 / levelZeroPixelsPerLensPixel);
+                int levelHeight = pyramidToMagnify.GetLevelHeight(level);
+                int levelWidth = pyramidToMagnify.GetLevelWidth(level);
+                if (levelWidth > pixelsToMagnify.PixelWidth)
+                {
+                    // the region includes a pixel of margin as the lens is sampled bilinearly
+                    Point levelCenter = new(normalizedCenter.X * levelWidth, normalizedCenter.Y * levelHeight);
+                    double levelPixelsPerLensPixel = this.FieldOfView * levelWidth / (canvasWidth * lensDiameterInPixels);
+                    double lensRadiusInLevelPixels = 0.5 * levelPixelsPerLensPixel * lensDiameterInPixels + 1.0;
+                    int regionX = (int)Math.Floor(levelCenter.X - lensRadiusInLevelPixels);
+                    int regionY = (int)Math.Floor(levelCenter.Y - lensRadiusInLevelPixels);
+                    int regionSize = (int)Math.Ceiling(2.0 * lensRadiusInLevelPixels) + 1;
+                    Int32Rect region = new(regionX, regionY, regionSize, regionSize);
+                    if (pyramidToMagnify.TryGetBlock(level, region, out MemoryImage? block, out Int32Rect blockBounds))
+                    {
+                        Point blockCenter = new(levelCenter.X - blockBounds.X, levelCenter.Y - blockBounds.Y);
+                        if (block.TryMagnify(blockCenter, levelPixelsPerLensPixel, this.lensPixels))
+                        {
+                            this.lensPixels.SetSource(this.sampledLens);
+                            return true;
+                        }
+                    }
+                    else
+                    {
+                        _ = this.DecodeTilesAsync(pyramidToMagnify, level, region);
+                    }
+                }
+            }
+
+            Point center = new(normalizedCenter.X * pixelsToMagnify.PixelWidth, normalizedCenter.Y * pixelsToMagnify.PixelHeight);
+            double pixelsPerLensPixel = this.FieldOfView * pixelsToMagnify.PixelWidth / (canvasWidth * lensDiameterInPixels);
+            if (pixelsToMagnify.TryMagnify(center, pixelsPerLensPixel, this.lensPixels) == false)
+            {
+                return false;
+            }
+            this.lensPixels.SetSource(this.sampledLens);
+            return true;
+        }
     }
 }
@@ -0,0 +1,98 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics.CodeAnalysis;
+
+namespace Carnassial.Images
+{
+    /// <summary>
+    /// Values calculated from the images of the most recently differenced pairs of files, such as sums of absolute differences
+    /// and translations.
+    /// </summary>
+    /// <remarks>
+    /// A file's image is differenced against both its neighbours and, as navigation moves, its neighbours are differenced
+    /// against it. The sums between a file and the next file, for example, are the next file's previous sums once navigation
+    /// steps to the next file. Keeping the few most recent pairs therefore means sequential differencing calculates one new
+    /// value per file, whichever direction navigation's moving in.
+    ///
+    /// Pairs are ordered by default, as sums are in the first file's pixel coordinates, which differ from the second file's if
+    /// the camera's shaken between the files. If a reverse function is given a pair also matches lookups in the opposite order,
+    /// which get the value passed through the function, as a translation is negated. Values don't depend on the difference
+    /// threshold so remain valid if the threshold's changed.
+    /// </remarks>
+    internal class RecentPairWindow<TValue>
+    {
+        private readonly int capacity;
+        private readonly Func<TValue, TValue>? reverse;
+        // least recently used pair first
+        private readonly List<(long ID, long OtherID, TValue Value)> valuesByPair;
+
+        public RecentPairWindow(int capacity)
+            : this(capacity, null)
+        {
+        }
+
+        public RecentPairWindow(int capacity, Func<TValue, TValue>? reverse)
+        {
+            this.capacity = capacity;
+            this.reverse = reverse;
+            this.valuesByPair = new(capacity);
+        }
+
+        public void Add(long id, long otherID, TValue value)
+        {
+            lock (this.valuesByPair)
+            {
+                int index = this.IndexOf(id, otherID);
+                if (index >= 0)
+                {
+                    this.valuesByPair.RemoveAt(index);
+                }
+                else if (this.valuesByPair.Count >= this.capacity)
+                {
+                    this.valuesByPair.RemoveAt(0);
+                }
+                this.valuesByPair.Add((id, otherID, value));
+            }
+        }
+
+        public void Clear()
+        {
+            lock (this.valuesByPair)
+            {
+                this.valuesByPair.Clear();
+            }
+        }
+
+        private int IndexOf(long id, long otherID)
+        {
+            for (int index = 0; index < this.valuesByPair.Count; ++index)
+            {
+                (long pairID, long pairOtherID, TValue _) = this.valuesByPair[index];
+                if (((pairID == id) && (pairOtherID == otherID)) || ((this.reverse != null) && (pairID == otherID) && (pairOtherID == id)))
+                {
+                    return index;
+                }
+            }
+            return -1;
+        }
+
+        public bool TryGet(long id, long otherID, [MaybeNullWhen(false)] out TValue value)
+        {
+            lock (this.valuesByPair)
+            {
+                int index = this.IndexOf(id, otherID);
+                if (index < 0)
+                {
+                    value = default;
+                    return false;
+                }
+
+                (long ID, long OtherID, TValue Value) pair = this.valuesByPair[index];
+                this.valuesByPair.RemoveAt(index);
+                this.valuesByPair.Add(pair);
+                value = pair.ID == id ? pair.Value : this.reverse!(pair.Value);
+                return true;
+            }
+        }
+    }
+}
@@ -0,0 +1,188 @@
+﻿using System;
+using System.Diagnostics.CodeAnalysis;
+using System.IO;
+using System.Threading.Tasks;
+using System.Windows.Media.Imaging;
+
+namespace Carnassial.Images
+{
+    /// <summary>
+    /// Frames sampled evenly across an MJPEG video, laid out side by side in a single image, along with each frame's change from the
+    /// first frame.
+    /// </summary>
+    /// <remarks>
+    /// Intended for video triage: a strip shows a clip's content at a glance and a low maximum change score indicates the
+    /// video likely contains no animal activity. Since an animal small in the frame barely moves a frame's mean difference, each
+    /// frame's <see cref="BlockChangeMap"/> against the first frame is also kept, which catches such animals and shows where
+    /// they are. The first frame's luminosity, coloration, and <see cref="ImageStatistics"/> are found from its decode as well, so
+    /// videos get the same luminosity distribution images get from their thumbnails. Frames are decoded at 1/8 scale, which is ample for these purposes and costs well under a millisecond per frame
+    /// for typical trail camera resolutions, and frame decoding is spread across cores. Reading the frames' jpegs is left
+    /// sequential as hybrid videos are small enough their reads are short and the frame offsets are ascending, which keeps the
+    /// reads in file order.
+    /// </remarks>
+    public class VideoKeyframeStrip
+    {
+        /// <summary>
+        /// Each frame's change from the first frame by block. Null if the frame couldn't be decoded.
+        /// </summary>
+        public BlockChangeMap?[] ChangeMaps { get; private init; }
+        /// <summary>
+        /// Mean absolute difference of each frame from the first frame, as a fraction of full scale. <see cref="Double.NaN"/> if the
+        /// frame couldn't be decoded.
+        /// </summary>
+        public double[] ChangeScores { get; private init; }
+        /// <summary>
+        /// Luminosity, coloration, and statistics of the first frame. Info bars aren't located in videos' frames, so they're
+        /// included.
+        /// </summary>
+        public ImageProperties FirstFrameProperties { get; private init; }
+        public int[] FrameIndices { get; private init; }
+        public MemoryImage Strip { get; private init; }
+
+        private VideoKeyframeStrip(int[] frameIndices, double[] changeScores, BlockChangeMap?[] changeMaps, ImageProperties firstFrameProperties, MemoryImage strip)
+        {
+            this.ChangeMaps = changeMaps;
+            this.ChangeScores = changeScores;
+            this.FirstFrameProperties = firstFrameProperties;
+            this.FrameIndices = frameIndices;
+            this.Strip = strip;
+        }
+
+        /// <summary>
+        /// Gets whether any block of any frame differs from the first frame by more than
+        /// <see cref="Constant.Images.BlockChangeThresholdDefault"/>.
+        /// </summary>
+        public bool HasChange
+        {
+            get
+            {
+                foreach (BlockChangeMap? changeMap in this.ChangeMaps)
+                {
+                    if ((changeMap != null) && changeMap.HasChange(Constant.Images.BlockChangeThresholdDefault))
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+        }
+
+        public double MaximumChangeScore
+        {
+            get
+            {
+                double maximum = 0.0;
+                foreach (double changeScore in this.ChangeScores)
+                {
+                    if (changeScore > maximum)
+                    {
+                        maximum = changeScore;
+                    }
+                }
+                return maximum;
+            }
+        }
+
+        private static int[] GetFrameIndices(int framesInVideo, int framesRequested)
+        {
+            int frames = Math.Min(framesInVideo, framesRequested);
+            int[] frameIndices = new int[frames];
+            for (int frame = 1; frame < frames; ++frame)
+            {
+                frameIndices[frame] = (int)((Int64)frame * (framesInVideo - 1) / (frames - 1));
+            }
+            return frameIndices;
+        }
+
+        public static bool TryCreate(string videoFilePath, int framesRequested, [NotNullWhen(true)] out VideoKeyframeStrip? keyframeStrip)
+        {
+            if (framesRequested < 1)
+            {
+                throw new ArgumentOutOfRangeException(nameof(framesRequested), $"{framesRequested} frames requested but at least one frame is needed for a strip.");
+            }
+
+            keyframeStrip = null;
+            using AviMjpegReader avi = new(videoFilePath);
+            if ((avi.IsMjpeg == false) || (avi.FrameCount < 1))
+            {
+                return false;
+            }
+
+            // read the sampled frames' jpegs
+            int[] frameIndices = VideoKeyframeStrip.GetFrameIndices(avi.FrameCount, framesRequested);
+            byte[]?[] jpegs = new byte[frameIndices.Length][];
+            int[] jpegLengths = new int[frameIndices.Length];
+            for (int frame = 0; frame < frameIndices.Length; ++frame)
+            {
+                jpegLengths[frame] = avi.ReadFrame(frameIndices[frame], ref jpegs[frame]);
+            }
+
+            // decode at 1/8 scale
+            // If the AVI header lacks the video's width the request rounds to one pixel, which also selects 1/8 scale. Frames are
+            // decoded on the calling thread if it's already one of a set spread across cores.
+            int requestedWidth = Math.Max(avi.PixelWidth / 8, 1);
+            MemoryImage?[] frames = new MemoryImage?[frameIndices.Length];
+            ParallelOptions parallelOptions = new()
+            {
+                MaxDegreeOfParallelism = MemoryImage.ProcessBlocksOnCurrentThread ? 1 : -1
+            };
+            Parallel.For(0, frameIndices.Length, parallelOptions, (int frame) =>
+            {
+                try
+                {
+                    MemoryImage image = new(jpegs[frame]!, 0, jpegLengths[frame], requestedWidth);
+                    if (image.DecompressionError == false)
+                    {
+                        frames[frame] = image;
+                    }
+                }
+                catch (ArgumentException)
+                {
+                    // frame's jpeg header isn't decodable; leave frame null
+                }
+            });
+
+            MemoryImage? firstFrame = frames[0];
+            if (firstFrame == null)
+            {
+                return false;
+            }
+
+            // score and lay out frames
+            // Frames whose size differs from the first frame's, which shouldn't occur in a well formed video, are treated as not
+            // decodable.
+            BlockChangeMap?[] changeMaps = new BlockChangeMap?[frameIndices.Length];
+            double[] changeScores = new double[frameIndices.Length];
+            MemoryImage strip = new(frameIndices.Length * firstFrame.PixelWidth, firstFrame.PixelHeight, firstFrame.Format);
+            for (int frame = 0; frame < frameIndices.Length; ++frame)
+            {
+                MemoryImage? image = frames[frame];
+                if ((image == null) || (image.TryGetMeanAbsoluteDifference(firstFrame, out changeScores[frame]) == false))
+                {
+                    changeScores[frame] = Double.NaN;
+                    continue;
+                }
+                image.TryGetBlockChangeMap(firstFrame, Constant.Images.BlockChangeSizeInPixels, out changeMaps[frame]);
+                image.CopyTo(strip, frame * firstFrame.PixelWidth, 0);
+            }
+
+            (double luminosity, double coloration, ImageStatistics statistics) = firstFrame.GetStatistics(0);
+            ImageProperties firstFrameProperties = new(luminosity, coloration)
+            {
+                Statistics = statistics
+            };
+            keyframeStrip = new VideoKeyframeStrip(frameIndices, changeScores, changeMaps, firstFrameProperties, strip);
+            return true;
+        }
+
+        public void Write(Stream stream)
+        {
+            JpegBitmapEncoder encoder = new()
+            {
+                QualityLevel = Constant.Images.VideoKeyframeStripJpegQuality
+            };
+            encoder.Frames.Add(BitmapFrame.Create(this.Strip.AsBitmapSource()));
+            encoder.Save(stream);
+        }
+    }
+}
@@ -13,8 +13,28 @@ namespace Carnassial.Interop
 {
     internal partial class NativeMethods
     {
+        private const int ATTACH_PARENT_PROCESS = -1;
+        private const int ERROR_MORE_DATA = 234;
         private const int FILE_ATTRIBUTE_DIRECTORY = 0x10;
         private const int FILE_ATTRIBUTE_NORMAL = 0x80;
+        private const int FILE_READ_ATTRIBUTES = 0x80;
+        private const int FSCTL_GET_RETRIEVAL_POINTERS = 0x00090073;
+        private const int IOCTL_STORAGE_QUERY_PROPERTY = 0x002d1400;
+        private const int PropertyStandardQuery = 0;
+        private const int StorageDeviceSeekPenaltyProperty = 7;
+
+        [LibraryImport(Constant.Assembly.Kernel32, SetLastError = true)]
+        [return: MarshalAs(UnmanagedType.Bool)]
+        private static partial bool AttachConsole(int dwProcessId);
+
+        /// <summary>
+        /// Send console output to the console of the process which started Carnassial, such as a command prompt.
+        /// </summary>
+        /// <returns>false if the parent process doesn't have a console, in which case console output is discarded.</returns>
+        public static bool AttachParentConsole()
+        {
+            return NativeMethods.AttachConsole(NativeMethods.ATTACH_PARENT_PROCESS);
+        }
 
         public static SafeFileHandle CreateFileUnbuffered(string path, bool overlapped)
         {
@@ -48,6 +68,17 @@ namespace Carnassial.Interop
             return new ComReleaser<IShellItem>((IShellItem)NativeMethods.SHCreateItemFromParsingName(path, null, ref shellItemGuid));
         }
 
+        [LibraryImport(Constant.Assembly.Kernel32, SetLastError = true)]
+        [return: MarshalAs(UnmanagedType.Bool)]
+        private static unsafe partial bool DeviceIoControl(SafeFileHandle hDevice,
+                                                           int dwIoControlCode,
+                                                           void* lpInBuffer,
+                                                           int nInBufferSize,
+                                                           void* lpOutBuffer,
+                                                           int nOutBufferSize,
+                                                           out int lpBytesReturned,
+                                                           NativeOverlapped* lpOverlapped);
+
         [LibraryImport(Constant.Assembly.Kernel32, EntryPoint = "GetDiskFreeSpaceA", SetLastError = true, StringMarshalling = StringMarshalling.Utf8)]
         [return: MarshalAs(UnmanagedType.Bool)]
         private static partial bool GetDiskFreeSpace(string lpRootPathName, out uint lpSectorsPerCluster, out uint lpBytesPerSector, out uint lpNumberOfFreeClusters, out uint lpTotalNumberOfClusters);
@@ -66,6 +97,38 @@ namespace Carnassial.Interop
         [return: MarshalAs(UnmanagedType.Bool)]
         private static partial bool GetFileSizeEx(SafeFileHandle hFile, out long lpFileSize);
 
+        /// <summary>
+        /// Get the logical cluster number at which a file's data starts on its volume.
+        /// </summary>
+        /// <returns>-1 if the file's location isn't available. This is the case for files small enough to be stored in their
+        /// directory entry, files on volumes which don't report cluster allocations, and files which can't be opened.</returns>
+        public static unsafe long GetFirstLogicalClusterNumber(string filePath)
+        {
+            // querying a file's clusters requires only attribute access, so files other processes have open can still be queried
+            using SafeFileHandle file = NativeMethods.CreateFile(filePath, (FileAccess)NativeMethods.FILE_READ_ATTRIBUTES, FileShare.ReadWrite | FileShare.Delete, IntPtr.Zero, FileMode.Open, FileAttributesNative.Normal, IntPtr.Zero);
+            if (file.IsInvalid)
+            {
+                return -1;
+            }
+
+            // a buffer with room for one extent is sufficient as only the first extent's location is needed
+            // DeviceIoControl() fails with ERROR_MORE_DATA for files with more than one extent but still returns the first extent.
+            long startingVcn = 0;
+            RETRIEVAL_POINTERS_BUFFER retrievalPointers = default;
+            if ((NativeMethods.DeviceIoControl(file, NativeMethods.FSCTL_GET_RETRIEVAL_POINTERS, &startingVcn, sizeof(long), &retrievalPointers, sizeof(RETRIEVAL_POINTERS_BUFFER), out int _, null) == false) &&
+                (Marshal.GetLastWin32Error() != NativeMethods.ERROR_MORE_DATA))
+            {
+                return -1;
+            }
+            if (retrievalPointers.ExtentCount < 1)
+            {
+                return -1;
+            }
+
+            // the first extent's cluster number is -1 if the extent isn't allocated on disk, as with sparse files
+            return retrievalPointers.Lcn;
+        }
+
         public static CultureInfo GetKeyboardCulture()
         {
             long keyboardLayout = NativeMethods.GetKeyboardLayout(0).ToInt64();
@@ -125,6 +188,48 @@ namespace Carnassial.Interop
         [LibraryImport(Constant.Assembly.Kernel32)]
         public static partial UInt64 GetTickCount64();
 
+        /// <summary>
+        /// Whether reads from the volume containing a path are likely to be slowed by seeks. This is true of hard drives and
+        /// of the SD and compact flash cards trail cameras write to, which are usually read through removable card readers.
+        /// </summary>
+        public static unsafe bool IncursSeekPenalty(string path)
+        {
+            // network shares and other volumes without drive letters aren't queried
+            string? root = Path.GetPathRoot(Path.GetFullPath(path));
+            if ((root == null) || (root.Length != 3) || (root[1] != ':'))
+            {
+                return false;
+            }
+            DriveInfo drive = new(root);
+            if (drive.DriveType == DriveType.Removable)
+            {
+                return true;
+            }
+            if (drive.DriveType != DriveType.Fixed)
+            {
+                return false;
+            }
+
+            // volume handles opened without access rights can still be queried for storage properties
+            using SafeFileHandle volume = NativeMethods.CreateFile("\\\\.\\" + root[..2], (FileAccess)0, FileShare.ReadWrite, IntPtr.Zero, FileMode.Open, (FileAttributesNative)0, IntPtr.Zero);
+            if (volume.IsInvalid)
+            {
+                return false;
+            }
+            STORAGE_PROPERTY_QUERY query = new()
+            {
+                PropertyId = NativeMethods.StorageDeviceSeekPenaltyProperty,
+                QueryType = NativeMethods.PropertyStandardQuery
+            };
+            DEVICE_SEEK_PENALTY_DESCRIPTOR seekPenalty = default;
+            if ((NativeMethods.DeviceIoControl(volume, NativeMethods.IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(STORAGE_PROPERTY_QUERY), &seekPenalty, sizeof(DEVICE_SEEK_PENALTY_DESCRIPTOR), out int bytesReturned, null) == false) ||
+                (bytesReturned < sizeof(DEVICE_SEEK_PENALTY_DESCRIPTOR)))
+            {
+                return false;
+            }
+            return seekPenalty.IncursSeekPenalty != 0;
+        }
+
         public static void MoveToRecycleBin(string filePath)
         {
             if (String.IsNullOrEmpty(filePath))
@@ -187,6 +292,14 @@ namespace Carnassial.Interop
         [DllImport(Constant.Assembly.Shell32, CharSet = CharSet.Unicode)]
         private static extern int SHFileOperation([In] ref SHFILEOPSTRUCT lpFileOp);
 
+        [StructLayout(LayoutKind.Sequential)]
+        private struct DEVICE_SEEK_PENALTY_DESCRIPTOR
+        {
+            public uint Version;
+            public uint Size;
+            public byte IncursSeekPenalty;
+        }
+
         [Flags]
         private enum FileAttributesNative : uint
         {
@@ -288,6 +401,16 @@ namespace Carnassial.Interop
             FOF_NORECURSEREPARSE = 0x8000
         }
 
+        // RETRIEVAL_POINTERS_BUFFER with a single extent
+        [StructLayout(LayoutKind.Sequential)]
+        private struct RETRIEVAL_POINTERS_BUFFER
+        {
+            public int ExtentCount;
+            public long StartingVcn;
+            public long NextVcn;
+            public long Lcn;
+        }
+
         private enum SHFileOpFunc : uint
         {
             FO_MOVE = 0x1,
@@ -312,5 +435,13 @@ namespace Carnassial.Interop
             [MarshalAs(UnmanagedType.LPWStr)]
             public string? lpszProgressTitle;
         }
+
+        [StructLayout(LayoutKind.Sequential)]
+        private struct STORAGE_PROPERTY_QUERY
+        {
+            public int PropertyId;
+            public int QueryType;
+            public byte AdditionalParameters;
+        }
     }
 }
@@ -0,0 +1,211 @@
+﻿using System;
+using System.Buffers;
+using System.Collections.Generic;
+using System.Diagnostics;
+
+namespace Carnassial.Interop
+{
+    /// <summary>
+    /// Growable buffer for unbuffered reads, consisting of a chain of arrays rented from <see cref="ArrayPool{T}.Shared"/>.
+    /// </summary>
+    /// <remarks>
+    /// Growing a single array requires reallocating and copying everything read so far, so reading a file in several steps costs
+    /// several times the file's size in allocation and copying. A chain grows by renting another segment instead and copies only
+    /// when a caller needs a contiguous view of a range which spans segments, which for jpegs is rare as metadata and thumbnails
+    /// typically fall within the first segment. When a whole file's needed contiguously, as for full resolution decoding,
+    /// <see cref="EnsureContiguousCapacity(int)"/> moves what's been read to an array sized for the file before the rest of
+    /// the file is read into it, so only the start of the file is copied.
+    ///
+    /// Reads are sized in whole sectors and, since each segment is filled from its start in sector multiples, every read starts
+    /// at a sector aligned offset within its segment. Segments are returned to the pool on dispose, so steady state file loading
+    /// rents and returns the same few arrays rather than allocating per file.
+    /// </remarks>
+    public class SectorBufferChain : IDisposable
+    {
+        private byte[]? coalescedBytes;
+        private bool disposed;
+        private int lastSegmentIndexAccessed;
+        private readonly List<BufferSegment> segments;
+
+        public int Length { get; private set; }
+
+        public SectorBufferChain()
+        {
+            this.coalescedBytes = null;
+            this.disposed = false;
+            this.lastSegmentIndexAccessed = 0;
+            this.Length = 0;
+            this.segments = [];
+        }
+
+        public byte this[int position]
+        {
+            get
+            {
+                BufferSegment segment = this.segments[this.GetSegmentIndex(position)];
+                return segment.Array[position - segment.Start];
+            }
+        }
+
+        /// <summary>
+        /// Indicate bytesWritten bytes were read into the memory returned by <see cref="GetWritableMemory(int)"/>.
+        /// </summary>
+        public void Advance(int bytesWritten)
+        {
+            Debug.Assert(this.segments.Count > 0, "No segment to advance.");
+            BufferSegment lastSegment = this.segments[^1];
+            Debug.Assert(lastSegment.Length + bytesWritten <= lastSegment.Array.Length, $"Advance of {bytesWritten} bytes overruns segment.");
+            lastSegment.Length += bytesWritten;
+            this.segments[^1] = lastSegment;
+            this.Length += bytesWritten;
+        }
+
+        public void CopyTo(int position, Span<byte> destination)
+        {
+            Debug.Assert(position + destination.Length <= this.Length, $"Copy of {destination.Length} bytes from position {position} overruns buffer length {this.Length}.");
+            for (int segmentIndex = this.GetSegmentIndex(position); destination.Length > 0; ++segmentIndex)
+            {
+                BufferSegment segment = this.segments[segmentIndex];
+                int offsetInSegment = position - segment.Start;
+                int bytesToCopy = Math.Min(segment.Length - offsetInSegment, destination.Length);
+                segment.Array.AsSpan(offsetInSegment, bytesToCopy).CopyTo(destination);
+                destination = destination[bytesToCopy..];
+                position += bytesToCopy;
+            }
+        }
+
+        public void Dispose()
+        {
+            this.Dispose(true);
+            GC.SuppressFinalize(this);
+        }
+
+        protected virtual void Dispose(bool disposing)
+        {
+            if (this.disposed)
+            {
+                return;
+            }
+
+            if (disposing)
+            {
+                this.ReturnSegments();
+                if (this.coalescedBytes != null)
+                {
+                    ArrayPool<byte>.Shared.Return(this.coalescedBytes);
+                    this.coalescedBytes = null;
+                }
+            }
+
+            this.disposed = true;
+        }
+
+        /// <summary>
+        /// Ensure the buffer can grow to at least capacity bytes with all of its contents in one array.
+        /// </summary>
+        public void EnsureContiguousCapacity(int capacity)
+        {
+            if ((this.segments.Count == 1) && (this.segments[0].Array.Length >= capacity))
+            {
+                return;
+            }
+
+            byte[] array = ArrayPool<byte>.Shared.Rent(capacity);
+            this.CopyTo(0, array.AsSpan(0, this.Length));
+            this.ReturnSegments();
+            this.segments.Add(new BufferSegment(array, 0, this.Length));
+        }
+
+        /// <summary>
+        /// Get a view of a range of the buffer as a single array, copying the range if it spans segments. The view's valid only
+        /// until the next call to this method or until the buffer's disposed.
+        /// </summary>
+        public ArraySegment<byte> GetContiguous(int position, int length)
+        {
+            Debug.Assert(position + length <= this.Length, $"Range of {length} bytes from position {position} overruns buffer length {this.Length}.");
+            BufferSegment segment = this.segments[this.GetSegmentIndex(position)];
+            int offsetInSegment = position - segment.Start;
+            if (offsetInSegment + length <= segment.Length)
+            {
+                return new(segment.Array, offsetInSegment, length);
+            }
+
+            if ((this.coalescedBytes == null) || (this.coalescedBytes.Length < length))
+            {
+                if (this.coalescedBytes != null)
+                {
+                    ArrayPool<byte>.Shared.Return(this.coalescedBytes);
+                }
+                this.coalescedBytes = ArrayPool<byte>.Shared.Rent(length);
+            }
+            this.CopyTo(position, this.coalescedBytes.AsSpan(0, length));
+            return new(this.coalescedBytes, 0, length);
+        }
+
+        private int GetSegmentIndex(int position)
+        {
+            // access is mostly sequential, so start from the most recently accessed segment
+            if ((position < 0) || (position >= this.Length))
+            {
+                throw new ArgumentOutOfRangeException(nameof(position), $"Position {position} is outside the buffer's {this.Length} bytes.");
+            }
+
+            int segmentIndex = this.lastSegmentIndexAccessed < this.segments.Count ? this.lastSegmentIndexAccessed : 0;
+            while (position < this.segments[segmentIndex].Start)
+            {
+                --segmentIndex;
+            }
+            while (position >= this.segments[segmentIndex].Start + this.segments[segmentIndex].Length)
+            {
+                ++segmentIndex;
+            }
+            this.lastSegmentIndexAccessed = segmentIndex;
+            return segmentIndex;
+        }
+
+        /// <summary>
+        /// Get memory to read at least minimumLength bytes into, renting a new segment of at least minimumSegmentLength bytes if
+        /// the last segment lacks space. Call <see cref="Advance(int)"/> with the number of bytes read.
+        /// </summary>
+        public Memory<byte> GetWritableMemory(int minimumLength, int minimumSegmentLength)
+        {
+            if (this.segments.Count > 0)
+            {
+                BufferSegment lastSegment = this.segments[^1];
+                int available = lastSegment.Array.Length - lastSegment.Length;
+                if (available >= minimumLength)
+                {
+                    return lastSegment.Array.AsMemory(lastSegment.Length, available);
+                }
+            }
+
+            byte[] array = ArrayPool<byte>.Shared.Rent(Math.Max(minimumLength, minimumSegmentLength));
+            this.segments.Add(new BufferSegment(array, this.Length, 0));
+            return array.AsMemory();
+        }
+
+        private void ReturnSegments()
+        {
+            foreach (BufferSegment segment in this.segments)
+            {
+                ArrayPool<byte>.Shared.Return(segment.Array);
+            }
+            this.segments.Clear();
+            this.lastSegmentIndexAccessed = 0;
+        }
+
+        private struct BufferSegment
+        {
+            public byte[] Array;
+            public int Length;
+            public int Start;
+
+            public BufferSegment(byte[] array, int start, int length)
+            {
+                this.Array = array;
+                this.Length = length;
+                this.Start = start;
+            }
+        }
+    }
+}
@@ -4,10 +4,9 @@ using System;
 using System.Collections.Concurrent;
 using System.ComponentModel;
 using System.Diagnostics;
-using System.Globalization;
 using System.IO;
 using System.Runtime.InteropServices;
-using ClrBuffer = System.Buffer;
+using System.Threading.Tasks;
 
 namespace Carnassial.Interop
 {
@@ -15,29 +14,39 @@ namespace Carnassial.Interop
     {
         private static readonly ConcurrentDictionary<string, int> SectorSizeByPathRoot;
 
+        private readonly SectorBufferChain buffer;
         private int bufferPosition;
         private bool disposed;
         private readonly SafeFileHandle file;
         private int filePosition;
         private readonly Lazy<long> length;
+        private readonly bool overlapped;
         private readonly Lazy<string> pathRoot;
 
-        public byte[]? Buffer { get; private set; }
-
         static UnbufferedSequentialReader()
         {
             UnbufferedSequentialReader.SectorSizeByPathRoot = new ConcurrentDictionary<string, int>();
         }
 
         public UnbufferedSequentialReader(string filePath)
+            : this(filePath, false)
+        {
+        }
+
+        /// <param name="overlapped">
+        /// Whether the file is opened for overlapped IO. Overlapped readers support <see cref="ExtendBufferAsync(int)"/>, which
+        /// allows reads from many files to be queued to the drive at once.
+        /// </param>
+        public UnbufferedSequentialReader(string filePath, bool overlapped)
             : base(true)
         {
-            this.Buffer = null;
+            this.buffer = new();
             this.bufferPosition = 0;
             this.disposed = false;
-            this.file = NativeMethods.CreateFileUnbuffered(filePath, false);
+            this.file = NativeMethods.CreateFileUnbuffered(filePath, overlapped);
             this.filePosition = 0;
             this.length = new Lazy<long>(() => { return NativeMethods.GetFileSizeEx(this.file); });
+            this.overlapped = overlapped;
             this.pathRoot = new Lazy<string>(() =>
             {
                 string? root = Path.GetPathRoot(filePath);
@@ -49,6 +58,14 @@ namespace Carnassial.Interop
             });
         }
 
+        /// <summary>
+        /// Number of bytes from the start of the file which have been read.
+        /// </summary>
+        public int BufferLength
+        {
+            get { return this.buffer.Length; }
+        }
+
         public long Length
         {
             get { return this.length.Value; }
@@ -64,24 +81,6 @@ namespace Carnassial.Interop
             throw new NotImplementedException();
         }
 
-        public void ExtendBuffer(int bytesToRead)
-        {
-            byte[]? existingBuffer = this.Buffer;
-            int existingBufferLength = existingBuffer == null ? 0 : existingBuffer.Length;
-            this.Buffer = new byte[existingBufferLength + bytesToRead];
-            if (existingBufferLength > 0)
-            {
-                ClrBuffer.BlockCopy(existingBuffer!, 0, this.Buffer, 0, existingBufferLength);
-            }
-
-            int bytesRead = this.Read(this.Buffer, existingBufferLength, bytesToRead);
-            if (bytesRead != bytesToRead)
-            {
-                throw new IOException($"Only {bytesRead} instead of {bytesToRead} bytes were read.");
-            }
-            this.filePosition += bytesRead;
-        }
-
         public void Dispose()
         {
             this.Dispose(true);
@@ -97,26 +96,71 @@ namespace Carnassial.Interop
 
             if (disposing)
             {
+                this.buffer.Dispose();
                 this.file.Dispose();
             }
 
             this.disposed = true;
         }
 
-        public override byte GetByte()
+        public void ExtendBuffer(int bytesToRead)
+        {
+            Memory<byte> destination = this.buffer.GetWritableMemory(bytesToRead, Constant.Images.UnbufferedReadSegmentSize);
+            int bytesRead = this.Read(destination.Span[..bytesToRead]);
+            this.OnRead(bytesRead, bytesToRead);
+        }
+
+        /// <summary>
+        /// Asynchronous version of <see cref="ExtendBuffer(int)"/>. Requires the reader be opened for overlapped IO.
+        /// </summary>
+        public async Task ExtendBufferAsync(int bytesToRead)
+        {
+            if (this.overlapped == false)
+            {
+                throw new NotSupportedException($"{nameof(this.ExtendBufferAsync)}() requires the file be opened for overlapped IO.");
+            }
+
+            Memory<byte> destination = this.buffer.GetWritableMemory(bytesToRead, Constant.Images.UnbufferedReadSegmentSize);
+            int bytesRead = await RandomAccess.ReadAsync(this.file, destination[..bytesToRead], this.filePosition).ConfigureAwait(false);
+            this.OnRead(bytesRead, bytesToRead);
+        }
+
+        /// <summary>
+        /// Read the rest of the file and return the whole file as a single array segment. The segment is valid until the reader
+        /// is disposed.
+        /// </summary>
+        public ArraySegment<byte> ExtendBufferToEndOfFile()
         {
-            if (this.Buffer == null)
+            // move what's been read so far into an array which can hold the whole file and then read the rest of the file into it
+            // The read's rounded up to whole sectors as unbuffered IO requires, so the array's sized to hold the rounded read.
+            int bytesRemaining = (int)(this.Length - this.filePosition);
+            if (bytesRemaining > 0)
             {
-                throw new NotSupportedException(App.FormatResource(Constant.ResourceKey.UnbufferedSequentialReaderExtendBuffer, nameof(this.ExtendBuffer), nameof(this.GetByte)));
+                int bytesToRead = this.RoundUpToSectors(bytesRemaining);
+                this.buffer.EnsureContiguousCapacity(this.buffer.Length + bytesToRead);
+                Memory<byte> destination = this.buffer.GetWritableMemory(bytesToRead, Constant.Images.UnbufferedReadSegmentSize);
+                int bytesRead = this.Read(destination.Span[..bytesToRead]);
+                this.OnRead(bytesRead, bytesRemaining);
             }
-            if (this.bufferPosition >= this.Buffer.Length)
+            else
             {
-                // caller only requested one more byte but unbuffered IO requires at least a sector be read
-                // This case is therefore reasonably robust against repeated calls to GetByte().  If needed for performance, multiple
-                // sectors could be read instead of one.
-                this.ExtendBuffer(this.GetSectorSize());
+                this.buffer.EnsureContiguousCapacity(this.buffer.Length);
             }
-            return this.Buffer[this.bufferPosition++];
+            return this.buffer.GetContiguous(0, this.buffer.Length);
+        }
+
+        /// <summary>
+        /// Get a byte which has already been read, without changing the reader's position.
+        /// </summary>
+        public byte GetBufferedByte(int position)
+        {
+            return this.buffer[position];
+        }
+
+        public override byte GetByte()
+        {
+            this.EnsureBuffered(1, nameof(this.GetByte));
+            return this.buffer[this.bufferPosition++];
         }
 
         public override void GetBytes(byte[] buffer, int offset, int count)
@@ -133,27 +177,46 @@ namespace Carnassial.Interop
 
         public override void GetBytes(Span<byte> bytes)
         {
-            if (this.Buffer == null)
+            this.EnsureBuffered(bytes.Length, nameof(this.GetBytes));
+            this.buffer.CopyTo(this.bufferPosition, bytes);
+            this.bufferPosition += bytes.Length;
+        }
+
+        /// <summary>
+        /// Get a range of bytes which have already been read as a single array segment, copying them if needed. The segment is
+        /// valid until the next call to this method or until the reader is disposed.
+        /// </summary>
+        public ArraySegment<byte> GetContiguousBytes(int position, int count)
+        {
+            return this.buffer.GetContiguous(position, count);
+        }
+
+        private void EnsureBuffered(int count, string caller)
+        {
+            if (this.buffer.Length == 0)
             {
-                throw new NotSupportedException(App.FormatResource(Constant.ResourceKey.UnbufferedSequentialReaderExtendBuffer, nameof(this.ExtendBuffer), nameof(this.GetBytes)));
+                throw new NotSupportedException(App.FormatResource(Constant.ResourceKey.UnbufferedSequentialReaderExtendBuffer, nameof(this.ExtendBuffer), caller));
             }
 
-            int count = bytes.Length;
             int endPosition = this.bufferPosition + count;
-            if (endPosition > this.Buffer.Length)
+            if (endPosition > this.buffer.Length)
             {
-                int minimumBytesRequired = endPosition - this.Buffer.Length;
-                int bytesToRead = minimumBytesRequired;
-                int sectorSize = this.GetSectorSize();
-                if (minimumBytesRequired % sectorSize != 0)
+                // caller only requested what it needs to parse the next part of the file but unbuffered IO requires whole sectors
+                // be read
+                // Reading ahead a segment's worth keeps parsing of large metadata segments from issuing a read per sector. Since
+                // appending to the buffer doesn't copy what's already been read the cost of reading ahead is just the read.
+                int minimumBytesRequired = endPosition - this.buffer.Length;
+                int bytesRemaining = (int)(this.Length - this.filePosition);
+                if (minimumBytesRequired > bytesRemaining)
                 {
-                    bytesToRead = sectorSize * (minimumBytesRequired / sectorSize + 1);
+                    throw new EndOfStreamException(App.FindResource<string>(Constant.ResourceKey.UnbufferedSequentialReaderEndOfFile));
                 }
-                this.ExtendBuffer(bytesToRead);
+                int bytesToBuffer = Math.Min(Math.Max(minimumBytesRequired, Constant.Images.UnbufferedReadAheadSize), bytesRemaining);
+                int bytesToRead = this.RoundUpToSectors(bytesToBuffer);
+                Memory<byte> destination = this.buffer.GetWritableMemory(bytesToRead, Constant.Images.UnbufferedReadSegmentSize);
+                int bytesRead = this.Read(destination.Span[..bytesToRead]);
+                this.OnRead(bytesRead, bytesToBuffer);
             }
-
-            this.Buffer[this.bufferPosition..endPosition].CopyTo(bytes);
-            this.bufferPosition += count;
         }
 
         private int GetSectorSize()
@@ -171,12 +234,30 @@ namespace Carnassial.Interop
             return sectorSize;
         }
 
-        private unsafe int Read(byte[] buffer, long offset, int bytesToRead)
+        private void OnRead(int bytesRead, int bytesRequired)
+        {
+            // reads at the end of the file return fewer bytes than requested when the file's length isn't a whole number of
+            // sectors
+            if (bytesRead < bytesRequired)
+            {
+                throw new IOException($"Only {bytesRead} instead of {bytesRequired} bytes were read.");
+            }
+            this.buffer.Advance(bytesRead);
+            this.filePosition += bytesRead;
+        }
+
+        private unsafe int Read(Span<byte> destination)
         {
-            fixed (byte* bufferPin = &buffer[offset])
+            if (this.overlapped)
+            {
+                // ReadFile() requires an OVERLAPPED on handles opened for overlapped IO; RandomAccess supplies one and waits
+                return RandomAccess.Read(this.file, destination, this.filePosition);
+            }
+
+            fixed (byte* bufferPin = destination)
             {
                 int bytesRead = 0;
-                int result = NativeMethods.ReadFile(this.file, bufferPin, bytesToRead, ref bytesRead, null);
+                int result = NativeMethods.ReadFile(this.file, bufferPin, destination.Length, ref bytesRead, null);
                 if (result == 0)
                 {
                     throw new Win32Exception(Marshal.GetLastWin32Error());
@@ -185,6 +266,12 @@ namespace Carnassial.Interop
             }
         }
 
+        private int RoundUpToSectors(int bytes)
+        {
+            int sectorSize = this.GetSectorSize();
+            return sectorSize * ((bytes + sectorSize - 1) / sectorSize);
+        }
+
         public override void Skip(long bytes)
         {
             if (bytes < 0)
@@ -192,9 +279,9 @@ namespace Carnassial.Interop
                 throw new ArgumentOutOfRangeException(nameof(bytes), App.FormatResource(Constant.ResourceKey.UnbufferedSequentialReaderBytesRequired, nameof(bytes)));
             }
 
-            Debug.Assert(this.Buffer != null);
+            Debug.Assert(this.buffer.Length > 0);
             int newPosition = this.bufferPosition + (int)bytes;
-            if (newPosition > this.Buffer.Length)
+            if (newPosition > this.buffer.Length)
             {
                 throw new EndOfStreamException(App.FindResource<string>(Constant.ResourceKey.UnbufferedSequentialReaderEndOfFile));
             }
@@ -203,9 +290,9 @@ namespace Carnassial.Interop
 
         public override bool TrySkip(long bytes)
         {
-            Debug.Assert(this.Buffer != null);
+            Debug.Assert(this.buffer.Length > 0);
             int newPosition = this.bufferPosition + (int)bytes;
-            if ((bytes < 0) || (newPosition > this.Buffer.Length))
+            if ((bytes < 0) || (newPosition > this.buffer.Length))
             {
                 return false;
             }
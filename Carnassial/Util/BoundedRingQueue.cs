@@ -0,0 +1,140 @@
+﻿using System;
+using System.Diagnostics.CodeAnalysis;
+using System.Numerics;
+using System.Threading;
+
+namespace Carnassial.Util
+{
+    /// <summary>
+    /// Fixed capacity first in, first out queue which any number of threads may enqueue to and dequeue from without locking.
+    /// </summary>
+    /// <remarks>
+    /// Each slot in the ring carries a sequence number indicating whether it's free for the enqueue at a given position or holds
+    /// the item for the dequeue at that position. Enqueuers and dequeuers claim positions with a compare exchange on the tail or
+    /// head and then publish the slot by advancing its sequence number, so a thread never waits on a lock held by a descheduled
+    /// thread and, unlike <see cref="System.Collections.Concurrent.ConcurrentQueue{T}"/>, the queue never allocates after
+    /// construction. When the queue's full <see cref="TryEnqueue(TItem)"/> returns false rather than growing, which gives callers
+    /// a point at which to apply backpressure. Head and tail are padded onto separate cache lines so enqueuers and dequeuers
+    /// don't false share.
+    /// </remarks>
+    public class BoundedRingQueue<TItem>
+    {
+        private PaddedQueuePositions positions;
+        private readonly int positionMask;
+        private readonly Slot[] slots;
+
+        /// <param name="capacity">Minimum number of items the queue can hold. Rounded up to a power of two.</param>
+        public BoundedRingQueue(int capacity)
+        {
+            ArgumentOutOfRangeException.ThrowIfLessThan(capacity, 2);
+            ArgumentOutOfRangeException.ThrowIfGreaterThan(capacity, 1 << 30);
+
+            int slotCount = (int)BitOperations.RoundUpToPowerOf2((uint)capacity);
+            this.positionMask = slotCount - 1;
+            this.positions = default;
+            this.slots = new Slot[slotCount];
+            for (int slot = 0; slot < slotCount; ++slot)
+            {
+                this.slots[slot].Sequence = slot;
+            }
+        }
+
+        public int Capacity
+        {
+            get { return this.slots.Length; }
+        }
+
+        /// <summary>
+        /// Approximate number of items in the queue. Exact only when no other thread is enqueuing or dequeuing.
+        /// </summary>
+        public int Count
+        {
+            get
+            {
+                int count = Volatile.Read(ref this.positions.Tail) - Volatile.Read(ref this.positions.Head);
+                return Math.Clamp(count, 0, this.slots.Length);
+            }
+        }
+
+        public bool TryDequeue([MaybeNullWhen(false)] out TItem item)
+        {
+            SpinWait spinWait = new();
+            int position = Volatile.Read(ref this.positions.Head);
+            while (true)
+            {
+                ref Slot slot = ref this.slots[position & this.positionMask];
+                int sequence = Volatile.Read(ref slot.Sequence);
+                int lag = sequence - (position + 1);
+                if (lag == 0)
+                {
+                    // slot holds the item for this position; claim it
+                    int observedPosition = Interlocked.CompareExchange(ref this.positions.Head, position + 1, position);
+                    if (observedPosition == position)
+                    {
+                        item = slot.Item;
+                        slot.Item = default!;
+                        // free the slot for the enqueue one lap ahead
+                        Volatile.Write(ref slot.Sequence, position + this.slots.Length);
+                        return true;
+                    }
+                    position = observedPosition;
+                }
+                else if (lag < 0)
+                {
+                    // slot's item for this position hasn't been enqueued, so the queue's empty
+                    // An enqueuer which has claimed the slot but not yet published it is treated as not yet having enqueued.
+                    item = default;
+                    return false;
+                }
+                else
+                {
+                    // another dequeuer claimed this position; retry at the current head
+                    spinWait.SpinOnce(sleep1Threshold: -1);
+                    position = Volatile.Read(ref this.positions.Head);
+                }
+            }
+        }
+
+        public bool TryEnqueue(TItem item)
+        {
+            SpinWait spinWait = new();
+            int position = Volatile.Read(ref this.positions.Tail);
+            while (true)
+            {
+                ref Slot slot = ref this.slots[position & this.positionMask];
+                int sequence = Volatile.Read(ref slot.Sequence);
+                int lag = sequence - position;
+                if (lag == 0)
+                {
+                    // slot is free for this position; claim it
+                    int observedPosition = Interlocked.CompareExchange(ref this.positions.Tail, position + 1, position);
+                    if (observedPosition == position)
+                    {
+                        slot.Item = item;
+                        // publish the item to the dequeue at this position
+                        Volatile.Write(ref slot.Sequence, position + 1);
+                        return true;
+                    }
+                    position = observedPosition;
+                }
+                else if (lag < 0)
+                {
+                    // slot still holds the item from the previous lap, so the queue's full
+                    return false;
+                }
+                else
+                {
+                    // another enqueuer claimed this position; retry at the current tail
+                    spinWait.SpinOnce(sleep1Threshold: -1);
+                    position = Volatile.Read(ref this.positions.Tail);
+                }
+            }
+        }
+
+        private struct Slot
+        {
+            public TItem Item;
+            public int Sequence;
+        }
+    }
+}
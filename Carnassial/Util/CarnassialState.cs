@@ -27,6 +27,7 @@ namespace Carnassial.Util
         public Int16 MouseHorizontalScrollDelta { get; set; }
         public string? MouseOverCounter { get; set; }
         public List<DataEntryNote> NoteControlsWithNewValues { get; private init; }
+
         public UndoRedoChain<CarnassialWindow> UndoRedoChain { get; private init; }
 
         public CarnassialState()
@@ -0,0 +1,210 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Diagnostics.CodeAnalysis;
+
+namespace Carnassial.Util
+{
+    /// <summary>
+    /// A cache bounded by the total size of its values. When full it evicts the values least worth keeping given how costly they
+    /// are to recreate, how large they are, and how often they've been used.
+    /// </summary>
+    /// <remarks>
+    /// Implements greedy dual size frequency (GDSF) replacement. A value's priority is the cache's inflation value when the value
+    /// was last used plus its use count times its cost per byte. The lowest priority value is evicted first and the inflation
+    /// value rises to its priority, so values which haven't been used recently age out even if they're expensive or were used
+    /// often. With uniform costs and sizes GDSF reduces to least recently used replacement.
+    ///
+    /// All members are thread safe.
+    /// </remarks>
+    public class GreedyDualSizeFrequencyCache<TKey, TValue> where TKey : notnull
+    {
+        private readonly Dictionary<TKey, Entry> entriesByKey;
+        private readonly SortedSet<Entry> entriesByPriority;
+        private double inflation;
+        private long nextSequence;
+
+        public long CapacityInBytes { get; private init; }
+        public long Hits { get; private set; }
+        public long Misses { get; private set; }
+        public long SizeInBytes { get; private set; }
+
+        public GreedyDualSizeFrequencyCache(long capacityInBytes)
+        {
+            ArgumentOutOfRangeException.ThrowIfLessThan(capacityInBytes, 1);
+
+            this.CapacityInBytes = capacityInBytes;
+            this.entriesByKey = [];
+            this.entriesByPriority = [];
+            this.Hits = 0;
+            this.inflation = 0.0;
+            this.Misses = 0;
+            this.nextSequence = 0;
+            this.SizeInBytes = 0;
+        }
+
+        /// <summary>
+        /// Remove all values, such as when a change in how values are calculated makes them stale. Hit and miss counts are kept.
+        /// </summary>
+        public void Clear()
+        {
+            lock (this.entriesByKey)
+            {
+                this.entriesByKey.Clear();
+                this.entriesByPriority.Clear();
+                this.inflation = 0.0;
+                this.SizeInBytes = 0;
+            }
+        }
+
+        public int Count
+        {
+            get
+            {
+                lock (this.entriesByKey)
+                {
+                    return this.entriesByKey.Count;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Add a value to the cache or replace the value already cached for the key, evicting other values as needed to make
+        /// room. A replaced value keeps its use count.
+        /// </summary>
+        /// <param name="cost">Cost of recreating the value if it's evicted, in any unit which is consistent across values.</param>
+        /// <returns>false if the value's larger than the cache and so wasn't cached.</returns>
+        public bool AddOrUpdate(TKey key, TValue value, long sizeInBytes, double cost)
+        {
+            Debug.Assert(sizeInBytes > 0, "Values must have a positive size.");
+            Debug.Assert(cost >= 0.0, "Values can't have negative cost.");
+
+            lock (this.entriesByKey)
+            {
+                int frequency = 1;
+                if (this.entriesByKey.TryGetValue(key, out Entry? existingEntry))
+                {
+                    frequency += existingEntry.Frequency;
+                    this.Remove(existingEntry);
+                }
+                if (sizeInBytes > this.CapacityInBytes)
+                {
+                    return false;
+                }
+
+                while (this.SizeInBytes + sizeInBytes > this.CapacityInBytes)
+                {
+                    Entry leastValuable = this.entriesByPriority.Min!;
+                    this.inflation = leastValuable.Priority;
+                    this.Remove(leastValuable);
+                }
+
+                Entry entry = new(key, value, sizeInBytes, cost)
+                {
+                    Frequency = frequency
+                };
+                this.Prioritize(entry);
+                this.entriesByKey.Add(key, entry);
+                this.SizeInBytes += sizeInBytes;
+                return true;
+            }
+        }
+
+        /// <summary>
+        /// Check if a value's cached without counting a hit or a miss or changing the value's priority.
+        /// </summary>
+        public bool ContainsKey(TKey key)
+        {
+            lock (this.entriesByKey)
+            {
+                return this.entriesByKey.ContainsKey(key);
+            }
+        }
+
+        private void Prioritize(Entry entry)
+        {
+            entry.Priority = this.inflation + entry.Frequency * entry.Cost / entry.SizeInBytes;
+            entry.Sequence = this.nextSequence++;
+            this.entriesByPriority.Add(entry);
+        }
+
+        private void Remove(Entry entry)
+        {
+            this.entriesByKey.Remove(entry.Key);
+            this.entriesByPriority.Remove(entry);
+            this.SizeInBytes -= entry.SizeInBytes;
+        }
+
+        public bool TryGetValue(TKey key, [MaybeNullWhen(false)] out TValue value)
+        {
+            lock (this.entriesByKey)
+            {
+                if (this.entriesByKey.TryGetValue(key, out Entry? entry) == false)
+                {
+                    ++this.Misses;
+                    value = default;
+                    return false;
+                }
+
+                // a use raises the value's priority both by its frequency and to the current inflation value
+                ++this.Hits;
+                this.entriesByPriority.Remove(entry);
+                ++entry.Frequency;
+                this.Prioritize(entry);
+                value = entry.Value;
+                return true;
+            }
+        }
+
+        public bool TryRemove(TKey key)
+        {
+            lock (this.entriesByKey)
+            {
+                if (this.entriesByKey.TryGetValue(key, out Entry? entry) == false)
+                {
+                    return false;
+                }
+                this.Remove(entry);
+                return true;
+            }
+        }
+
+        private class Entry : IComparable<Entry>
+        {
+            public double Cost { get; private init; }
+            public int Frequency { get; set; }
+            public TKey Key { get; private init; }
+            public double Priority { get; set; }
+            // breaks ties between equal priorities so entries are unique within the sorted set
+            public long Sequence { get; set; }
+            public long SizeInBytes { get; private init; }
+            public TValue Value { get; private init; }
+
+            public Entry(TKey key, TValue value, long sizeInBytes, double cost)
+            {
+                this.Cost = cost;
+                this.Frequency = 1;
+                this.Key = key;
+                this.Priority = 0.0;
+                this.Sequence = 0;
+                this.SizeInBytes = sizeInBytes;
+                this.Value = value;
+            }
+
+            public int CompareTo(Entry? other)
+            {
+                if (other == null)
+                {
+                    return 1;
+                }
+
+                int priorityComparison = this.Priority.CompareTo(other.Priority);
+                if (priorityComparison != 0)
+                {
+                    return priorityComparison;
+                }
+                return this.Sequence.CompareTo(other.Sequence);
+            }
+        }
+    }
+}
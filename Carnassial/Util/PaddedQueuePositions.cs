@@ -0,0 +1,23 @@
+﻿using System.Runtime.InteropServices;
+
+namespace Carnassial.Util
+{
+    /// <summary>
+    /// Head and tail positions of a lock free queue, each on its own cache line so threads updating one don't invalidate the
+    /// other's line.
+    /// </summary>
+    /// <remarks>
+    /// Not nested in <see cref="BoundedRingQueue{TItem}"/> as the runtime doesn't allow explicit layout of generic types.
+    /// </remarks>
+    [StructLayout(LayoutKind.Explicit, Size = 3 * PaddedQueuePositions.CacheLineSizeInBytes)]
+    internal struct PaddedQueuePositions
+    {
+        // 128 bytes rather than 64 as adjacent line prefetch on Intel processors pulls in cache lines in pairs
+        private const int CacheLineSizeInBytes = 128;
+
+        [FieldOffset(PaddedQueuePositions.CacheLineSizeInBytes)]
+        public int Head;
+        [FieldOffset(2 * PaddedQueuePositions.CacheLineSizeInBytes)]
+        public int Tail;
+    }
+}
@@ -0,0 +1,190 @@
+﻿using System;
+using System.Diagnostics.CodeAnalysis;
+using System.Threading;
+
+namespace Carnassial.Util
+{
+    /// <summary>
+    /// Hands work items from any number of producers to a fixed set of consumers. Each consumer has its own queue and steals from
+    /// other consumers' queues when its own is empty.
+    /// </summary>
+    /// <remarks>
+    /// Consumers block on a semaphore when no items are available rather than polling, so they wake as soon as an item is added
+    /// and consume no CPU while producers are behind. Items are distributed round robin across consumer queues so consumers
+    /// rarely contend on the same queue. Stealing, when a consumer's own queue is empty, keeps all consumers busy when items
+    /// take varying time to process. Queues are FIFO so items are processed in approximately the order they're added.
+    ///
+    /// Queues are bounded, lock free rings. Producers block once the scheduler holds as many items as its queues' combined
+    /// capacity, so producers which outpace consumers can't run arbitrarily far ahead of them, and both producers and consumers
+    /// are released by <see cref="Cancel"/> if either side needs to exit early.
+    /// </remarks>
+    public class WorkStealingScheduler<TItem> : IDisposable
+    {
+        private int addingCompleted;
+        private readonly SemaphoreSlim available;
+        private readonly CancellationTokenSource cancellation;
+        private bool disposed;
+        private int nextQueue;
+        private readonly BoundedRingQueue<TItem>[] queuesByConsumer;
+        private readonly SemaphoreSlim space;
+
+        public WorkStealingScheduler(int consumers, int capacityPerConsumer)
+        {
+            ArgumentOutOfRangeException.ThrowIfLessThan(consumers, 1);
+
+            this.addingCompleted = 0;
+            this.available = new(0);
+            this.cancellation = new();
+            this.disposed = false;
+            this.nextQueue = -1;
+            this.queuesByConsumer = new BoundedRingQueue<TItem>[consumers];
+            for (int consumer = 0; consumer < consumers; ++consumer)
+            {
+                this.queuesByConsumer[consumer] = new(capacityPerConsumer);
+            }
+            this.space = new(consumers * this.queuesByConsumer[0].Capacity);
+        }
+
+        public bool IsAddingCompleted
+        {
+            get { return Volatile.Read(ref this.addingCompleted) != 0; }
+        }
+
+        public bool IsCancelled
+        {
+            get { return this.cancellation.IsCancellationRequested; }
+        }
+
+        /// <summary>
+        /// Add an item for the consumers, blocking while the scheduler is full. Items added after <see cref="CompleteAdding"/> are
+        /// taken only if consumers are still active.
+        /// </summary>
+        /// <returns>false if the scheduler was cancelled before the item could be added.</returns>
+        public bool Add(TItem item)
+        {
+            try
+            {
+                this.space.Wait(this.cancellation.Token);
+            }
+            catch (OperationCanceledException)
+            {
+                return false;
+            }
+
+            // the space semaphore guarantees one of the queues has a free slot but the queue chosen may be full, in which case the
+            // next queue is tried
+            // A queue can also briefly appear full while a consumer which has dequeued from it is still freeing its slot.
+            int queue = (int)((uint)Interlocked.Increment(ref this.nextQueue) % (uint)this.queuesByConsumer.Length);
+            SpinWait spinWait = new();
+            while (this.queuesByConsumer[queue].TryEnqueue(item) == false)
+            {
+                queue = (queue + 1) % this.queuesByConsumer.Length;
+                spinWait.SpinOnce(sleep1Threshold: -1);
+            }
+            this.available.Release();
+            return true;
+        }
+
+        /// <summary>
+        /// Release all blocked producers and consumers. Subsequent calls to <see cref="Add(TItem)"/> and
+        /// <see cref="TryTake(int, out TItem)"/> return false. Safe to call more than once.
+        /// </summary>
+        public void Cancel()
+        {
+            this.cancellation.Cancel();
+        }
+
+        /// <summary>
+        /// Indicate no more items will be added. Consumers take any remaining items and then <see cref="TryTake(int, out TItem)"/>
+        /// returns false. Safe to call more than once.
+        /// </summary>
+        public void CompleteAdding()
+        {
+            if (Interlocked.Exchange(ref this.addingCompleted, 1) == 0)
+            {
+                // wake one waiting consumer; each consumer which finds the scheduler empty passes the wake on to the next
+                this.available.Release();
+            }
+        }
+
+        public void Dispose()
+        {
+            this.Dispose(true);
+            GC.SuppressFinalize(this);
+        }
+
+        protected virtual void Dispose(bool disposing)
+        {
+            if (this.disposed)
+            {
+                return;
+            }
+
+            if (disposing)
+            {
+                this.available.Dispose();
+                this.cancellation.Dispose();
+                this.space.Dispose();
+            }
+
+            this.disposed = true;
+        }
+
+        /// <summary>
+        /// Take the next item for a consumer, blocking until an item is available, adding is completed, or the scheduler is
+        /// cancelled.
+        /// </summary>
+        /// <returns>false if adding is completed and all items have been taken or if the scheduler is cancelled.</returns>
+        public bool TryTake(int consumer, [MaybeNullWhen(false)] out TItem item)
+        {
+            try
+            {
+                this.available.Wait(this.cancellation.Token);
+            }
+            catch (OperationCanceledException)
+            {
+                item = default;
+                return false;
+            }
+
+            // the semaphore's count tracks items added, so an item is available unless adding has completed
+            // A scan can still miss, though, if other consumers take items from queues as they're scanned, in which case the
+            // scan repeats. Completion must be checked before the queues are scanned as, once adding is completed, a queue found
+            // empty stays empty.
+            SpinWait spinWait = new();
+            while (true)
+            {
+                bool addingCompleted = this.IsAddingCompleted;
+                if (this.TryTakeOrSteal(consumer, out item))
+                {
+                    this.space.Release();
+                    return true;
+                }
+                if (addingCompleted || this.IsCancelled)
+                {
+                    this.available.Release();
+                    return false;
+                }
+                spinWait.SpinOnce();
+            }
+        }
+
+        private bool TryTakeOrSteal(int consumer, [MaybeNullWhen(false)] out TItem item)
+        {
+            if (this.queuesByConsumer[consumer].TryDequeue(out item))
+            {
+                return true;
+            }
+
+            for (int offset = 1; offset < this.queuesByConsumer.Length; ++offset)
+            {
+                int victim = (consumer + offset) % this.queuesByConsumer.Length;
+                if (this.queuesByConsumer[victim].TryDequeue(out item))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+}
@@ -31,6 +31,60 @@ namespace Carnassial
 			this->TryDecode(jpeg, offset, length, requestedWidth);
 		}
 
+		/// <summary>
+		/// Decode a region of a jpeg at 1/scaleDenominator scale. The region's in scaled pixels and its left edge must fall on a
+		/// scaled MCU boundary, which is always the case for regions starting at multiples of 32 pixels.
+		/// </summary>
+		/// <remarks>
+		/// Rows above the region still need to be entropy decoded but aren't transformed or color converted and columns outside of
+		/// the region are skipped, so decoding a region is much cheaper than decoding the whole image.
+		/// </remarks>
+		MemoryImageCppCli::MemoryImageCppCli(array<unsigned __int8>^ jpeg, int scaleDenominator, Int32Rect region)
+		{
+			// check for an empty jpeg before creating the decompressor as pinning an empty array's first element throws
+			if (jpeg->Length < 1)
+			{
+				throw gcnew ArgumentException("Jpeg is empty.", "jpeg");
+			}
+
+			tjhandle decompressor = tj3Init(TJINIT_DECOMPRESS);
+			pin_ptr<byte> jpegBytes = &jpeg[0];
+			int result = tj3DecompressHeader(decompressor, jpegBytes, jpeg->Length);
+			if (result != 0)
+			{
+				String^ message = gcnew String(tj3GetErrorStr(decompressor));
+				tj3Destroy(decompressor);
+				throw gcnew ArgumentException(message, "jpeg");
+			}
+
+			int bitsPerSample = tj3Get(decompressor, TJPARAM_PRECISION);
+			if (bitsPerSample != 8)
+			{
+				tj3Destroy(decompressor);
+				throw gcnew NotSupportedException("Unhandled bit depth of " + bitsPerSample + ".");
+			}
+
+			tjscalingfactor scalingFactor = { 1, scaleDenominator };
+			tjregion croppingRegion = { region.X, region.Y, region.Width, region.Height };
+			if ((tj3SetScalingFactor(decompressor, scalingFactor) != 0) || (tj3SetCroppingRegion(decompressor, croppingRegion) != 0))
+			{
+				String^ message = gcnew String(tj3GetErrorStr(decompressor));
+				tj3Destroy(decompressor);
+				throw gcnew ArgumentOutOfRangeException("region", message);
+			}
+
+			this->format = PixelFormats::Pbgra32; // MemoryImageCppCli::PreferredTurboJpegPixelFormat;
+			this->pixelHeight = region.Height;
+			this->pixelSizeInBytes = tjPixelSize[MemoryImageCppCli::PreferredTurboJpegPixelFormat];
+			this->pixelWidth = region.Width;
+			this->AllocatePixels();
+
+			pin_ptr<unsigned __int8> pinnedPixels = &this->pixels[0];
+			result = tj3Decompress8(decompressor, jpegBytes, jpeg->Length, pinnedPixels, this->PitchInBytes, MemoryImageCppCli::PreferredTurboJpegPixelFormat);
+			tj3Destroy(decompressor);
+			this->decompressionError = result != 0;
+		}
+
 		MemoryImageCppCli::MemoryImageCppCli(int width, int height, PixelFormat format)
 		{
 			this->decompressionError = false;
@@ -182,5 +236,23 @@ namespace Carnassial
 
 			return true;
 		}
+
+		bool MemoryImageCppCli::TryGetJpegSize(array<unsigned __int8>^ jpeg, [Out] int% width, [Out] int% height)
+		{
+			if (jpeg->Length == 0)
+			{
+				width = 0;
+				height = 0;
+				return false;
+			}
+
+			tjhandle decompressor = tj3Init(TJINIT_DECOMPRESS);
+			pin_ptr<byte> jpegBytes = &jpeg[0];
+			int result = tj3DecompressHeader(decompressor, jpegBytes, jpeg->Length);
+			width = result == 0 ? tj3Get(decompressor, TJPARAM_JPEGWIDTH) : 0;
+			height = result == 0 ? tj3Get(decompressor, TJPARAM_JPEGHEIGHT) : 0;
+			tj3Destroy(decompressor);
+			return result == 0;
+		}
 	}
 }
\ No newline at end of file
@@ -46,6 +46,7 @@ namespace Carnassial
 			MemoryImageCppCli(BitmapSource^ bitmap);
 			MemoryImageCppCli(array<unsigned __int8>^ jpeg, Nullable<int>^ requestedWidth);
 			MemoryImageCppCli(array<unsigned __int8>^ jpeg, int offset, int length, Nullable<int>^ requestedWidth);
+			MemoryImageCppCli(array<unsigned __int8>^ jpeg, int scaleDenominator, System::Windows::Int32Rect region);
 			MemoryImageCppCli(int width, int height, PixelFormat format);
 
 			property array<byte>^ Pixels
@@ -95,6 +96,11 @@ namespace Carnassial
 			}
 
 			bool TryDecode(array<unsigned __int8>^ jpegFileBytes, int offsetInBytes, int lengthInBytes, Nullable<int>^ requestedImageWidth);
+
+			/// <summary>
+			/// Read a jpeg's full resolution size from its header without decoding it.
+			/// </summary>
+			static bool TryGetJpegSize(array<unsigned __int8>^ jpeg, [Out] int% width, [Out] int% height);
 		};
 	}
 }
\ No newline at end of file
@@ -13,42 +13,112 @@ namespace Carnassial
 		[SuppressMessage("Microsoft.Design", "CA1065")]
 		static Processor::Processor()
 		{
-			// find number of physical cores
-			__int32 informationFields = 32;
-			PSYSTEM_LOGICAL_PROCESSOR_INFORMATION processorInformation = new SYSTEM_LOGICAL_PROCESSOR_INFORMATION[informationFields];
-			DWORD length = informationFields * sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
-			bool success = GetLogicalProcessorInformation(processorInformation, &length);
-			if (success == false)
+			// size processor information buffer
+			// Unlike GetLogicalProcessorInformation(), which returns one fixed size record per cache and core, the extended
+			// records are variable length so the buffer size can't be guessed in advance.
+			DWORD length = 0;
+			if ((GetLogicalProcessorInformationEx(LOGICAL_PROCESSOR_RELATIONSHIP::RelationAll, nullptr, &length) == FALSE) &&
+				(GetLastError() != ERROR_INSUFFICIENT_BUFFER))
+			{
+				throw gcnew Win32Exception(GetLastError());
+			}
+			unsigned __int8* processorInformation = new unsigned __int8[length];
+			if (GetLogicalProcessorInformationEx(LOGICAL_PROCESSOR_RELATIONSHIP::RelationAll, reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(processorInformation), &length) == FALSE)
 			{
 				DWORD error = GetLastError();
-				if (error == ERROR_INSUFFICIENT_BUFFER)
+				delete[] processorInformation;
+				throw gcnew Win32Exception(error);
+			}
+
+			// count cores and logical processors and find the first of the highest performance cores
+			// Efficiency classes are zero on processors which aren't hybrid. On hybrid processors higher classes are higher
+			// performance cores.
+			unsigned __int8 performanceEfficiencyClass = 0;
+			GROUP_AFFINITY performanceCore = {};
+			for (DWORD offset = 0; offset < length; )
+			{
+				PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX record = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(processorInformation + offset);
+				if (record->Relationship == LOGICAL_PROCESSOR_RELATIONSHIP::RelationProcessorCore)
 				{
-					delete[] processorInformation;
-					informationFields = length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
-					processorInformation = new SYSTEM_LOGICAL_PROCESSOR_INFORMATION[informationFields];
-					length = informationFields * sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
-					success = GetLogicalProcessorInformation(processorInformation, &length);
-					if (success == false)
+					++Processor::CoreCount;
+					Processor::LogicalProcessorCount += Processor::CountLogicalProcessors(record->Processor.GroupCount, record->Processor.GroupMask);
+					if ((Processor::CoreCount == 1) || (record->Processor.EfficiencyClass > performanceEfficiencyClass))
 					{
-						throw gcnew Win32Exception(GetLastError());
+						performanceEfficiencyClass = record->Processor.EfficiencyClass;
+						performanceCore = record->Processor.GroupMask[0];
 					}
 				}
-				else
+				offset += record->Size;
+			}
+
+			// count efficiency cores and find the caches serving the first performance core
+			for (DWORD offset = 0; offset < length; )
+			{
+				PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX record = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(processorInformation + offset);
+				if (record->Relationship == LOGICAL_PROCESSOR_RELATIONSHIP::RelationProcessorCore)
 				{
-					throw gcnew Win32Exception(GetLastError());
+					if (record->Processor.EfficiencyClass < performanceEfficiencyClass)
+					{
+						++Processor::EfficiencyCoreCount;
+					}
 				}
+				else if (record->Relationship == LOGICAL_PROCESSOR_RELATIONSHIP::RelationCache)
+				{
+					// GroupCount is zero prior to Windows 11, in which case the cache's single GroupMask is valid
+					CACHE_RELATIONSHIP cache = record->Cache;
+					unsigned __int16 groupCount = cache.GroupCount > 0 ? cache.GroupCount : 1;
+					if ((cache.Type != PROCESSOR_CACHE_TYPE::CacheInstruction) && (cache.Type != PROCESSOR_CACHE_TYPE::CacheTrace) &&
+						Processor::Overlaps(groupCount, record->Cache.GroupMasks, performanceCore))
+					{
+						__int32 sharedBy = Processor::CountLogicalProcessors(groupCount, record->Cache.GroupMasks);
+						switch (cache.Level)
+						{
+						case 1:
+							Processor::L1DataCacheSize = cache.CacheSize;
+							Processor::LineSize = cache.LineSize;
+							break;
+						case 2:
+							Processor::L2CacheShare = sharedBy;
+							Processor::L2CacheSize = cache.CacheSize;
+							break;
+						case 3:
+							Processor::L3CacheShare = sharedBy;
+							Processor::L3CacheSize = cache.CacheSize;
+							break;
+						default:
+							// L4s, such as eDRAM on some Broadwell and Skylake parts, don't affect sizing
+							break;
+						}
+					}
+				}
+				offset += record->Size;
 			}
-			informationFields = length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
+			delete[] processorInformation;
+		}
 
-			for (__int32 fieldIndex = 0; fieldIndex < informationFields; ++fieldIndex)
+		__int32 Processor::CountLogicalProcessors(unsigned __int16 groupCount, GROUP_AFFINITY* groupMasks)
+		{
+			__int32 logicalProcessors = 0;
+			for (unsigned __int16 group = 0; group < groupCount; ++group)
 			{
-				SYSTEM_LOGICAL_PROCESSOR_INFORMATION field = processorInformation[fieldIndex];
-				if (field.Relationship == LOGICAL_PROCESSOR_RELATIONSHIP::RelationProcessorCore)
+				for (KAFFINITY mask = groupMasks[group].Mask; mask != 0; mask &= mask - 1)
 				{
-					++Processor::CoreCount;
+					++logicalProcessors;
 				}
 			}
-			delete[] processorInformation;
+			return logicalProcessors;
+		}
+
+		bool Processor::Overlaps(unsigned __int16 groupCount, GROUP_AFFINITY* groupMasks, GROUP_AFFINITY core)
+		{
+			for (unsigned __int16 group = 0; group < groupCount; ++group)
+			{
+				if ((groupMasks[group].Group == core.Group) && ((groupMasks[group].Mask & core.Mask) != 0))
+				{
+					return true;
+				}
+			}
+			return false;
 		}
 	}
 }
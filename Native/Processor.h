@@ -5,20 +5,96 @@ namespace Carnassial
 	namespace Native
 	{
 		/// <summary>
-		/// Small wrapper over GetLogicalProcessorInformation() to obtain the current processor's number of physical cores.
+		/// Small wrapper over GetLogicalProcessorInformationEx() to obtain the current processor's core counts, including performance
+		/// and efficiency cores on hybrid processors, and data cache sizes.
 		/// </summary>
 		/// <remarks>
-		/// This class could easily be implemented from C# with P/Invoke but, given <see cref="MemoryImageCppCli"/> motivates the inclusion 
+		/// This class could easily be implemented from C# with P/Invoke but, given <see cref="MemoryImageCppCli"/> motivates the inclusion
 		/// of a C++/CLI assembly, there's no particular reason not to implement <see cref="Processor"/> in C++/CLI.
+		///
+		/// Cache properties are those of the caches serving the first performance core. On hybrid processors efficiency cores' L2 is
+		/// typically shared by a cluster of four cores, so it's the performance cores' caches which are appropriate for sizing tiles
+		/// and bands of work. Sizes are in bytes and sharing is in logical processors; for example, L2CacheSharedBy is two on
+		/// performance cores with SMT enabled.
 		/// </remarks>
 		public ref class Processor
 		{
 		private:
 			static __int32 CoreCount;
+			static __int32 EfficiencyCoreCount;
+			static __int32 L1DataCacheSize;
+			static __int32 L2CacheShare;
+			static __int32 L2CacheSize;
+			static __int32 L3CacheShare;
+			static __int32 L3CacheSize;
+			static __int32 LineSize;
+			static __int32 LogicalProcessorCount;
 
 			static Processor();
 
+			static __int32 CountLogicalProcessors(unsigned __int16 groupCount, GROUP_AFFINITY* groupMasks);
+			static bool Overlaps(unsigned __int16 groupCount, GROUP_AFFINITY* groupMasks, GROUP_AFFINITY core);
+
 		public:
+			static property __int32 CacheLineSizeInBytes
+			{
+				__int32 get() { return Processor::LineSize; }
+			}
+
+			/// <summary>
+			/// Number of lower performance cores on a hybrid processor. Zero if the processor isn't hybrid.
+			/// </summary>
+			static property __int32 EfficiencyCores
+			{
+				__int32 get() { return Processor::EfficiencyCoreCount; }
+			}
+
+			static property bool IsHybrid
+			{
+				bool get() { return Processor::EfficiencyCoreCount > 0; }
+			}
+
+			static property __int32 L1DataCacheSizeInBytes
+			{
+				__int32 get() { return Processor::L1DataCacheSize; }
+			}
+
+			static property __int32 L2CacheSharedBy
+			{
+				__int32 get() { return Processor::L2CacheShare; }
+			}
+
+			static property __int32 L2CacheSizeInBytes
+			{
+				__int32 get() { return Processor::L2CacheSize; }
+			}
+
+			static property __int32 L3CacheSharedBy
+			{
+				__int32 get() { return Processor::L3CacheShare; }
+			}
+
+			/// <summary>
+			/// Zero if the processor lacks an L3.
+			/// </summary>
+			static property __int32 L3CacheSizeInBytes
+			{
+				__int32 get() { return Processor::L3CacheSize; }
+			}
+
+			static property __int32 LogicalProcessors
+			{
+				__int32 get() { return Processor::LogicalProcessorCount; }
+			}
+
+			/// <summary>
+			/// Number of highest performance cores. Equal to <see cref="PhysicalCores"/> if the processor isn't hybrid.
+			/// </summary>
+			static property __int32 PerformanceCores
+			{
+				__int32 get() { return Processor::CoreCount - Processor::EfficiencyCoreCount; }
+			}
+
 			static property __int32 PhysicalCores
 			{
 				__int32 get() { return Processor::CoreCount; }
@@ -26,4 +102,3 @@ namespace Carnassial
 		};
 	}
 }
-
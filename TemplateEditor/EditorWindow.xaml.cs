@@ -865,6 +865,14 @@ namespace Carnassial.Editor
             }
 
             // if data label is not unique, derive a unique one and notify the user
+            // Image statistics columns are in every file table, so their names are never unique.
+            if (Constant.FileColumn.ImageStatistics.Contains(dataLabel, StringComparer.Ordinal))
+            {
+                MessageBox messageBox = MessageBox.FromResource(EditorConstant.ResourceKey.EditorWindowDataLabelNotUnique, this, textBox.Text);
+                messageBox.ShowDialog();
+                textBox.Text = this.templateDatabase.GetNextUniqueDataLabel(textBox.Text);
+                return;
+            }
             for (int row = 0; row < this.templateDatabase.Controls.RowCount; row++)
             {
                 ControlRow control = this.templateDatabase.Controls[row];
@@ -151,7 +151,8 @@ namespace Carnassial.UnitTests
             {
                 loadAtom.CreateJpegs(fileDatabase.FolderPath);
                 MemoryImage? thumbnail = null;
-                loadAtom.ClassifyFromThumbnails(ref thumbnail);
+                loadAtom.ClassifyFromThumbnails(fileDatabase.FolderPath, ref thumbnail);
+                loadAtom.UpdateBackgrounds(fileDatabase.Backgrounds);
                 loadAtom.ReadDateTimeOffsets(fileDatabase.FolderPath, imageSetTimeZone);
                 metadataReadResult = loadAtom.First.MetadataReadResult;
             }
@@ -34,6 +34,124 @@ namespace Carnassial.UnitTests
             //CarnassialTest.TryChangeToTestCulture();
         }
 
+        [TestMethod]
+        public async Task BatchAddFilesAsync()
+        {
+            string templateDatabaseFilePath = this.GetUniqueFilePathForTest(TestConstant.File.DefaultTemplateDatabaseFileName);
+            File.Copy(Path.Combine(this.WorkingDirectory, TestConstant.File.DefaultTemplateDatabaseFileName), templateDatabaseFilePath, true);
+            string fileDatabaseFilePath = this.GetUniqueFilePathForTest(TestConstant.File.DefaultNewFileDatabaseFileName);
+            if (File.Exists(fileDatabaseFilePath))
+            {
+                File.Delete(fileDatabaseFilePath);
+            }
+            string spreadsheetFilePath = Path.ChangeExtension(fileDatabaseFilePath, Constant.File.CsvFileExtension);
+            if (File.Exists(spreadsheetFilePath))
+            {
+                File.Delete(spreadsheetFilePath);
+            }
+            string folderToLoad = Path.Combine(this.WorkingDirectory, TestConstant.File.HybridVideoDirectoryName);
+            FileInfo[] imagesAndVideos = new DirectoryInfo(folderToLoad).GetFiles();
+            Dictionary<string, double?> changeScoresByFileName = new(StringComparer.OrdinalIgnoreCase);
+
+            // arguments are recognized by extension, so their order doesn't matter
+            int exitCode = await CarnassialBatch.RunAsync([ CarnassialBatch.Argument, spreadsheetFilePath, templateDatabaseFilePath, folderToLoad, fileDatabaseFilePath ]).ConfigureAwait(true);
+            Assert.IsTrue(exitCode == 0);
+            Assert.IsTrue(File.Exists(spreadsheetFilePath));
+
+            Assert.IsTrue(TemplateDatabase.TryCreateOrOpen(templateDatabaseFilePath, out TemplateDatabase templateDatabase));
+            using (templateDatabase)
+            {
+                Assert.IsTrue(FileDatabase.TryCreateOrOpen(fileDatabaseFilePath, templateDatabase, false, LogicalOperator.And, out FileDatabase fileDatabase));
+                using (fileDatabase)
+                {
+                    fileDatabase.SelectFiles(FileSelection.All);
+                    Assert.IsTrue(fileDatabase.Files.RowCount == imagesAndVideos.Length);
+                    foreach (ImageRow file in fileDatabase.Files)
+                    {
+                        FileClassification expectedClassification = file.IsVideo ? FileClassification.Video : FileClassification.Color;
+                        Assert.IsTrue(file.Classification == expectedClassification);
+
+                        // images' statistics are calculated from their thumbnails and read back from the database
+                        // MJPEG videos' statistics come from their first frames but the test videos are H.264, so have none.
+                        if (file.IsVideo)
+                        {
+                            Assert.IsNull(file.Statistics);
+                        }
+                        else
+                        {
+                            Assert.IsNotNull(file.Statistics);
+                            Assert.IsTrue(file.Statistics.LuminosityHistogram.Length == Constant.Images.LuminosityHistogramBins);
+                            Assert.IsTrue(Math.Abs(file.Statistics.LuminosityHistogram.Sum() - 1.0F) < 0.001F);
+                            Assert.IsTrue((file.Statistics.LuminosityPercentile5 <= file.Statistics.LuminosityPercentile50) && (file.Statistics.LuminosityPercentile50 <= file.Statistics.LuminosityPercentile95));
+                            Assert.IsTrue(file.Statistics.Sharpness > 0.0);
+                        }
+                    }
+
+                    // the folder's background is found from its images' thumbnails and read back from the database
+                    Assert.IsTrue(fileDatabase.Backgrounds.TryGetValue(fileDatabase.Files[0].RelativePath, out BackgroundModel? background));
+                    Assert.IsTrue((background.Frames > 0) && (background.Mean.Length == 4 * background.PixelWidth * background.PixelHeight));
+
+                    // every color image but the first in each folder is scored against its folder's background
+                    int expectedChangeScores = fileDatabase.Backgrounds.Values.Sum(folderBackground => folderBackground.Frames - 1);
+                    Assert.IsTrue(fileDatabase.Files.Count(file => file.ChangeScore.HasValue) == expectedChangeScores);
+                    Assert.IsTrue(fileDatabase.Files.Where(file => file.ChangeScore.HasValue).All(file => (file.ChangeScore >= 0.0) && (file.ChangeScore <= 1.0)));
+                    foreach (ImageRow file in fileDatabase.Files)
+                    {
+                        changeScoresByFileName.Add(file.FileName, file.ChangeScore);
+                    }
+                }
+            }
+
+            // change scores don't depend on which compute task scored which file
+            string repeatFileDatabaseFilePath = this.GetUniqueFilePathForTest("Repeat" + TestConstant.File.DefaultNewFileDatabaseFileName);
+            if (File.Exists(repeatFileDatabaseFilePath))
+            {
+                File.Delete(repeatFileDatabaseFilePath);
+            }
+            exitCode = await CarnassialBatch.RunAsync([ CarnassialBatch.Argument, templateDatabaseFilePath, folderToLoad, repeatFileDatabaseFilePath ]).ConfigureAwait(true);
+            Assert.IsTrue(exitCode == 0);
+            Assert.IsTrue(TemplateDatabase.TryCreateOrOpen(templateDatabaseFilePath, out templateDatabase));
+            using (templateDatabase)
+            {
+                Assert.IsTrue(FileDatabase.TryCreateOrOpen(repeatFileDatabaseFilePath, templateDatabase, false, LogicalOperator.And, out FileDatabase fileDatabase));
+                using (fileDatabase)
+                {
+                    fileDatabase.SelectFiles(FileSelection.All);
+                    Assert.IsTrue(fileDatabase.Files.RowCount == changeScoresByFileName.Count);
+                    foreach (ImageRow file in fileDatabase.Files)
+                    {
+                        Assert.IsTrue(file.ChangeScore == changeScoresByFileName[file.FileName]);
+                    }
+                }
+            }
+
+            // rerunning the batch doesn't add files a second time
+            exitCode = await CarnassialBatch.RunAsync([ CarnassialBatch.Argument, templateDatabaseFilePath, folderToLoad, fileDatabaseFilePath ]).ConfigureAwait(true);
+            Assert.IsTrue(exitCode == 0);
+            Assert.IsTrue(TemplateDatabase.TryCreateOrOpen(templateDatabaseFilePath, out templateDatabase));
+            using (templateDatabase)
+            {
+                Assert.IsTrue(FileDatabase.TryCreateOrOpen(fileDatabaseFilePath, templateDatabase, false, LogicalOperator.And, out FileDatabase fileDatabase));
+                using (fileDatabase)
+                {
+                    fileDatabase.SelectFiles(FileSelection.All);
+                    Assert.IsTrue(fileDatabase.Files.RowCount == imagesAndVideos.Length);
+                }
+            }
+
+            // invalid arguments
+            Assert.IsTrue(await CarnassialBatch.RunAsync([ CarnassialBatch.Argument ]).ConfigureAwait(true) != 0);
+            Assert.IsTrue(await CarnassialBatch.RunAsync([ CarnassialBatch.Argument, fileDatabaseFilePath ]).ConfigureAwait(true) != 0);
+            Assert.IsTrue(await CarnassialBatch.RunAsync([ CarnassialBatch.Argument, templateDatabaseFilePath, Path.GetPathRoot(this.WorkingDirectory)! ]).ConfigureAwait(true) != 0);
+
+            // folders whose paths start with the database folder's path but which are siblings of it rather than subfolders
+            string siblingFolderPath = Path.Combine(this.WorkingDirectory, TestConstant.File.HybridVideoDirectoryName[..^1]);
+            Directory.CreateDirectory(siblingFolderPath);
+            string siblingFileDatabaseFilePath = Path.Combine(siblingFolderPath, Path.GetFileName(fileDatabaseFilePath));
+            Assert.IsTrue(await CarnassialBatch.RunAsync([ CarnassialBatch.Argument, templateDatabaseFilePath, folderToLoad, siblingFileDatabaseFilePath ]).ConfigureAwait(true) != 0);
+            Assert.IsFalse(File.Exists(siblingFileDatabaseFilePath));
+        }
+
         [TestMethod]
         public void CreateReuseDefaultFileDatabase()
         {
@@ -868,13 +986,20 @@ namespace Carnassial.UnitTests
             // read metadata
             MetadataTag note0Tag;
             MetadataTag note3Tag;
-            using (JpegImage jpeg = new(imagesAndVideos.First(file => JpegImage.IsJpeg(file.FullName)).FullName))
+            string jpegPath = imagesAndVideos.First(file => JpegImage.IsJpeg(file.FullName)).FullName;
+            using (JpegImage jpeg = new(jpegPath))
             {
                 Assert.IsTrue(jpeg.TryGetMetadata());
                 ExifSubIfdDirectory subIfd = jpeg.Metadata.OfType<ExifSubIfdDirectory>().Single();
                 note0Tag = subIfd.Tags.Single(tag => tag.Type == ExifSubIfdDirectory.TagExifImageHeight);
                 note3Tag = subIfd.Tags.Single(tag => tag.Type == ExifSubIfdDirectory.TagExifImageWidth);
             }
+            using (JpegImage jpeg = await JpegImage.OpenAsync(jpegPath).ConfigureAwait(false))
+            {
+                Assert.IsTrue(jpeg.TryGetMetadata());
+                ExifSubIfdDirectory subIfd = jpeg.Metadata.OfType<ExifSubIfdDirectory>().Single();
+                Assert.IsTrue(String.Equals(subIfd.GetDescription(ExifSubIfdDirectory.TagExifImageHeight), note0Tag.Description, StringComparison.Ordinal));
+            }
             ObservableArray<MetadataFieldResult> metadataResults = new(imagesAndVideos.Length, MetadataFieldResult.Default);
             using (MetadataIOComputeTransactionManager readMetadata = new(this.UpdateMetadataProgress, metadataResults, desiredStatusUpdateInterval))
             {
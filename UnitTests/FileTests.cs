@@ -9,7 +9,11 @@ using System.Diagnostics;
 using System.Globalization;
 using System.IO;
 using System.Linq;
+using System.Threading;
 using System.Threading.Tasks;
+using System.Windows;
+using System.Windows.Media;
+using System.Windows.Media.Imaging;
 using MetadataDirectory = MetadataExtractor.Directory;
 
 namespace Carnassial.UnitTests
@@ -17,6 +21,12 @@ namespace Carnassial.UnitTests
     [TestClass]
     public class FileTests : CarnassialTest
     {
+        // size of synthetic images for kernel tests
+        // The width is odd so rows aren't a multiple of the kernels' vector loop sizes and pixel pairs straddle rows, and neither
+        // dimension is a multiple of the block size so blocks along the right and bottom edges are partial.
+        private const int TestImageHeight = 250;
+        private const int TestImageWidth = 333;
+
         [ClassCleanup]
         public static void ClassCleanup()
         {
@@ -29,6 +39,222 @@ namespace Carnassial.UnitTests
             CarnassialTest.TryChangeToTestCulture();
         }
 
+        [TestMethod]
+        public async Task AviDemultiplex()
+        {
+            // the hybrid video test files are H.264 AVIs with an interleaved audio stream
+            string videoPath = Path.Combine(this.WorkingDirectory, TestConstant.File.HybridVideoDirectoryName, TestConstant.FileExpectation.HybridVideoFileName);
+            using (AviMjpegReader avi = new(videoPath))
+            {
+                Assert.IsFalse(avi.IsMjpeg);
+                Assert.IsTrue(avi.FrameCount == TestConstant.FileExpectation.HybridVideoFrameCount);
+                Assert.IsTrue(avi.FrameInterval > TimeSpan.Zero);
+                Assert.IsTrue(avi.PixelWidth == 640);
+                Assert.IsTrue(avi.PixelHeight == 360);
+
+                long previousFrameOffset = 0;
+                for (int frameIndex = 0; frameIndex < avi.FrameCount; ++frameIndex)
+                {
+                    (long offset, int length) = avi.GetFrameLocation(frameIndex);
+                    Assert.IsTrue(offset > previousFrameOffset);
+                    Assert.IsTrue(length > 0);
+                    previousFrameOffset = offset;
+                }
+
+                byte[]? jpeg = null;
+                MemoryImage? frame = null;
+                Assert.IsFalse(avi.TryDecodeFrame(0, null, ref jpeg, ref frame));
+            }
+
+            VideoRow video = new(TestConstant.FileExpectation.HybridVideoFileName, TestConstant.File.HybridVideoDirectoryName, new FileTable());
+            CachedImage firstFrame = await video.TryLoadImageAsync(this.WorkingDirectory).ConfigureAwait(false);
+            Assert.IsTrue(firstFrame.ImageNotDecodable && (firstFrame.Image == null));
+            Assert.IsFalse(video.TryGetKeyframeStrip(this.WorkingDirectory, Constant.Images.VideoKeyframeStripFrames, out VideoKeyframeStrip? _));
+
+            // MJPEG AVIs' frames are indexed and decoded
+            string mjpegVideoPath = this.GetUniqueFilePathForTest(TestConstant.File.MjpegVideoFileName);
+            FileTests.CreateMjpegAvi(mjpegVideoPath, 320, 240, 12);
+            using (AviMjpegReader avi = new(mjpegVideoPath))
+            {
+                Assert.IsTrue(avi.IsMjpeg);
+                Assert.IsTrue(avi.FrameCount == 12);
+                Assert.IsTrue(avi.FrameInterval == TimeSpan.FromMilliseconds(100));
+                Assert.IsTrue(avi.PixelWidth == 320);
+                Assert.IsTrue(avi.PixelHeight == 240);
+
+                byte[]? jpeg = null;
+                MemoryImage? frame = null;
+                Assert.IsTrue(avi.TryDecodeFrame(0, null, ref jpeg, ref frame));
+                Assert.IsTrue((frame.DecompressionError == false) && (frame.PixelWidth == 320) && (frame.PixelHeight == 240));
+
+                // first frame's square is at its left edge
+                byte[] pixels = FileTests.GetPixels(frame);
+                Assert.IsTrue(pixels[4 * (120 * 320 + 30) + 1] > 192);
+                Assert.IsTrue(pixels[4 * (120 * 320 + 290) + 1] < 96);
+
+                Assert.IsTrue(avi.TryDecodeFrame(avi.FrameCount - 1, 40, ref jpeg, ref frame));
+                Assert.IsTrue((frame.DecompressionError == false) && (frame.PixelWidth == 40) && (frame.PixelHeight == 30));
+            }
+
+            VideoRow mjpegVideo = new(Path.GetFileName(mjpegVideoPath), String.Empty, new FileTable());
+            CachedImage mjpegFirstFrame = await mjpegVideo.TryLoadImageAsync(this.WorkingDirectory).ConfigureAwait(false);
+            Assert.IsTrue((mjpegFirstFrame.ImageNotDecodable == false) && (mjpegFirstFrame.Image != null));
+            Assert.IsTrue((mjpegFirstFrame.Image.PixelWidth == 320) && (mjpegFirstFrame.Image.PixelHeight == 240));
+        }
+
+        [TestMethod]
+        public void Background()
+        {
+            static MemoryImage CreateImage(int width, int height, byte blue, byte green, byte red)
+            {
+                byte[] pixels = new byte[width * height * 4];
+                for (int offset = 0; offset < pixels.Length; offset += 4)
+                {
+                    pixels[offset] = blue;
+                    pixels[offset + 1] = green;
+                    pixels[offset + 2] = red;
+                    pixels[offset + 3] = 255;
+                }
+                return FileTests.CreateImage(width, height, pixels);
+            }
+
+            // the first thumbnail is the background and later thumbnails are averaged in
+            BackgroundModel background = new("station", 16, 12);
+            Assert.IsTrue(background.TryUpdate(CreateImage(16, 12, 100, 150, 200)));
+            Assert.IsTrue((background.Frames == 1) && (background.Mean[0] == 100 * 128) && (background.Mean[1] == 150 * 128) && (background.Mean[2] == 200 * 128));
+            Assert.IsTrue(background.TryUpdate(CreateImage(16, 12, 100, 150, 100)));
+            Assert.IsTrue((background.Frames == 2) && (background.Mean[0] == 100 * 128) && (background.Mean[2] == 150 * 128));
+            Assert.IsFalse(background.TryUpdate(CreateImage(20, 12, 100, 150, 200)));
+            Assert.IsTrue(background.Frames == 2);
+
+            // an image matching the background has no difference and an animal in front of it differs only where the animal is,
+            // give or take the pixel differenced in pairs with the animal's edges
+            const int Width = FileTests.TestImageWidth;
+            const int Height = FileTests.TestImageHeight;
+            MemoryImage image = CreateImage(Width, Height, 100, 150, 150);
+            Assert.IsTrue(background.IsCompatible(image));
+            Assert.IsTrue(image.TryDifference(background, Constant.Images.DifferenceThresholdDefault, out MemoryImage? difference));
+            Assert.IsTrue(FileTests.GetPixels(difference).Where((byte value, int index) => index % 4 != 3).All(value => value == 0));
+
+            byte[] pixels = FileTests.GetPixels(image);
+            for (int row = 50; row < 100; ++row)
+            {
+                for (int column = 100; column < 200; ++column)
+                {
+                    Array.Clear(pixels, 4 * (Width * row + column), 3);
+                }
+            }
+            MemoryImage animal = FileTests.CreateImage(Width, Height, pixels);
+            Assert.IsTrue(animal.TryDifference(background, Constant.Images.DifferenceThresholdDefault, out difference));
+            byte[] differencePixels = FileTests.GetPixels(difference);
+            for (int row = 0; row < Height; ++row)
+            {
+                for (int column = 0; column < Width; ++column)
+                {
+                    byte grey = differencePixels[4 * (Width * row + column)];
+                    if ((row >= 50) && (row < 100) && (column >= 100) && (column < 200))
+                    {
+                        Assert.IsTrue(grey > 0);
+                    }
+                    else if ((row < 50) || (row >= 100) || (column < 99) || (column > 200))
+                    {
+                        Assert.IsTrue(grey == 0);
+                    }
+                }
+            }
+
+            // images whose aspect ratios don't match the background's aren't differenced
+            Assert.IsFalse(background.IsCompatible(CreateImage(Height, Height, 100, 150, 150)));
+            Assert.IsFalse(CreateImage(Height, Height, 100, 150, 150).TryDifference(background, Constant.Images.DifferenceThresholdDefault, out MemoryImage? _));
+
+            // change scores are the fraction of included pixels which differ from the background
+            MemoryImage thumbnail = CreateImage(16, 12, 100, 150, 150);
+            Assert.IsTrue(thumbnail.TryGetChangeScore(background.Mean, Constant.Images.DifferenceThresholdDefault, 0, null, out double changeScore));
+            Assert.IsTrue(changeScore == 0.0);
+
+            byte[] thumbnailPixels = FileTests.GetPixels(thumbnail);
+            byte[] mask = new byte[16 * 12];
+            Array.Fill(mask, (byte)1);
+            for (int row = 3; row < 7; ++row)
+            {
+                for (int column = 4; column < 12; ++column)
+                {
+                    Array.Clear(thumbnailPixels, 4 * (16 * row + column), 3);
+                    mask[16 * row + column] = 0;
+                }
+            }
+            thumbnail = FileTests.CreateImage(16, 12, thumbnailPixels);
+            Assert.IsTrue(thumbnail.TryGetChangeScore(background.Mean, Constant.Images.DifferenceThresholdDefault, 0, null, out changeScore));
+            Assert.IsTrue(changeScore == 32.0 / 192.0);
+            Assert.IsTrue(thumbnail.TryGetChangeScore(background.Mean, Constant.Images.DifferenceThresholdDefault, 6, null, out changeScore));
+            Assert.IsTrue(changeScore == 24.0 / 96.0);
+            Assert.IsTrue(thumbnail.TryGetChangeScore(background.Mean, Constant.Images.DifferenceThresholdDefault, 0, mask, out changeScore));
+            Assert.IsTrue(changeScore == 0.0);
+            Assert.IsFalse(thumbnail.TryGetChangeScore(background.Mean, Constant.Images.DifferenceThresholdDefault, 12, null, out double _));
+
+            // a background's first image has no score and later images are scored before they're added to the background
+            BackgroundModel station = new("station", 16, 12);
+            Assert.IsTrue(station.TryUpdate(CreateImage(16, 12, 100, 150, 150), 0, null, out double? firstChangeScore));
+            Assert.IsNull(firstChangeScore);
+            Assert.IsTrue(station.TryUpdate(thumbnail, 0, null, out double? secondChangeScore));
+            Assert.IsTrue(secondChangeScore == 32.0 / 192.0);
+        }
+
+        [TestMethod]
+        public void BlockChanges()
+        {
+            // the test image's size isn't a multiple of the block size, so blocks at the right and bottom edges are partial
+            const int Width = FileTests.TestImageWidth;
+            const int Height = FileTests.TestImageHeight;
+            const int BlocksHigh = (Height + Constant.Images.BlockChangeSizeInPixels - 1) / Constant.Images.BlockChangeSizeInPixels;
+            const int BlocksWide = (Width + Constant.Images.BlockChangeSizeInPixels - 1) / Constant.Images.BlockChangeSizeInPixels;
+            MemoryImage image = FileTests.CreateRandomImage(Width, Height, 1);
+            Assert.IsTrue(image.TryGetBlockChangeMap(image, Constant.Images.BlockChangeSizeInPixels, out BlockChangeMap? unchanged));
+            Assert.IsTrue((unchanged.BlocksWide == BlocksWide) && (unchanged.BlocksHigh == BlocksHigh));
+            Assert.IsFalse(unchanged.HasChange(0));
+
+            // an animal changes the blocks it covers, including a partial block in the bottom right corner, and no others
+            byte[] animalPixels = FileTests.GetPixels(image);
+            foreach ((int left, int top, int right, int bottom) in new (int, int, int, int)[] { (96, 56, 136, 88), (Width - 5, Height - 2, Width, Height) })
+            {
+                for (int y = top; y < bottom; ++y)
+                {
+                    for (int x = left; x < right; ++x)
+                    {
+                        for (int channel = 0; channel < 3; ++channel)
+                        {
+                            animalPixels[4 * (y * Width + x) + channel] = (byte)(255 - animalPixels[4 * (y * Width + x) + channel]);
+                        }
+                    }
+                }
+            }
+            MemoryImage animal = FileTests.CreateImage(Width, Height, animalPixels);
+            Assert.IsTrue(image.TryGetBlockChangeMap(animal, Constant.Images.BlockChangeSizeInPixels, out BlockChangeMap? changeMap));
+            Assert.IsTrue(changeMap.HasChange(Constant.Images.BlockChangeThresholdDefault));
+            Assert.IsTrue(changeMap.CountChangedBlocks(Constant.Images.BlockChangeThresholdDefault) == 5 * 4 + 1);
+
+            BitmapSource heatmap = changeMap.GetHeatmap(Constant.Images.BlockChangeThresholdDefault);
+            Assert.IsTrue((heatmap.PixelWidth == BlocksWide) && (heatmap.PixelHeight == BlocksHigh));
+            byte[] heatmapPixels = new byte[4 * BlocksWide * BlocksHigh];
+            heatmap.CopyPixels(heatmapPixels, 4 * BlocksWide, 0);
+            for (int blockY = 0; blockY < changeMap.BlocksHigh; ++blockY)
+            {
+                for (int blockX = 0; blockX < changeMap.BlocksWide; ++blockX)
+                {
+                    int block = blockY * changeMap.BlocksWide + blockX;
+                    bool isAnimal = ((blockX >= 12) && (blockX < 17) && (blockY >= 7) && (blockY < 11)) || ((blockX == BlocksWide - 1) && (blockY == BlocksHigh - 1));
+                    Assert.IsTrue((changeMap.MeanAbsoluteDifferences[block] > Constant.Images.BlockChangeThresholdDefault) == isAnimal);
+                    Assert.IsTrue((heatmapPixels[4 * block + 3] > 0) == isAnimal);
+                    Assert.IsTrue((heatmapPixels[4 * block] == 0) && (heatmapPixels[4 * block + 1] == 0) && (heatmapPixels[4 * block + 2] == heatmapPixels[4 * block + 3]));
+                }
+            }
+
+            Assert.IsTrue(image.TryGetBlockChangeMap(animal, 2 * Constant.Images.BlockChangeSizeInPixels, out BlockChangeMap? coarseChangeMap));
+            Assert.IsTrue((coarseChangeMap.BlocksWide == (BlocksWide + 1) / 2) && (coarseChangeMap.BlocksHigh == (BlocksHigh + 1) / 2));
+            Assert.IsTrue(coarseChangeMap.HasChange(Constant.Images.BlockChangeThresholdDefault));
+            Assert.IsFalse(image.TryGetBlockChangeMap(new MemoryImage(Width - 1, Height, PixelFormats.Pbgra32), Constant.Images.BlockChangeSizeInPixels, out BlockChangeMap? _));
+        }
+
         [TestMethod]
         public async Task Cache()
         {
@@ -46,6 +272,7 @@ namespace Carnassial.UnitTests
             Assert.IsTrue(cache.CurrentDifferenceState == ImageDifference.Unaltered);
             Assert.IsTrue(cache.CurrentRow == 0);
             FileTests.VerifyCurrentImage(cache);
+            Assert.IsTrue(cache.JpegMisses > 0);
 
             MoveToFileResult moveToFile = await cache.TryMoveToFileAsync(0, 0).ConfigureAwait(false);
             Assert.IsTrue(moveToFile.Succeeded);
@@ -94,6 +321,97 @@ namespace Carnassial.UnitTests
             moveToFile = await cache.TryMoveToFileAsync(fileExpectations.Count, 0).ConfigureAwait(false);
             Assert.IsFalse(moveToFile.Succeeded);
 
+            // rapid navigation may display previews, which are replaced by full resolution images once navigation pauses
+            cache.Reset();
+            for (int file = 0; file < fileDatabase.Files.RowCount; ++file)
+            {
+                moveToFile = await cache.TryMoveToFileAsync(file, 1).ConfigureAwait(false);
+                Assert.IsTrue(moveToFile.Succeeded);
+            }
+            await cache.TryRefineCurrentImageAsync().ConfigureAwait(false);
+            if (cache.Current!.IsVideo == false)
+            {
+                FileTests.VerifyCurrentImage(cache);
+                Assert.IsFalse(cache.GetCurrentImage()!.IsPreview);
+            }
+
+            // progressive display shows previews which are refined to the display's width, and to full resolution only once it's
+            // required
+            using ImageCache progressiveCache = new(fileDatabase)
+            {
+                DisplayWidthInPixels = 400
+            };
+            for (int file = 0; file < 2; ++file)
+            {
+                moveToFile = await progressiveCache.TryMoveToFileAsync(file, 0).ConfigureAwait(false);
+                Assert.IsTrue(moveToFile.Succeeded);
+                await progressiveCache.TryRefineCurrentImageAsync().ConfigureAwait(false);
+                CachedImage? displayImage = progressiveCache.GetCurrentImage();
+                Assert.IsTrue((displayImage != null) && (displayImage.Resolution == ImageResolution.Display) && (displayImage.Image != null));
+                Assert.IsTrue((400 <= displayImage.Image.PixelWidth) && (displayImage.Image.PixelWidth < 1000));
+
+                progressiveCache.RequireFullResolution(true);
+                await progressiveCache.TryRefineCurrentImageAsync().ConfigureAwait(false);
+                Assert.IsTrue(progressiveCache.GetCurrentImage()!.Resolution == ImageResolution.Full);
+                FileTests.VerifyCurrentImage(progressiveCache);
+                progressiveCache.RequireFullResolution(false);
+
+                // test images are too small to be tiled but tiling's checked directly against a full resolution decode
+                Assert.IsFalse(progressiveCache.TryGetCurrentPyramid(out ImagePyramid? _));
+                byte[]? jpeg = await fileDatabase.Files[file].TryReadJpegAsync(fileDatabase.FolderPath, CancellationToken.None).ConfigureAwait(false);
+                Assert.IsTrue((jpeg != null) && ImagePyramid.TryCreate(jpeg, out ImagePyramid? pyramid));
+                MemoryImage fullResolution = progressiveCache.GetCurrentImage()!.Image!;
+                Assert.IsTrue((pyramid.PixelWidth == fullResolution.PixelWidth) && (pyramid.PixelHeight == fullResolution.PixelHeight));
+                Assert.IsTrue(pyramid.GetLevel(1.0) == 0);
+                Assert.IsTrue(pyramid.GetLevel(0.3) == 1);
+                Assert.IsTrue(pyramid.GetLevel(0.01) == Constant.Images.PyramidLevels - 1);
+                List<(int Level, int Column, int Row)> tiles = pyramid.GetTiles(1, new Rect(0.0, 0.0, 1.0, 1.0));
+                int levelColumns = (pyramid.GetLevelWidth(1) + Constant.Images.PyramidTileSizeInPixels - 1) / Constant.Images.PyramidTileSizeInPixels;
+                int levelRows = (pyramid.GetLevelHeight(1) + Constant.Images.PyramidTileSizeInPixels - 1) / Constant.Images.PyramidTileSizeInPixels;
+                Assert.IsTrue(tiles.Count == levelColumns * levelRows);
+                (int Level, int Column, int Row) lastTile = tiles[^1];
+                MemoryImage tile = pyramid.GetTile(lastTile.Level, lastTile.Column, lastTile.Row);
+                Int32Rect tileBounds = pyramid.GetTileBounds(lastTile.Level, lastTile.Column, lastTile.Row);
+                Assert.IsFalse(tile.DecompressionError);
+                Assert.IsTrue((tile.PixelWidth == tileBounds.Width) && (tile.PixelHeight == tileBounds.Height));
+                Assert.IsTrue(tileBounds.X + tileBounds.Width == pyramid.GetLevelWidth(1));
+                Assert.IsTrue(pyramid.TryGetTile(lastTile.Level, lastTile.Column, lastTile.Row, out MemoryImage? _));
+
+                // blocks of tiles, as the magnifying glass samples, match the full resolution decode apart from rounding at
+                // tile edges
+                Int32Rect levelZero = new(0, 0, pyramid.PixelWidth, pyramid.PixelHeight);
+                Assert.IsFalse(pyramid.TryGetBlock(0, levelZero, out MemoryImage? _, out Int32Rect _));
+                MemoryImage? block = pyramid.GetBlock(0, levelZero, out Int32Rect blockBounds);
+                Assert.IsTrue((block != null) && (blockBounds == levelZero));
+                Assert.IsTrue(block.TryGetMeanAbsoluteDifference(fullResolution, out double meanAbsoluteDifference) && (meanAbsoluteDifference < 0.01));
+                Assert.IsTrue(pyramid.TryGetBlock(0, new Int32Rect(1, 1, 2, 2), out MemoryImage? cornerBlock, out Int32Rect cornerBounds));
+                Assert.IsTrue((cornerBlock.PixelWidth == cornerBounds.Width) && (cornerBounds == pyramid.GetTileBounds(0, 0, 0)));
+                Assert.IsTrue(pyramid.TryGetBlock(0, new Int32Rect(3, 3, 2, 2), out MemoryImage? sameCornerBlock, out Int32Rect _) && (sameCornerBlock == cornerBlock));
+                Assert.IsTrue(pyramid.GetBlock(0, new Int32Rect(-10, -10, 5, 5), out Int32Rect _) == null);
+            }
+
+            // difference precomputation doesn't decode full resolution images while files are displayed at display resolution
+            // and no difference has been asked for
+            using ImageCache displayResolutionCache = new(fileDatabase)
+            {
+                DisplayWidthInPixels = 400
+            };
+            for (int file = 0; file < fileDatabase.Files.RowCount; ++file)
+            {
+                moveToFile = await displayResolutionCache.TryMoveToFileAsync(file, 1).ConfigureAwait(false);
+                Assert.IsTrue(moveToFile.Succeeded);
+                await displayResolutionCache.TryRefineCurrentImageAsync().ConfigureAwait(false);
+                await displayResolutionCache.PrecomputeDifferencesAsync(Constant.Images.DifferenceThresholdDefault).ConfigureAwait(false);
+            }
+            Assert.IsTrue(displayResolutionCache.FullResolutionDecodes == 0);
+
+            moveToFile = await displayResolutionCache.TryMoveToFileAsync(1, 0).ConfigureAwait(false);
+            Assert.IsTrue(moveToFile.Succeeded);
+            displayResolutionCache.RequireFullResolution(true);
+            await displayResolutionCache.TryRefineCurrentImageAsync().ConfigureAwait(false);
+            await displayResolutionCache.PrecomputeDifferencesAsync(Constant.Images.DifferenceThresholdDefault).ConfigureAwait(false);
+            Assert.IsTrue(displayResolutionCache.FullResolutionDecodes > 0);
+
             // combined differences
             cache.Reset();
             for (int file = 0; file < fileDatabase.Files.RowCount; ++file)
@@ -116,6 +434,63 @@ namespace Carnassial.UnitTests
                 }
             }
 
+            // background differences
+            // Backgrounds are found from color images' thumbnails as files are added, so folders with only greyscale images have
+            // no background and images whose thumbnails are letterboxed aren't compatible with their folder's background.
+            cache.Reset();
+            for (int file = 0; file < fileDatabase.Files.RowCount; ++file)
+            {
+                moveToFile = await cache.TryMoveToFileAsync(file, 1).ConfigureAwait(false);
+                Assert.IsTrue(moveToFile.Succeeded);
+
+                for (int step = 0; step < 3; ++step)
+                {
+                    ImageDifferenceResult backgroundDifferenceResult = await cache.TryMoveToNextBackgroundDifferenceImageAsync(Constant.Images.DifferenceThresholdDefault).ConfigureAwait(false);
+                    Assert.IsTrue((cache.CurrentDifferenceState == ImageDifference.Background) ||
+                                  (cache.CurrentDifferenceState == ImageDifference.Unaltered));
+                    CachedImage? differenceImage = cache.GetCurrentImage();
+                    switch (backgroundDifferenceResult)
+                    {
+                        case ImageDifferenceResult.BackgroundNotAvailable:
+                            Assert.IsFalse(fileDatabase.Backgrounds.ContainsKey(fileDatabase.Files[file].RelativePath));
+                            break;
+                        case ImageDifferenceResult.NotCalculable:
+                            Assert.IsTrue(cache.CurrentDifferenceState == ImageDifference.Unaltered);
+                            break;
+                        case ImageDifferenceResult.Success:
+                            Assert.IsTrue((differenceImage != null) && (differenceImage.Image != null));
+                            break;
+                        default:
+                            throw new NotSupportedException($"Unhandled result {backgroundDifferenceResult}.");
+                    }
+                }
+            }
+
+            // background differences are recalculated once their background's updated
+            for (int file = 0; file < fileDatabase.Files.RowCount; ++file)
+            {
+                moveToFile = await cache.TryMoveToFileAsync(file, 1).ConfigureAwait(false);
+                Assert.IsTrue(moveToFile.Succeeded);
+                if (await cache.TryMoveToNextBackgroundDifferenceImageAsync(Constant.Images.DifferenceThresholdDefault).ConfigureAwait(false) != ImageDifferenceResult.Success)
+                {
+                    continue;
+                }
+                CachedImage? initialDifference = cache.GetCurrentImage();
+
+                Assert.IsTrue(await cache.TryMoveToNextBackgroundDifferenceImageAsync(Constant.Images.DifferenceThresholdDefault).ConfigureAwait(false) == ImageDifferenceResult.Success);
+                Assert.IsTrue(cache.CurrentDifferenceState == ImageDifference.Unaltered);
+                Assert.IsTrue(await cache.TryMoveToNextBackgroundDifferenceImageAsync(Constant.Images.DifferenceThresholdDefault).ConfigureAwait(false) == ImageDifferenceResult.Success);
+                Assert.IsTrue(Object.ReferenceEquals(initialDifference, cache.GetCurrentImage()));
+
+                BackgroundModel background = fileDatabase.Backgrounds[fileDatabase.Files[file].RelativePath];
+                Assert.IsTrue(background.TryUpdate(new MemoryImage(background.PixelWidth, background.PixelHeight, PixelFormats.Pbgra32)));
+                Assert.IsTrue(await cache.TryMoveToNextBackgroundDifferenceImageAsync(Constant.Images.DifferenceThresholdDefault).ConfigureAwait(false) == ImageDifferenceResult.Success);
+                Assert.IsTrue(await cache.TryMoveToNextBackgroundDifferenceImageAsync(Constant.Images.DifferenceThresholdDefault).ConfigureAwait(false) == ImageDifferenceResult.Success);
+                Assert.IsTrue(cache.CurrentDifferenceState == ImageDifference.Background);
+                Assert.IsFalse(Object.ReferenceEquals(initialDifference, cache.GetCurrentImage()));
+                break;
+            }
+
             // next and previous differences
             cache.Reset();
             for (int file = fileDatabase.Files.RowCount - 1; file >= 0; --file)
@@ -140,6 +515,23 @@ namespace Carnassial.UnitTests
                 }
             }
 
+            // precomputed differences
+            cache.Reset();
+            for (int file = 0; file < fileDatabase.Files.RowCount; ++file)
+            {
+                moveToFile = await cache.TryMoveToFileAsync(file, 1).ConfigureAwait(false);
+                Assert.IsTrue(moveToFile.Succeeded);
+                await cache.PrecomputeDifferencesAsync(Constant.Images.DifferenceThresholdDefault).ConfigureAwait(false);
+
+                for (int step = 0; step < 4; ++step)
+                {
+                    ImageDifferenceResult differenceResult = await cache.TryMoveToNextDifferenceImageAsync(Constant.Images.DifferenceThresholdDefault).ConfigureAwait(false);
+                    await FileTests.CheckDifferenceResult(differenceResult, cache, fileDatabase).ConfigureAwait(false);
+                }
+                ImageDifferenceResult combinedResult = await cache.TryMoveToNextCombinedDifferenceImageAsync(Constant.Images.DifferenceThresholdDefault).ConfigureAwait(false);
+                await FileTests.CheckDifferenceResult(combinedResult, cache, fileDatabase).ConfigureAwait(false);
+            }
+
             cache.Reset();
             Assert.IsNull(cache.Current);
             Assert.IsTrue(cache.CurrentDifferenceState == ImageDifference.Unaltered);
@@ -228,6 +620,20 @@ namespace Carnassial.UnitTests
                     Assert.Fail($"{fileExpectation.FileName}: Expected coloration to be {fileExpectation.Coloration}, but it was {coloration}.");
                 }
                 Assert.IsTrue(classification == fileExpectation.Classification, $"{fileExpectation.FileName}: Expected classification {fileExpectation.Classification}, but it was {classification}.");
+
+                // sampled estimates need only be close enough to classify the same way
+                (double sampledLuminosity, double sampledColoration, double luminosityStandardError, double colorationStandardError) = image.Image.GetLuminosityAndColoration(0, Constant.Images.ClassificationSamplingStride, Constant.Images.DarkLuminosityThresholdDefault);
+                Assert.IsTrue(Math.Abs(sampledLuminosity - luminosity) < TestConstant.SampledLuminosityAndColorationTolerance, $"{fileExpectation.FileName}: Expected sampled luminosity to be near {luminosity}, but it was {sampledLuminosity}.");
+                Assert.IsTrue(Math.Abs(sampledColoration - coloration) < TestConstant.SampledLuminosityAndColorationTolerance, $"{fileExpectation.FileName}: Expected sampled coloration to be near {coloration}, but it was {sampledColoration}.");
+                Assert.IsTrue((luminosityStandardError >= 0.0) && (luminosityStandardError < TestConstant.SampledLuminosityAndColorationTolerance));
+                Assert.IsTrue((colorationStandardError >= 0.0) && (colorationStandardError < TestConstant.SampledLuminosityAndColorationTolerance));
+                FileClassification sampledClassification = new ImageProperties(sampledLuminosity, sampledColoration).EvaluateNewClassification(Constant.Images.DarkLuminosityThresholdDefault);
+                Assert.IsTrue(sampledClassification == fileExpectation.Classification, $"{fileExpectation.FileName}: Expected sampled classification {fileExpectation.Classification}, but it was {sampledClassification}.");
+
+                // statistics' luminosity and coloration are calculated in the same way as classification's
+                (double statisticsLuminosity, double statisticsColoration, ImageStatistics _) = image.Image.GetStatistics(0);
+                Assert.IsTrue(Math.Abs(statisticsLuminosity - luminosity) < 1E-9, $"{fileExpectation.FileName}: Expected statistics' luminosity to be {luminosity}, but it was {statisticsLuminosity}.");
+                Assert.IsTrue(Math.Abs(statisticsColoration - coloration) < 1E-9, $"{fileExpectation.FileName}: Expected statistics' coloration to be {coloration}, but it was {statisticsColoration}.");
             }
         }
 
@@ -322,6 +728,126 @@ namespace Carnassial.UnitTests
             }
         }
 
+        /// <summary>
+        /// Writes a ten frame per second MJPEG AVI of a light square moving from the left edge of a dark background to the right edge.
+        /// </summary>
+        private static void CreateMjpegAvi(string filePath, int pixelWidth, int pixelHeight, int frames)
+        {
+            int squareSize = pixelHeight / 4;
+            List<byte[]> jpegs = [];
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                byte[] pixels = new byte[4 * pixelWidth * pixelHeight];
+                Array.Fill(pixels, (byte)64);
+                int squareLeft = frame * (pixelWidth - squareSize) / Math.Max(frames - 1, 1);
+                int squareTop = (pixelHeight - squareSize) / 2;
+                for (int y = squareTop; y < squareTop + squareSize; ++y)
+                {
+                    Array.Fill(pixels, (byte)224, 4 * (y * pixelWidth + squareLeft), 4 * squareSize);
+                }
+
+                JpegBitmapEncoder encoder = new()
+                {
+                    QualityLevel = 90
+                };
+                encoder.Frames.Add(BitmapFrame.Create(BitmapSource.Create(pixelWidth, pixelHeight, 96, 96, PixelFormats.Bgr32, null, pixels, 4 * pixelWidth)));
+                using MemoryStream jpeg = new();
+                encoder.Save(jpeg);
+                jpegs.Add(jpeg.ToArray());
+            }
+
+            // RIFF AVI with one MJPEG stream and an idx1 whose offsets are relative to the movi list
+            const int chunkHeaderSize = 8;
+            const int mainHeaderSize = 56;
+            const int streamHeaderSize = 56;
+            const int streamFormatSize = 40;
+            int streamListSize = 4 + chunkHeaderSize + streamHeaderSize + chunkHeaderSize + streamFormatSize;
+            int headerListSize = 4 + chunkHeaderSize + mainHeaderSize + chunkHeaderSize + streamListSize;
+            int moviListSize = 4 + jpegs.Sum(jpeg => chunkHeaderSize + jpeg.Length + (jpeg.Length & 0x1));
+            int indexSize = 16 * frames;
+
+            using FileStream stream = new(filePath, FileMode.Create, FileAccess.Write);
+            using BinaryWriter avi = new(stream);
+            avi.Write("RIFF"u8);
+            avi.Write(4 + chunkHeaderSize + headerListSize + chunkHeaderSize + moviListSize + chunkHeaderSize + indexSize);
+            avi.Write("AVI "u8);
+
+            avi.Write("LIST"u8);
+            avi.Write(headerListSize);
+            avi.Write("hdrl"u8);
+            avi.Write("avih"u8);
+            avi.Write(mainHeaderSize);
+            avi.Write(100000); // microseconds per frame
+            avi.Write(0); // maximum bytes per second
+            avi.Write(0); // padding granularity
+            avi.Write(0x10); // AVIF_HASINDEX
+            avi.Write(frames);
+            avi.Write(0); // initial frames
+            avi.Write(1); // streams
+            avi.Write(0); // suggested buffer size
+            avi.Write(pixelWidth);
+            avi.Write(pixelHeight);
+            avi.Write(new byte[16]); // reserved
+
+            avi.Write("LIST"u8);
+            avi.Write(streamListSize);
+            avi.Write("strl"u8);
+            avi.Write("strh"u8);
+            avi.Write(streamHeaderSize);
+            avi.Write("vids"u8);
+            avi.Write("MJPG"u8);
+            avi.Write(0); // flags
+            avi.Write(0); // priority and language
+            avi.Write(0); // initial frames
+            avi.Write(1); // scale
+            avi.Write(10); // rate
+            avi.Write(0); // start
+            avi.Write(frames); // length
+            avi.Write(0); // suggested buffer size
+            avi.Write(-1); // quality
+            avi.Write(0); // sample size
+            avi.Write((Int16)0); // frame rectangle
+            avi.Write((Int16)0);
+            avi.Write((Int16)pixelWidth);
+            avi.Write((Int16)pixelHeight);
+            avi.Write("strf"u8);
+            avi.Write(streamFormatSize);
+            avi.Write(streamFormatSize); // BITMAPINFOHEADER.biSize
+            avi.Write(pixelWidth);
+            avi.Write(pixelHeight);
+            avi.Write((Int16)1); // planes
+            avi.Write((Int16)24); // bits per pixel
+            avi.Write("MJPG"u8);
+            avi.Write(3 * pixelWidth * pixelHeight);
+            avi.Write(new byte[16]); // resolution and palette
+
+            avi.Write("LIST"u8);
+            avi.Write(moviListSize);
+            avi.Write("movi"u8);
+            foreach (byte[] jpeg in jpegs)
+            {
+                avi.Write("00dc"u8);
+                avi.Write(jpeg.Length);
+                avi.Write(jpeg);
+                if ((jpeg.Length & 0x1) != 0)
+                {
+                    avi.Write((byte)0);
+                }
+            }
+
+            avi.Write("idx1"u8);
+            avi.Write(indexSize);
+            int chunkOffset = 4;
+            foreach (byte[] jpeg in jpegs)
+            {
+                avi.Write("00dc"u8);
+                avi.Write(0x10); // AVIIF_KEYFRAME
+                avi.Write(chunkOffset);
+                avi.Write(jpeg.Length);
+                chunkOffset += chunkHeaderSize + jpeg.Length + (jpeg.Length & 0x1);
+            }
+        }
+
         [TestMethod]
         public async Task CorruptFileAsync()
         {
@@ -337,6 +863,37 @@ namespace Carnassial.UnitTests
                           corruptImage.Image.DecompressionError);
         }
 
+        [TestMethod]
+        public void Differences()
+        {
+            MemoryImage[] images = new MemoryImage[3];
+            for (int index = 0; index < images.Length; ++index)
+            {
+                images[index] = FileTests.CreateRandomImage(FileTests.TestImageWidth, FileTests.TestImageHeight, index + 1);
+            }
+
+            // combined differences from sums of absolute differences match those calculated directly from the images, and sums
+            // are the same whichever image they're calculated from
+            MemoryImage previous = images[0];
+            MemoryImage current = images[1];
+            MemoryImage next = images[2];
+            Assert.IsTrue(previous.TryGetSumsOfAbsoluteDifferences(current, out UInt16[]? previousSums));
+            Assert.IsTrue(current.TryGetSumsOfAbsoluteDifferences(previous, out UInt16[]? previousSumsFromCurrent));
+            CollectionAssert.AreEqual(previousSums, previousSumsFromCurrent);
+            Assert.IsTrue(current.TryGetSumsOfAbsoluteDifferences(next, out UInt16[]? nextSums));
+
+            foreach (byte threshold in new byte[] { Constant.Images.DifferenceThresholdMin, Constant.Images.DifferenceThresholdDefault, 100, Constant.Images.DifferenceThresholdMax })
+            {
+                Assert.IsTrue(current.TryDifference(previous, next, threshold, out MemoryImage? difference));
+                Assert.IsTrue(current.TryDifference(previousSums, nextSums, threshold, out MemoryImage? differenceFromSums));
+                CollectionAssert.AreEqual(FileTests.GetPixels(difference), FileTests.GetPixels(differenceFromSums));
+            }
+
+            MemoryImage mismatched = new(FileTests.TestImageWidth - 1, FileTests.TestImageHeight, PixelFormats.Pbgra32);
+            Assert.IsFalse(current.TryGetSumsOfAbsoluteDifferences(mismatched, out UInt16[]? _));
+            Assert.IsFalse(mismatched.TryDifference(previousSums, nextSums, Constant.Images.DifferenceThresholdDefault, out MemoryImage? _));
+        }
+
         [TestMethod]
         public void ExifBushnell()
         {
@@ -381,6 +938,86 @@ namespace Carnassial.UnitTests
             Assert.IsFalse(String.IsNullOrWhiteSpace(hyperfire.GetDescription(ReconyxHyperFireMakernoteDirectory.TagUserLabel)));
         }
 
+        private static MemoryImage CreateImage(int width, int height, byte[] pixels)
+        {
+            return new(BitmapSource.Create(width, height, 96, 96, PixelFormats.Pbgra32, null, pixels, width * 4));
+        }
+
+        // opaque noise, which is the same for the same seed
+        private static MemoryImage CreateRandomImage(int width, int height, int seed)
+        {
+            byte[] pixels = new byte[width * height * 4];
+            new Random(seed).NextBytes(pixels);
+            for (int alphaOffset = 3; alphaOffset < pixels.Length; alphaOffset += 4)
+            {
+                pixels[alphaOffset] = 255;
+            }
+            return FileTests.CreateImage(width, height, pixels);
+        }
+
+        private static byte[] GetPixels(MemoryImage image)
+        {
+            BitmapSource bitmap = image.AsBitmapSource();
+            byte[] pixels = new byte[bitmap.PixelHeight * bitmap.PixelWidth * bitmap.Format.BitsPerPixel / 8];
+            bitmap.CopyPixels(pixels, bitmap.PixelWidth * bitmap.Format.BitsPerPixel / 8, 0);
+            return pixels;
+        }
+
+        [TestMethod]
+        public void IlluminationNormalization()
+        {
+            // a file taken in dimmer light is stood in for by scaling and offsetting another file's pixels
+            const int Width = FileTests.TestImageWidth;
+            const int Height = FileTests.TestImageHeight;
+            MemoryImage image = FileTests.CreateRandomImage(Width, Height, 1);
+            byte[] pixels = FileTests.GetPixels(image);
+            byte[] dimmerPixels = new byte[pixels.Length];
+            for (int offset = 0; offset < pixels.Length; ++offset)
+            {
+                dimmerPixels[offset] = offset % 4 == 3 ? (byte)255 : (byte)(3 * pixels[offset] / 5 + 12);
+            }
+            MemoryImage dimmer = FileTests.CreateImage(Width, Height, dimmerPixels);
+
+            // without normalization nearly every pixel differs while with it none do, whether differenced directly or from sums
+            Assert.IsTrue(image.TryDifference(dimmer, 0, 0, false, Constant.Images.DifferenceThresholdDefault, out MemoryImage? difference));
+            Assert.IsTrue(FileTests.GetPixels(difference).Where((byte value, int index) => index % 4 == 0).Count(value => value != 0) > Width * Height / 2);
+            Assert.IsTrue(image.TryDifference(dimmer, 0, 0, true, Constant.Images.DifferenceThresholdDefault, out MemoryImage? normalizedDifference));
+            Assert.IsTrue(FileTests.GetPixels(normalizedDifference).Where((byte value, int index) => index % 4 != 3).All(value => value == 0));
+
+            Assert.IsTrue(image.TryGetSumsOfAbsoluteDifferences(dimmer, 0, 0, true, out UInt16[]? normalizedSums));
+            Assert.IsTrue(image.TryDifference(normalizedSums, normalizedSums, Constant.Images.DifferenceThresholdDefault, out MemoryImage? normalizedDifferenceFromSums));
+            Assert.IsTrue(FileTests.GetPixels(normalizedDifferenceFromSums).Where((byte value, int index) => index % 4 != 3).All(value => value == 0));
+
+            // an animal in the dimmer file remains different after normalization and the rest of the scene doesn't, apart from
+            // pixels paired with the animal's edge pixels as the image's width is odd
+            for (int y = Height / 3; y < Height / 2; ++y)
+            {
+                for (int x = Width / 3; x < Width / 2; ++x)
+                {
+                    dimmerPixels[4 * (y * Width + x)] = 255;
+                    dimmerPixels[4 * (y * Width + x) + 1] = 255;
+                    dimmerPixels[4 * (y * Width + x) + 2] = 255;
+                }
+            }
+            MemoryImage animal = FileTests.CreateImage(Width, Height, dimmerPixels);
+            Assert.IsTrue(image.TryDifference(animal, 0, 0, true, Constant.Images.DifferenceThresholdDefault, out MemoryImage? animalDifference));
+            byte[] animalDifferencePixels = FileTests.GetPixels(animalDifference);
+            int animalPixelsDifferent = 0;
+            for (int y = 0; y < Height; ++y)
+            {
+                for (int x = 0; x < Width; ++x)
+                {
+                    bool isAnimal = (y >= Height / 3) && (y < Height / 2) && (x >= Width / 3 - 1) && (x <= Width / 2);
+                    if (animalDifferencePixels[4 * (y * Width + x)] != 0)
+                    {
+                        Assert.IsTrue(isAnimal);
+                        ++animalPixelsDifferent;
+                    }
+                }
+            }
+            Assert.IsTrue(animalPixelsDifferent > (Height / 2 - Height / 3) * (Width / 2 - Width / 3) / 2);
+        }
+
         private IReadOnlyCollection<MetadataDirectory> LoadMetadata(FileExpectations fileExpectation)
         {
             if ((fileExpectation.RelativePath == null) || (fileExpectation.FileName == null))
@@ -483,6 +1120,224 @@ namespace Carnassial.UnitTests
             return metadata;
         }
 
+        [TestMethod]
+        public void KeyframeStrip()
+        {
+            string videoPath = this.GetUniqueFilePathForTest(TestConstant.File.MjpegVideoFileName);
+            FileTests.CreateMjpegAvi(videoPath, 320, 240, 12);
+
+            // frames are sampled evenly from first to last, decoded at 1/8 scale, and laid out side by side
+            Assert.IsTrue(VideoKeyframeStrip.TryCreate(videoPath, Constant.Images.VideoKeyframeStripFrames, out VideoKeyframeStrip? keyframeStrip));
+            Assert.IsTrue(keyframeStrip.FrameIndices.Length == Constant.Images.VideoKeyframeStripFrames);
+            Assert.IsTrue((keyframeStrip.FrameIndices[0] == 0) && (keyframeStrip.FrameIndices[^1] == 11));
+            Assert.IsTrue(keyframeStrip.ChangeScores.Length == Constant.Images.VideoKeyframeStripFrames);
+            Assert.IsTrue(keyframeStrip.Strip.PixelWidth == Constant.Images.VideoKeyframeStripFrames * 40);
+            Assert.IsTrue(keyframeStrip.Strip.PixelHeight == 30);
+
+            // the square moves in every frame after the first
+            Assert.IsTrue(keyframeStrip.ChangeScores[0] == 0.0);
+            for (int frame = 1; frame < keyframeStrip.ChangeScores.Length; ++frame)
+            {
+                Assert.IsTrue(keyframeStrip.ChangeScores[frame] > 0.0);
+            }
+            Assert.IsTrue(keyframeStrip.MaximumChangeScore == keyframeStrip.ChangeScores.Max());
+            Assert.IsTrue(keyframeStrip.HasChange);
+
+            // the first frame's properties are found as images' are from their thumbnails
+            ImageProperties firstFrameProperties = keyframeStrip.FirstFrameProperties;
+            Assert.IsTrue(firstFrameProperties.HasColorationAndLuminosity);
+            Assert.IsNotNull(firstFrameProperties.Statistics);
+            Assert.IsTrue(Math.Abs(firstFrameProperties.Statistics.LuminosityHistogram.Sum() - 1.0F) < 0.001F);
+            Assert.IsTrue(firstFrameProperties.Statistics.LuminosityPercentile5 <= firstFrameProperties.Statistics.LuminosityPercentile95);
+
+            using (MemoryStream stripJpeg = new())
+            {
+                keyframeStrip.Write(stripJpeg);
+                stripJpeg.Position = 0;
+                BitmapFrame stripFrame = new JpegBitmapDecoder(stripJpeg, BitmapCreateOptions.None, BitmapCacheOption.OnLoad).Frames[0];
+                Assert.IsTrue((stripFrame.PixelWidth == keyframeStrip.Strip.PixelWidth) && (stripFrame.PixelHeight == keyframeStrip.Strip.PixelHeight));
+            }
+
+            // videos with fewer frames than requested contribute all their frames
+            Assert.IsTrue(VideoKeyframeStrip.TryCreate(videoPath, 20, out keyframeStrip));
+            Assert.IsTrue(keyframeStrip.FrameIndices.SequenceEqual(Enumerable.Range(0, 12)));
+            Assert.IsTrue(keyframeStrip.Strip.PixelWidth == 12 * 40);
+
+            Assert.ThrowsExactly<ArgumentOutOfRangeException>(() =>
+            {
+                VideoKeyframeStrip.TryCreate(videoPath, 0, out VideoKeyframeStrip? _);
+            });
+
+            // strips are available through video rows
+            VideoRow video = new(Path.GetFileName(videoPath), String.Empty, new FileTable());
+            Assert.IsTrue(video.TryGetKeyframeStrip(this.WorkingDirectory, Constant.Images.VideoKeyframeStripFrames, out keyframeStrip));
+            Assert.IsTrue(keyframeStrip.FrameIndices.Length == Constant.Images.VideoKeyframeStripFrames);
+        }
+
+        [TestMethod]
+        public void Magnify()
+        {
+            // each pixel's blue channel is its column and green channel its row, so bilinear samples are predictable
+            byte[] pixels = new byte[64 * 48 * 4];
+            for (int offset = 0; offset < pixels.Length; offset += 4)
+            {
+                pixels[offset] = (byte)((offset / 4) % 64);
+                pixels[offset + 1] = (byte)((offset / 4) / 64);
+                pixels[offset + 3] = 255;
+            }
+            MemoryImage image = FileTests.CreateImage(64, 48, pixels);
+
+            // at unit scale lens pixels are image pixels, and lens pixels outside the lens circle are transparent
+            MemoryImage lens = new(16, 16, PixelFormats.Pbgra32);
+            Assert.IsTrue(image.TryMagnify(new Point(32.0, 24.0), 1.0, lens));
+            byte[] lensPixels = FileTests.GetPixels(lens);
+            int centerOffset = 4 * (8 * 16 + 8);
+            Assert.IsTrue((lensPixels[centerOffset] == 32) && (lensPixels[centerOffset + 1] == 24) && (lensPixels[centerOffset + 3] == 255));
+            Assert.IsTrue((lensPixels[0] == 0) && (lensPixels[3] == 0));
+
+            // at 4x magnification the lens's center pixel falls halfway between image pixels
+            Assert.IsTrue(image.TryMagnify(new Point(32.0, 24.0), 0.25, lens));
+            lensPixels = FileTests.GetPixels(lens);
+            Assert.IsTrue((31 <= lensPixels[centerOffset]) && (lensPixels[centerOffset] <= 32) && (23 <= lensPixels[centerOffset + 1]) && (lensPixels[centerOffset + 1] <= 24));
+
+            // the part of the lens off the image's top left corner is transparent
+            Assert.IsTrue(image.TryMagnify(new Point(0.0, 0.0), 1.0, lens));
+            lensPixels = FileTests.GetPixels(lens);
+            Assert.IsTrue((lensPixels[4 * (4 * 16 + 4) + 3] == 0) && (lensPixels[4 * (12 * 16 + 12) + 3] == 255));
+
+            Assert.IsFalse(image.TryMagnify(new Point(32.0, 24.0), 1.0, new MemoryImage(14, 14, PixelFormats.Pbgra32)));
+        }
+
+        [TestMethod]
+        public void Statistics()
+        {
+            // uniform grey has no spread or edges
+            byte[] pixels = new byte[64 * 48 * 4];
+            for (int offset = 0; offset < pixels.Length; offset += 4)
+            {
+                pixels[offset] = 128;
+                pixels[offset + 1] = 128;
+                pixels[offset + 2] = 128;
+                pixels[offset + 3] = 255;
+            }
+            MemoryImage grey = FileTests.CreateImage(64, 48, pixels);
+            (double luminosity, double coloration, ImageStatistics statistics) = grey.GetStatistics(0);
+            Assert.IsTrue((Math.Abs(luminosity - 128.0 / 255.0) < 1E-9) && (coloration == 0.0));
+            Assert.IsTrue((statistics.LuminosityPercentile5 == 128.0 / 255.0) && (statistics.LuminosityPercentile50 == 128.0 / 255.0) && (statistics.LuminosityPercentile95 == 128.0 / 255.0));
+            Assert.IsTrue((statistics.HighlightClipping == 0.0) && (statistics.ShadowClipping == 0.0) && (statistics.Sharpness == 0.0));
+            Assert.IsTrue(statistics.LuminosityHistogram[128 * Constant.Images.LuminosityHistogramBins / 256] == 1.0F);
+
+            // a black and white checkerboard is half clipped at each end and has the largest possible Laplacian at every pixel
+            for (int offset = 0; offset < pixels.Length; offset += 4)
+            {
+                int pixel = offset / 4;
+                byte value = ((pixel % 64) + (pixel / 64)) % 2 == 0 ? (byte)255 : (byte)0;
+                pixels[offset] = value;
+                pixels[offset + 1] = value;
+                pixels[offset + 2] = value;
+            }
+            MemoryImage checkerboard = FileTests.CreateImage(64, 48, pixels);
+            (luminosity, _, statistics) = checkerboard.GetStatistics(0);
+            Assert.IsTrue(Math.Abs(luminosity - 0.5) < 1E-9);
+            Assert.IsTrue((statistics.HighlightClipping == 0.5) && (statistics.ShadowClipping == 0.5));
+            Assert.IsTrue((statistics.LuminosityPercentile5 == 0.0) && (statistics.LuminosityPercentile50 == 0.0) && (statistics.LuminosityPercentile95 == 1.0));
+            Assert.IsTrue(statistics.Sharpness == 1020.0 * 1020.0);
+
+            // rows in an info bar are excluded
+            (_, _, statistics) = checkerboard.GetStatistics(24);
+            Assert.IsTrue((statistics.HighlightClipping == 0.5) && (statistics.Sharpness == 1020.0 * 1020.0));
+
+            // statistics roundtrip through their database representations
+            ImageStatistics roundtrip = new((double)statistics.GetDatabaseValue(Constant.FileColumn.HighlightClipping),
+                                            ImageStatistics.GetLuminosityHistogram((byte[])statistics.GetDatabaseValue(Constant.FileColumn.LuminosityHistogram)),
+                                            (double)statistics.GetDatabaseValue(Constant.FileColumn.LuminosityPercentile5),
+                                            (double)statistics.GetDatabaseValue(Constant.FileColumn.LuminosityPercentile50),
+                                            (double)statistics.GetDatabaseValue(Constant.FileColumn.LuminosityPercentile95),
+                                            (double)statistics.GetDatabaseValue(Constant.FileColumn.ShadowClipping),
+                                            (double)statistics.GetDatabaseValue(Constant.FileColumn.Sharpness));
+            CollectionAssert.AreEqual(statistics.LuminosityHistogram, roundtrip.LuminosityHistogram);
+            Assert.IsTrue(roundtrip.Sharpness == statistics.Sharpness);
+        }
+
+        [TestMethod]
+        public void Translation()
+        {
+            // frames from a shaken camera are stood in for by crops of a smooth scene at offsets from each other, with the scene
+            // bilinearly interpolated from random control points every 16 pixels
+            const int Width = FileTests.TestImageWidth;
+            const int Height = FileTests.TestImageHeight;
+            const int Margin = 32;
+            int controlWidth = (Width + 2 * Margin) / 16 + 2;
+            byte[] control = new byte[3 * controlWidth * ((Height + 2 * Margin) / 16 + 2)];
+            new Random(1).NextBytes(control);
+            MemoryImage Crop(int originX, int originY)
+            {
+                byte[] pixels = new byte[Width * Height * 4];
+                for (int y = 0; y < Height; ++y)
+                {
+                    for (int x = 0; x < Width; ++x)
+                    {
+                        int sceneX = Margin + originX + x;
+                        int sceneY = Margin + originY + y;
+                        int controlOffset = 3 * ((sceneY / 16) * controlWidth + sceneX / 16);
+                        int fractionX = sceneX % 16;
+                        int fractionY = sceneY % 16;
+                        for (int channel = 0; channel < 3; ++channel)
+                        {
+                            int topLeft = control[controlOffset + channel];
+                            int topRight = control[controlOffset + 3 + channel];
+                            int bottomLeft = control[controlOffset + 3 * controlWidth + channel];
+                            int bottomRight = control[controlOffset + 3 * controlWidth + 3 + channel];
+                            pixels[4 * (y * Width + x) + channel] = (byte)(((16 - fractionX) * (16 - fractionY) * topLeft + fractionX * (16 - fractionY) * topRight + (16 - fractionX) * fractionY * bottomLeft + fractionX * fractionY * bottomRight) / 256);
+                        }
+                        pixels[4 * (y * Width + x) + 3] = 255;
+                    }
+                }
+                return FileTests.CreateImage(Width, Height, pixels);
+            }
+
+            // translations are found to the pixel and differencing with them cancels the scene out, including along the edges
+            // where the translated image has no counterpart
+            MemoryImage image = Crop(0, 0);
+            foreach ((int shiftX, int shiftY) in new (int, int)[] { (0, 0), (1, 0), (5, -3), (-13, 9), (-2, 2), (Constant.Images.TranslationMaximumInPixels - 2, -Constant.Images.TranslationMaximumInPixels + 1) })
+            {
+                MemoryImage shifted = Crop(shiftX, shiftY);
+                Assert.IsTrue(image.TryGetTranslation(shifted, out int offsetX, out int offsetY));
+                Assert.IsTrue((offsetX == -shiftX) && (offsetY == -shiftY));
+                Assert.IsTrue(shifted.TryGetTranslation(image, out int reverseOffsetX, out int reverseOffsetY));
+                Assert.IsTrue((reverseOffsetX == shiftX) && (reverseOffsetY == shiftY));
+
+                Assert.IsTrue(image.TryDifference(shifted, offsetX, offsetY, Constant.Images.DifferenceThresholdDefault, out MemoryImage? difference));
+                Assert.IsTrue(FileTests.GetPixels(difference).Where((byte value, int index) => index % 4 != 3).All(value => value == 0));
+                if ((Math.Abs(shiftX) > 1) || (Math.Abs(shiftY) > 1))
+                {
+                    Assert.IsTrue(image.TryDifference(shifted, Constant.Images.DifferenceThresholdDefault, out MemoryImage? untranslatedDifference));
+                    Assert.IsTrue(FileTests.GetPixels(untranslatedDifference).Where((byte value, int index) => index % 4 != 3).Any(value => value != 0));
+                }
+            }
+
+            // an animal moving across an otherwise still scene isn't mistaken for camera motion, and images too small to search
+            // or of different sizes aren't translated
+            MemoryImage animal = Crop(0, 0);
+            byte[] animalPixels = FileTests.GetPixels(animal);
+            for (int y = Height / 3; y < Height / 2; ++y)
+            {
+                for (int x = Width / 3; x < Width / 2; ++x)
+                {
+                    animalPixels[4 * (y * Width + x)] = 30;
+                    animalPixels[4 * (y * Width + x) + 1] = 30;
+                    animalPixels[4 * (y * Width + x) + 2] = 30;
+                }
+            }
+            animal = FileTests.CreateImage(Width, Height, animalPixels);
+            Assert.IsTrue(image.TryGetTranslation(animal, out int animalOffsetX, out int animalOffsetY));
+            Assert.IsTrue((animalOffsetX == 0) && (animalOffsetY == 0));
+
+            MemoryImage small = new(64, 48, PixelFormats.Pbgra32);
+            Assert.IsFalse(small.TryGetTranslation(small, out int _, out int _));
+            Assert.IsFalse(image.TryGetTranslation(new MemoryImage(Width - 1, Height, PixelFormats.Pbgra32), out int _, out int _));
+        }
+
         private static void VerifyCurrentImage(ImageCache cache)
         {
             Assert.IsNotNull(cache.Current);
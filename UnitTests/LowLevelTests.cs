@@ -1,7 +1,12 @@
 ﻿using Carnassial.Command;
+using Carnassial.Interop;
+using Carnassial.Native;
 using Carnassial.Util;
 using Microsoft.VisualStudio.TestTools.UnitTesting;
+using System;
 using System.Collections.Generic;
+using System.Threading;
+using System.Threading.Tasks;
 
 namespace Carnassial.UnitTests
 {
@@ -20,6 +25,157 @@ namespace Carnassial.UnitTests
             CarnassialTest.TryChangeToTestCulture();
         }
 
+        /// <summary>
+        /// Basic functional validation of <see cref="BoundedRingQueue{TItem}" />.
+        /// </summary>
+        [TestMethod]
+        public void BoundedRingQueue()
+        {
+            BoundedRingQueue<int> queue = new(3);
+            Assert.IsTrue(queue.Capacity == 4);
+            Assert.IsTrue(queue.Count == 0);
+            Assert.IsFalse(queue.TryDequeue(out int _));
+
+            // fill, wrap around the ring several times, and drain
+            for (int item = 0; item < queue.Capacity; ++item)
+            {
+                Assert.IsTrue(queue.TryEnqueue(item));
+            }
+            Assert.IsTrue(queue.Count == queue.Capacity);
+            Assert.IsFalse(queue.TryEnqueue(queue.Capacity));
+            for (int item = queue.Capacity; item < 10 * queue.Capacity; ++item)
+            {
+                Assert.IsTrue(queue.TryDequeue(out int dequeuedItem));
+                Assert.IsTrue(dequeuedItem == item - queue.Capacity);
+                Assert.IsTrue(queue.TryEnqueue(item));
+            }
+            for (int item = 9 * queue.Capacity; item < 10 * queue.Capacity; ++item)
+            {
+                Assert.IsTrue(queue.TryDequeue(out int dequeuedItem));
+                Assert.IsTrue(dequeuedItem == item);
+            }
+            Assert.IsTrue(queue.Count == 0);
+            Assert.IsFalse(queue.TryDequeue(out int _));
+
+            // concurrent producers and consumers
+            // Threads rather than tasks as spinning consumers can otherwise starve producers of thread pool threads.
+            const int itemsPerProducer = 25000;
+            const int threadsPerSide = 3;
+            BoundedRingQueue<int> concurrentQueue = new(16);
+            int[] timesDequeued = new int[threadsPerSide * itemsPerProducer];
+            int itemsDequeued = 0;
+            Thread[] threads = new Thread[2 * threadsPerSide];
+            for (int thread = 0; thread < threadsPerSide; ++thread)
+            {
+                int firstItem = thread * itemsPerProducer;
+                threads[thread] = new(() =>
+                {
+                    for (int item = firstItem; item < firstItem + itemsPerProducer; ++item)
+                    {
+                        while (concurrentQueue.TryEnqueue(item) == false)
+                        {
+                            Thread.Yield();
+                        }
+                    }
+                });
+                threads[threadsPerSide + thread] = new(() =>
+                {
+                    while (Volatile.Read(ref itemsDequeued) < timesDequeued.Length)
+                    {
+                        if (concurrentQueue.TryDequeue(out int item))
+                        {
+                            Interlocked.Increment(ref timesDequeued[item]);
+                            Interlocked.Increment(ref itemsDequeued);
+                        }
+                        else
+                        {
+                            Thread.Yield();
+                        }
+                    }
+                });
+            }
+            foreach (Thread thread in threads)
+            {
+                thread.Start();
+            }
+            foreach (Thread thread in threads)
+            {
+                Assert.IsTrue(thread.Join(TimeSpan.FromSeconds(10)));
+            }
+
+            foreach (int count in timesDequeued)
+            {
+                Assert.IsTrue(count == 1);
+            }
+        }
+
+        /// <summary>
+        /// Basic functional validation of <see cref="GreedyDualSizeFrequencyCache{TKey, TValue}" />.
+        /// </summary>
+        [TestMethod]
+        public void GreedyDualSizeFrequencyCache()
+        {
+            GreedyDualSizeFrequencyCache<int, string> cache = new(100);
+            Assert.IsTrue(cache.Count == 0);
+            Assert.IsFalse(cache.TryGetValue(0, out string? _));
+            Assert.IsTrue(cache.Misses == 1);
+
+            // with uniform sizes and costs replacement is least recently used
+            for (int key = 0; key < 4; ++key)
+            {
+                Assert.IsTrue(cache.AddOrUpdate(key, key.ToString(), 25, 1.0));
+            }
+            Assert.IsTrue(cache.Count == 4);
+            Assert.IsTrue(cache.SizeInBytes == cache.CapacityInBytes);
+            Assert.IsTrue(cache.TryGetValue(0, out string? value) && (value == "0"));
+            Assert.IsTrue(cache.Hits == 1);
+            Assert.IsTrue(cache.AddOrUpdate(4, "4", 25, 1.0));
+            Assert.IsTrue(cache.ContainsKey(0));
+            Assert.IsFalse(cache.ContainsKey(1));
+
+            // costly values are kept in preference to cheap ones of the same size but eventually age out if they're not used
+            Assert.IsTrue(cache.AddOrUpdate(5, "5", 25, 100.0));
+            for (int key = 6; key < 10; ++key)
+            {
+                Assert.IsTrue(cache.AddOrUpdate(key, key.ToString(), 25, 1.0));
+            }
+            Assert.IsTrue(cache.ContainsKey(5));
+            int cheapKey = 10;
+            for (; cache.ContainsKey(5) && (cheapKey < 1000); ++cheapKey)
+            {
+                Assert.IsTrue(cache.AddOrUpdate(cheapKey, cheapKey.ToString(), 25, 1.0));
+                Assert.IsTrue(cache.SizeInBytes <= cache.CapacityInBytes);
+            }
+            Assert.IsFalse(cache.ContainsKey(5));
+            Assert.IsTrue(cheapKey > 20);
+
+            // small values are kept in preference to large ones of the same cost
+            GreedyDualSizeFrequencyCache<int, string> sizeCache = new(100);
+            Assert.IsTrue(sizeCache.AddOrUpdate(0, "large", 60, 1.0));
+            Assert.IsTrue(sizeCache.AddOrUpdate(1, "small", 10, 1.0));
+            Assert.IsTrue(sizeCache.AddOrUpdate(2, "medium", 30, 1.0));
+            Assert.IsTrue(sizeCache.AddOrUpdate(3, "small", 10, 1.0));
+            Assert.IsFalse(sizeCache.ContainsKey(0));
+            Assert.IsTrue(sizeCache.ContainsKey(1) && sizeCache.ContainsKey(2) && sizeCache.ContainsKey(3));
+            Assert.IsTrue(sizeCache.SizeInBytes == 50);
+
+            // replacement, removal, and values larger than the cache
+            Assert.IsTrue(sizeCache.AddOrUpdate(1, "small replaced", 20, 1.0));
+            Assert.IsTrue(sizeCache.TryGetValue(1, out value) && (value == "small replaced"));
+            Assert.IsTrue(sizeCache.SizeInBytes == 60);
+            Assert.IsTrue(sizeCache.TryRemove(1));
+            Assert.IsFalse(sizeCache.TryRemove(1));
+            Assert.IsTrue(sizeCache.SizeInBytes == 40);
+            Assert.IsFalse(sizeCache.AddOrUpdate(4, "too large", 101, 1.0));
+            Assert.IsTrue(sizeCache.Count == 2);
+
+            sizeCache.Clear();
+            Assert.IsTrue(sizeCache.Count == 0);
+            Assert.IsTrue(sizeCache.SizeInBytes == 0);
+            Assert.IsFalse(sizeCache.ContainsKey(2));
+            Assert.IsTrue(sizeCache.AddOrUpdate(2, "medium", 30, 1.0));
+        }
+
         /// <summary>
         /// Basic functional validation of <see cref="MostRecentlyUsedList" />.
         /// </summary>
@@ -123,6 +279,90 @@ namespace Carnassial.UnitTests
             Assert.IsTrue(leastRecent == 4);
         }
 
+        /// <summary>
+        /// Consistency checks for <see cref="Processor" />'s topology.
+        /// </summary>
+        [TestMethod]
+        public void ProcessorTopology()
+        {
+            Assert.IsTrue(Processor.PhysicalCores > 0);
+            Assert.IsTrue(Processor.LogicalProcessors >= Processor.PhysicalCores);
+            Assert.IsTrue(Processor.PerformanceCores > 0);
+            Assert.IsTrue(Processor.PerformanceCores + Processor.EfficiencyCores == Processor.PhysicalCores);
+            Assert.IsTrue(Processor.IsHybrid == (Processor.EfficiencyCores > 0));
+
+            Assert.IsTrue(Processor.CacheLineSizeInBytes >= 32);
+            Assert.IsTrue(Processor.L1DataCacheSizeInBytes > 0);
+            Assert.IsTrue(Processor.L2CacheSizeInBytes > Processor.L1DataCacheSizeInBytes);
+            Assert.IsTrue((Processor.L2CacheSharedBy > 0) && (Processor.L2CacheSharedBy <= Processor.LogicalProcessors));
+            Assert.IsTrue((Processor.L3CacheSizeInBytes == 0) || (Processor.L3CacheSizeInBytes > Processor.L2CacheSizeInBytes));
+            Assert.IsTrue(Processor.L3CacheSharedBy <= Processor.LogicalProcessors);
+        }
+
+        /// <summary>
+        /// Basic functional validation of <see cref="SectorBufferChain" />.
+        /// </summary>
+        [TestMethod]
+        public void SectorBufferChain()
+        {
+            const int segmentLength = 4096;
+
+            // fill the first segment partially, then write past its end so a second segment's needed
+            using SectorBufferChain buffer = new();
+            Memory<byte> destination = buffer.GetWritableMemory(1024, segmentLength);
+            Assert.IsTrue(destination.Length >= segmentLength);
+            for (int index = 0; index < 1024; ++index)
+            {
+                destination.Span[index] = (byte)index;
+            }
+            buffer.Advance(1024);
+            Assert.IsTrue(buffer.Length == 1024);
+
+            int firstSegmentSpace = buffer.GetWritableMemory(1, segmentLength).Length;
+            destination = buffer.GetWritableMemory(firstSegmentSpace + 1, segmentLength);
+            for (int index = 0; index < destination.Length; ++index)
+            {
+                destination.Span[index] = (byte)(1024 + index);
+            }
+            buffer.Advance(destination.Length);
+            Assert.IsTrue(buffer.Length == 1024 + destination.Length);
+
+            // positions in the gap left at the end of the first segment aren't part of the buffer
+            for (int position = 0; position < buffer.Length; position += 97)
+            {
+                Assert.IsTrue(buffer[position] == (byte)position);
+            }
+
+            // ranges within and across segments
+            ArraySegment<byte> withinSegment = buffer.GetContiguous(10, 100);
+            Assert.IsTrue((withinSegment.Count == 100) && (withinSegment[0] == 10) && (withinSegment[99] == 109));
+            ArraySegment<byte> acrossSegments = buffer.GetContiguous(1000, 100);
+            for (int index = 0; index < acrossSegments.Count; ++index)
+            {
+                Assert.IsTrue(acrossSegments[index] == (byte)(1000 + index));
+            }
+
+            byte[] copy = new byte[buffer.Length];
+            buffer.CopyTo(0, copy);
+            for (int index = 0; index < copy.Length; ++index)
+            {
+                Assert.IsTrue(copy[index] == (byte)index);
+            }
+
+            // whole buffer contiguous
+            int length = buffer.Length;
+            buffer.EnsureContiguousCapacity(length + segmentLength);
+            destination = buffer.GetWritableMemory(segmentLength, segmentLength);
+            destination.Span[0] = (byte)length;
+            buffer.Advance(1);
+            ArraySegment<byte> contiguous = buffer.GetContiguous(0, buffer.Length);
+            Assert.IsTrue(contiguous.Count == length + 1);
+            for (int index = 0; index < contiguous.Count; ++index)
+            {
+                Assert.IsTrue(contiguous[index] == (byte)index);
+            }
+        }
+
         /// <summary>
         /// Basic functional validation of <see cref="UndoRedoChain" />.
         /// </summary>
@@ -213,5 +453,65 @@ namespace Carnassial.UnitTests
                 this.IsExecuted = false;
             }
         }
+
+        /// <summary>
+        /// Basic functional validation of <see cref="WorkStealingScheduler" />.
+        /// </summary>
+        [TestMethod]
+        public void WorkStealingScheduler()
+        {
+            const int consumers = 4;
+            const int itemsPerProducer = 10000;
+            const int producers = 2;
+
+            // small queues so producers are throttled by consumers
+            using WorkStealingScheduler<int> scheduler = new(consumers, 4);
+            int[] timesTaken = new int[producers * itemsPerProducer];
+            Task[] consumerTasks = new Task[consumers];
+            for (int consumer = 0; consumer < consumers; ++consumer)
+            {
+                int consumerNumber = consumer;
+                consumerTasks[consumer] = Task.Run(() =>
+                {
+                    while (scheduler.TryTake(consumerNumber, out int item))
+                    {
+                        Interlocked.Increment(ref timesTaken[item]);
+                    }
+                });
+            }
+
+            Task[] producerTasks = new Task[producers];
+            for (int producer = 0; producer < producers; ++producer)
+            {
+                int firstItem = producer * itemsPerProducer;
+                producerTasks[producer] = Task.Run(() =>
+                {
+                    for (int item = firstItem; item < firstItem + itemsPerProducer; ++item)
+                    {
+                        Assert.IsTrue(scheduler.Add(item));
+                    }
+                });
+            }
+            Task.WaitAll(producerTasks);
+            scheduler.CompleteAdding();
+            Assert.IsTrue(Task.WaitAll(consumerTasks, TimeSpan.FromSeconds(10)));
+
+            foreach (int count in timesTaken)
+            {
+                Assert.IsTrue(count == 1);
+            }
+            Assert.IsFalse(scheduler.TryTake(0, out int _));
+
+            // cancellation releases a producer blocked on a full scheduler
+            using WorkStealingScheduler<int> fullScheduler = new(1, 2);
+            Assert.IsTrue(fullScheduler.Add(0));
+            Assert.IsTrue(fullScheduler.Add(1));
+            Task<bool> blockedProducer = Task.Run(() => fullScheduler.Add(2));
+            Assert.IsFalse(blockedProducer.Wait(TimeSpan.FromMilliseconds(100)));
+            fullScheduler.Cancel();
+            Assert.IsTrue(blockedProducer.Wait(TimeSpan.FromSeconds(10)));
+            Assert.IsFalse(blockedProducer.Result);
+            Assert.IsFalse(fullScheduler.TryTake(0, out int _));
+        }
     }
 }
@@ -16,6 +16,7 @@ namespace Carnassial.UnitTests
         public const string InitializeDataGridMethodName = "InitializeDataGrid";
         public const string MessageBoxAutomationID = "CarnassialMessageBox";
         public const string OkButtonAutomationID = "OkButton";
+        public const double SampledLuminosityAndColorationTolerance = 0.02;
         public const string TemplatePaneAutomationID = "TemplatePane";
         public const int UIRetries = 4;
 
@@ -91,6 +92,8 @@ namespace Carnassial.UnitTests
         {
             public const string CarnivoreDirectoryName = "CarnivoreTestImages";
             public const string HybridVideoDirectoryName = "HybridVideo";
+            // generated by tests as the hybrid video test files aren't MJPEG
+            public const string MjpegVideoFileName = "MjpegVideo.AVI";
 
             // file databases for backwards compatibility testing
             // Version is the Carnassial version used for creation.
@@ -109,6 +112,8 @@ namespace Carnassial.UnitTests
         public static class FileExpectation
         {
             public const string DaylightBobcatFileName = "BushnellTrophyHD-119677C-20160805-926.JPG";
+            public const string HybridVideoFileName = "06260042.AVI";
+            public const int HybridVideoFrameCount = 461;
 
             public static readonly FileExpectations CorruptFieldScan;
             public static readonly FileExpectations DaylightBobcat;